@@ -0,0 +1,37 @@
+import os, subprocess, sys
+# replicate check.py's asm2wasm expectation matrix (py3)
+regen = '--regen' in sys.argv
+A='_gate_build/bin/asm2wasm'
+fails=[]; ran=0
+for asm in sorted(os.listdir('test')):
+    if not asm.endswith('.asm.js'): continue
+    for precise in [0,1,2]:
+        for opts in [1,0]:
+            cmd=[A, os.path.join('test',asm)]
+            wasm=asm.replace('.asm.js','.fromasm')
+            if not precise:
+                cmd+=['--emit-potential-traps','--ignore-implicit-traps']; wasm+='.imprecise'
+            elif precise==2:
+                cmd+=['--emit-clamped-potential-traps']; wasm+='.clamp'
+            if not opts:
+                wasm+='.no-opts'
+                if precise: cmd+=['-O0']
+            else:
+                cmd+=['-O']
+            if 'debugInfo' in asm: cmd+=['-g']
+            if 'noffi' in asm: cmd+=['--no-legalize-javascript-ffi']
+            if precise and opts:
+                open('/tmp/a.mem','wb').write(asm.encode())
+                cmd+=['--mem-init=/tmp/a.mem']
+                if asm[0]=='e': cmd+=['--mem-base=1024']
+            if 'i64' in asm or 'wasm-only' in asm or 'noffi' in asm: cmd+=['--wasm-only']
+            path=os.path.join('test',wasm)
+            if not os.path.exists(path): continue
+            r=subprocess.run(cmd,capture_output=True)
+            ran+=1
+            exp=open(path,'rb').read()
+            if r.stdout!=exp:
+                fails.append(path)
+                if regen: open(path,'wb').write(r.stdout)
+print('ran',ran,'mismatches',len(fails))
+for f in fails: print(' ',f)
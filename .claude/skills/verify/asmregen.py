@@ -0,0 +1,38 @@
+import os, subprocess, sys
+A='_gate_build/bin/asm2wasm'
+env=dict(os.environ); env['BINARYEN_PASS_DEBUG']='1'
+fails=[]; ran=0; regen=0
+for asm in sorted(os.listdir('test')):
+    if not asm.endswith('.asm.js'): continue
+    for precise in [0,1,2]:
+        for opts in [1,0]:
+            cmd=[A, os.path.join('test',asm)]
+            wasm=asm.replace('.asm.js','.fromasm')
+            if not precise:
+                cmd+=['--emit-potential-traps','--ignore-implicit-traps']; wasm+='.imprecise'
+            elif precise==2:
+                cmd+=['--emit-clamped-potential-traps']; wasm+='.clamp'
+            if not opts:
+                wasm+='.no-opts'
+                if precise: cmd+=['-O0']
+            else:
+                cmd+=['-O']
+            if 'debugInfo' in asm: cmd+=['-g']
+            if 'noffi' in asm: cmd+=['--no-legalize-javascript-ffi']
+            if precise and opts:
+                open('/tmp/a.mem','wb').write(asm.encode())
+                cmd+=['--mem-init=/tmp/a.mem']
+                if asm[0]=='e': cmd+=['--mem-base=1024']
+            if 'i64' in asm or 'wasm-only' in asm or 'noffi' in asm: cmd+=['--wasm-only']
+            path=os.path.join('test',wasm)
+            if not os.path.exists(path): continue
+            # validate every inter-pass state while generating
+            r=subprocess.run(cmd,capture_output=True,env=env)
+            ran+=1
+            if r.returncode!=0:
+                fails.append((path,r.stderr[-200:])); continue
+            exp=open(path,'rb').read()
+            if r.stdout!=exp:
+                open(path,'wb').write(r.stdout); regen+=1
+print('ran',ran,'regenerated',regen,'errors',len(fails))
+for f in fails: print(f)
@@ -0,0 +1,41 @@
+import os, subprocess, sys
+# replicate check.py's pass-test loop (py3)
+def split_wast(path):
+    if path.endswith('.wasm'):
+        return None
+    text = open(path).read()
+    mods = []
+    depth = 0; start = None
+    for i,ch in enumerate(text):
+        if ch == '(':
+            if depth == 0 and text[i:i+7] == '(module':
+                start = i
+            depth += 1
+        elif ch == ')':
+            depth -= 1
+            if depth == 0 and start is not None:
+                mods.append(text[start:i+1]); start = None
+    return mods
+opt = sys.argv[1] if len(sys.argv)>1 else '_gate_build/bin/wasm-opt'
+names = sys.argv[2:]
+fails = 0; ran = 0
+for t in sorted(os.listdir('test/passes')):
+    if not t.endswith(('.wast','.wasm')): continue
+    passname = t.replace('.wast','').replace('.wasm','')
+    if names and passname not in names: continue
+    binary = t.endswith('.wasm')
+    opts = ['-'+passname] if passname.startswith('O') else ['--'+p for p in passname.split('_')]
+    path = os.path.join('test/passes', t)
+    actual = b''
+    if binary:
+        actual = subprocess.run([opt]+opts+[path,'--print'], capture_output=True).stdout
+    else:
+        for mod in split_wast(path):
+            open('/tmp/split.wast','w').write(mod)
+            actual += subprocess.run([opt]+opts+['/tmp/split.wast','--print'], capture_output=True).stdout
+    expected = open(os.path.join('test/passes', passname + ('.bin' if binary else '') + '.txt'),'rb').read()
+    ran += 1
+    if actual != expected:
+        print('FAIL:', passname); fails += 1
+print('ran %d, fails %d' % (ran, fails))
+sys.exit(1 if fails else 0)
@@ -0,0 +1,14 @@
+#!/bin/bash
+fails=0; ran=0
+for dir in dot_s llvm_autogenerated; do
+  for s in test/$dir/*.s; do
+    exp="${s%.s}.wast"; [ -f "$exp" ] || continue
+    extra=""
+    [ "$dir" = "llvm_autogenerated" ] && extra="--allocate-stack=1024"
+    case "$(basename $s)" in start_*) extra="$extra --start";; esac
+    _gate_build/bin/s2wasm $s --emscripten-glue $extra > /tmp/s2w.out 2>/dev/null
+    ran=$((ran+1))
+    cmp -s /tmp/s2w.out "$exp" || { echo "FAIL $s"; fails=$((fails+1)); }
+  done
+done
+echo "ran $ran, fails $fails"
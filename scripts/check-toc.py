@@ -0,0 +1,83 @@
+#!/usr/bin/env python
+#
+# Verifies a wasm binary's "toc" custom section (wasm-opt --emit-toc)
+# against the file itself: every recorded (id, payload offset, size)
+# must match a section found by walking the real section headers, and
+# every recorded function body must start inside the code section's
+# payload. Exits non-zero on any mismatch - this is the check that
+# catches relative-offset bugs when the writer streams sections out.
+#
+# Usage: check-toc.py <file.wasm>
+
+import sys
+
+
+def main():
+    data = open(sys.argv[1], 'rb').read()
+    assert data[:4] == b'\0asm', 'not a wasm binary'
+
+    pos = [8]  # skip magic + version
+
+    def read_leb():
+        value = 0
+        shift = 0
+        while 1:
+            byte = data[pos[0]] if not isinstance(data[pos[0]], bytes) else ord(data[pos[0]])
+            pos[0] += 1
+            value |= (byte & 127) << shift
+            shift += 7
+            if not (byte & 128):
+                break
+        return value
+
+    # walk the real sections: id => list of (payload offset, payload size)
+    real = []
+    code_payload = None
+    while pos[0] < len(data):
+        section_id = read_leb()
+        size = read_leb()
+        payload = pos[0]
+        real.append((section_id, payload, size))
+        if section_id == 10:
+            code_payload = (payload, size)
+        pos[0] = payload + size
+
+    # find and parse the toc
+    toc = None
+    for section_id, payload, size in real:
+        if section_id != 0:
+            continue
+        pos[0] = payload
+        name_len = read_leb()
+        if data[pos[0]:pos[0] + name_len] == b'toc':
+            pos[0] += name_len
+            toc = True
+            break
+    assert toc, 'no toc section found'
+
+    failed = 0
+    num_sections = read_leb()
+    recorded = []
+    for _ in range(num_sections):
+        recorded.append((read_leb(), read_leb(), read_leb()))
+    for section_id, offset, size in recorded:
+        if (section_id, offset, size) not in real:
+            print('toc section entry does not match the file: id %d offset %d size %d' % (section_id, offset, size))
+            failed = 1
+
+    num_functions = read_leb()
+    for _ in range(num_functions):
+        offset = read_leb()
+        size = read_leb()
+        if code_payload:
+            start, total = code_payload
+            if offset + size > total:
+                print('toc function entry out of the code payload: offset %d size %d' % (offset, size))
+                failed = 1
+
+    print('toc: %d sections, %d functions%s' % (num_sections, num_functions, '' if not failed else ', FAILED'))
+    sys.exit(failed)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,150 @@
+#!/usr/bin/env python
+#
+# Incremental re-optimization: when only a few functions changed between
+# two builds, re-optimize just those and splice everything else from the
+# previous optimized output at the binary level.
+#
+# Usage:
+#   incremental-opt.py <wasm-opt> <old-input> <old-output> <new-input> <output> [passes...]
+#
+# Soundness: this only applies function-parallel (function-local) passes,
+# via wasm-opt --func-filter, so a function's optimized bytes depend only
+# on its own body and the module's index spaces. The splice is used only
+# when every non-code section of the two inputs is byte-identical (same
+# index spaces); otherwise we fall back to a full optimization run.
+
+import subprocess
+import sys
+import os
+
+
+def read_leb(data, pos):
+    result = 0
+    shift = 0
+    while True:
+        byte = data[pos] if isinstance(data[pos], int) else ord(data[pos])
+        pos += 1
+        result |= (byte & 127) << shift
+        if not (byte & 128):
+            return result, pos
+        shift += 7
+
+
+def find_sections(data):
+    pos = 8
+    while pos < len(data):
+        header_start = pos
+        section_id, pos = read_leb(data, pos)
+        size, pos = read_leb(data, pos)
+        yield section_id, pos, pos + size, header_start
+        pos += size
+
+
+def code_entries(data):
+    sec = next(s for s in find_sections(data) if s[0] == 10)
+    count, pos = read_leb(data, sec[1])
+    entries = []
+    for _ in range(count):
+        start = pos
+        size, pos = read_leb(data, pos)
+        pos += size
+        entries.append((start, pos))
+    return sec, count, entries
+
+
+def non_code_bytes(data):
+    out = bytearray()
+    for section_id, start, end, header_start in find_sections(data):
+        if section_id != 10:
+            out += data[header_start:end]
+    return bytes(out)
+
+
+def encode_leb(value):
+    out = bytearray()
+    while True:
+        byte = value & 127
+        value >>= 7
+        if value:
+            out.append(byte | 128)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def encode_leb5(value):
+    # the tools emit section sizes as backpatched fixed-width 5-byte LEBs;
+    # match that so spliced output is byte-compatible
+    out = bytearray()
+    for i in range(4):
+        out.append((value & 127) | 128)
+        value >>= 7
+    out.append(value & 127)
+    return bytes(out)
+
+
+def full_run(wasm_opt, new_input, output, passes):
+    sys.exit(subprocess.call([wasm_opt, new_input, '-o', output] + passes))
+
+
+def main():
+    wasm_opt, old_input, old_output, new_input, output = sys.argv[1:6]
+    passes = sys.argv[6:]
+
+    old_in = open(old_input, 'rb').read()
+    new_in = open(new_input, 'rb').read()
+    old_out = open(old_output, 'rb').read()
+
+    # the splice is only sound when the index spaces agree
+    if non_code_bytes(old_in) != non_code_bytes(new_in):
+        print('index spaces differ, running full optimization')
+        full_run(wasm_opt, new_input, output, passes)
+
+    _, old_count, old_entries = code_entries(old_in)
+    _, new_count, new_entries = code_entries(new_in)
+    _, out_count, out_entries = code_entries(old_out)
+    if old_count != new_count or out_count != new_count:
+        print('function counts differ, running full optimization')
+        full_run(wasm_opt, new_input, output, passes)
+
+    dirty = [i for i in range(new_count)
+             if old_in[old_entries[i][0]:old_entries[i][1]] !=
+                new_in[new_entries[i][0]:new_entries[i][1]]]
+    print('%d of %d functions changed' % (len(dirty), new_count))
+
+    tmp = output + '.dirty.wasm'
+    cmd = [wasm_opt, new_input, '-o', tmp,
+           '--func-filter=' + ','.join(str(i) for i in dirty)] + passes
+    if dirty:
+        if subprocess.call(cmd) != 0:
+            sys.exit('optimization of changed functions failed')
+        opt = open(tmp, 'rb').read()
+        os.unlink(tmp)
+    else:
+        opt = new_in
+
+    # splice: dirty functions from the fresh run, everything else from the
+    # previous optimized output
+    _, _, opt_entries = code_entries(opt)
+    dirty_set = set(dirty)
+    sec, _, _ = code_entries(opt)
+    body = bytearray(encode_leb(new_count))
+    for i in range(new_count):
+        if i in dirty_set:
+            start, end = opt_entries[i]
+            body += opt[start:end]
+        else:
+            start, end = out_entries[i]
+            body += old_out[start:end]
+    spliced = bytearray()
+    spliced += opt[:sec[3]]
+    spliced += encode_leb(10)
+    spliced += encode_leb5(len(body))
+    spliced += body
+    spliced += opt[sec[2]:]
+    with open(output, 'wb') as f:
+        f.write(bytes(spliced))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+#
+# Runs wasm-shell over many .wast files in parallel processes, with
+# deterministic ordered reporting: output is printed per file, in the
+# order the files were given, as each finishes.
+#
+# This is the sound place for spec-suite parallelism: within one file,
+# modules can (register) themselves for later modules to import, so the
+# groups inside a file share state and must run in order - but separate
+# files are fully independent processes.
+#
+# Usage: parallel-shell.py <wasm-shell> <jobs> <file.wast>...
+
+import subprocess
+import sys
+
+
+def main():
+    shell = sys.argv[1]
+    jobs = int(sys.argv[2])
+    files = sys.argv[3:]
+
+    running = []  # (filename, Popen)
+    results = []
+    pos = 0
+    failed = 0
+
+    def reap():
+        filename, proc = running.pop(0)
+        out, _ = proc.communicate()
+        results.append((filename, proc.returncode, out))
+
+    while pos < len(files) or running:
+        while pos < len(files) and len(running) < jobs:
+            proc = subprocess.Popen([shell, files[pos]],
+                                    stdout=subprocess.PIPE,
+                                    stderr=subprocess.STDOUT)
+            running.append((files[pos], proc))
+            pos += 1
+        reap()
+        # flush finished results in order
+        while results:
+            filename, code, out = results.pop(0)
+            sys.stdout.write('== %s%s\n' % (filename,
+                                            '' if code == 0 else ' (FAILED)'))
+            if out:
+                sys.stdout.write(out if isinstance(out, str) else out.decode('utf-8', 'replace'))
+            if code != 0:
+                failed += 1
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
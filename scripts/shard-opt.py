@@ -0,0 +1,138 @@
+#!/usr/bin/env python
+#
+# Multi-process sharded optimization: splits the function space into N
+# shards, optimizes each in its own wasm-opt process (function-parallel
+# passes only, restricted to the shard's slice), splices the per-shard
+# code sections back together at the binary level - code entries are
+# size-prefixed and independent, so this is pure byte surgery - and runs
+# the module-level passes in one final wasm-opt invocation.
+#
+# Usage:
+#   shard-opt.py <wasm-opt> <shards> <input.wasm> <output.wasm> [passes...]
+#
+# Note the schedule differs from a single-process run: all function passes
+# run before all module passes, rather than interleaved. The result is a
+# valid optimization of the module either way.
+
+import subprocess
+import sys
+import tempfile
+import os
+
+
+def read_leb(data, pos):
+    result = 0
+    shift = 0
+    while True:
+        byte = data[pos] if isinstance(data[pos], int) else ord(data[pos])
+        pos += 1
+        result |= (byte & 127) << shift
+        if not (byte & 128):
+            return result, pos
+        shift += 7
+
+
+def find_sections(data):
+    # yields (id, payload_start, payload_end, header_start)
+    pos = 8  # magic + version
+    while pos < len(data):
+        header_start = pos
+        section_id, pos = read_leb(data, pos)
+        size, pos = read_leb(data, pos)
+        yield section_id, pos, pos + size, header_start
+        pos += size
+
+
+def split_code_entries(data, start, end):
+    # returns (count, [(entry_start, entry_end)...]); entry spans include
+    # the size LEB
+    count, pos = read_leb(data, start)
+    entries = []
+    for _ in range(count):
+        entry_start = pos
+        size, pos = read_leb(data, pos)
+        pos += size
+        entries.append((entry_start, pos))
+    assert pos == end, 'code section entries must fill the section'
+    return count, entries
+
+
+def encode_leb(value):
+    out = bytearray()
+    while True:
+        byte = value & 127
+        value >>= 7
+        if value:
+            out.append(byte | 128)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def encode_leb5(value):
+    # the tools emit section sizes as backpatched fixed-width 5-byte LEBs;
+    # match that so spliced output is byte-compatible
+    out = bytearray()
+    for i in range(4):
+        out.append((value & 127) | 128)
+        value >>= 7
+    out.append(value & 127)
+    return bytes(out)
+
+
+def main():
+    wasm_opt, shards, input_path, output_path = sys.argv[1:5]
+    shards = int(shards)
+    passes = sys.argv[5:]
+
+    tmpdir = tempfile.mkdtemp()
+    shard_files = []
+    procs = []
+    for i in range(shards):
+        out = os.path.join(tmpdir, 'shard%d.wasm' % i)
+        shard_files.append(out)
+        cmd = [wasm_opt, input_path, '-o', out,
+               '--shard-index=%d' % i, '--shard-count=%d' % shards] + passes
+        procs.append(subprocess.Popen(cmd))
+    for proc in procs:
+        if proc.wait() != 0:
+            sys.exit('shard worker failed')
+
+    # splice: take function i's code entry from shard i % shards; all other
+    # sections are identical across shards (the workers ran no module-level
+    # passes), so shard 0 provides them
+    blobs = [open(f, 'rb').read() for f in shard_files]
+    base = blobs[0]
+    spliced = bytearray()
+    pos = 0
+    for section_id, start, end, header_start in find_sections(base):
+        if section_id != 10:  # not the code section
+            continue
+        count, base_entries = split_code_entries(base, start, end)
+        per_shard_entries = [split_code_entries(blob, s, e)[1]
+                             for blob, (_, s, e, _) in
+                             [(b, next((sec for sec in find_sections(b)
+                                        if sec[0] == 10))) for b in blobs]]
+        body = bytearray(encode_leb(count))
+        for i in range(count):
+            entry_start, entry_end = per_shard_entries[i % shards][i]
+            body += blobs[i % shards][entry_start:entry_end]
+        spliced += base[pos:header_start]
+        spliced += encode_leb(10)
+        spliced += encode_leb(len(body))
+        spliced += body
+        pos = end
+    spliced += base[pos:]
+
+    merged = os.path.join(tmpdir, 'merged.wasm')
+    with open(merged, 'wb') as f:
+        f.write(bytes(spliced))
+
+    # the module-level passes run once, over the spliced module
+    cmd = [wasm_opt, merged, '-o', output_path, '--module-passes-only'] + passes
+    if subprocess.call(cmd) != 0:
+        sys.exit('merge step failed')
+
+
+if __name__ == '__main__':
+    main()
@@ -893,7 +893,10 @@ void Asm2WasmBuilder::processAsm(Ref ast) {
   Ref asmFunction = ast[1][0];
   assert(asmFunction[0] == DEFUN);
   Ref body = asmFunction[3];
-  assert(body[0][0] == STRING && (body[0][1]->getIString() == IString("use asm") || body[0][1]->getIString() == IString("almost asm")));
+  // keyword comparisons are pointer-identity against the pre-interned
+  // constants; constructing a transient IString here would re-hash the
+  // literal on every module
+  assert(body[0][0] == STRING && (body[0][1]->getIString() == USE_ASM || body[0][1]->getIString() == ALMOST_ASM));
 
   auto addImport = [&](IString name, Ref imported, WasmType type) {
     assert(imported[0] == DOT);
@@ -1403,6 +1406,15 @@ void Asm2WasmBuilder::processAsm(Ref ast) {
     }
   };
 
+  // The tail phase below is not the serial cliff it looks like: every pass
+  // here except legalize-js-interface is function-parallel, and PassRunner
+  // fuses consecutive function-parallel passes into one parallel batch
+  // (one task per function through the whole stack), so with legalization
+  // off the entire tail is a single parallel phase, and with it on there
+  // are exactly two, split where the ordering genuinely requires it
+  // (legalization must see finalized calls, and the cleanup passes must
+  // see legalized code). These passes cannot move into the incremental
+  // builder itself: FinalizeCalls needs every function to exist first.
   PassRunner passRunner(&wasm);
   if (debug) {
     passRunner.setDebug(true);
@@ -53,6 +53,7 @@ cashew::IString GLOBAL("global"),
                 I32_TEMP("asm2wasm_i32_temp"),
                 DEBUGGER("debugger"),
                 USE_ASM("use asm"),
+                ALMOST_ASM("almost asm"),
                 BUFFER("buffer"),
                 ENV("env"),
                 INSTRUMENT("instrument"),
@@ -56,6 +56,7 @@ extern cashew::IString GLOBAL,
                 I32_TEMP,
                 DEBUGGER,
                 USE_ASM,
+                ALMOST_ASM,
                 BUFFER,
                 ENV,
                 INSTRUMENT,
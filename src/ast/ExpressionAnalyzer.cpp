@@ -78,7 +78,7 @@ bool ExpressionAnalyzer::isResultDropped(std::vector<Expression*> stack) {
 
 bool ExpressionAnalyzer::flexibleEqual(Expression* left, Expression* right, ExprComparer comparer) {
   std::vector<Name> nameStack;
-  std::map<Name, std::vector<Name>> rightNames; // for each name on the left, the stack of names on the right (a stack, since names are scoped and can nest duplicatively
+  std::unordered_map<Name, std::vector<Name>> rightNames; // for each name on the left, the stack of names on the right (a stack, since names are scoped and can nest duplicatively
   Nop popNameMarker;
   std::vector<Expression*> leftStack;
   std::vector<Expression*> rightStack;
@@ -278,14 +278,14 @@ bool ExpressionAnalyzer::flexibleEqual(Expression* left, Expression* right, Expr
 
 
 // hash an expression, ignoring superficial details like specific internal names
-uint32_t ExpressionAnalyzer::hash(Expression* curr) {
-  uint32_t digest = 0;
+uint64_t ExpressionAnalyzer::hash(Expression* curr) {
+  Hasher64 hasher;
 
-  auto hash = [&digest](uint32_t hash) {
-    digest = rehash(digest, hash);
+  auto hash = [&hasher](uint64_t block) {
+    hasher.feed(block);
   };
-  auto hash64 = [&digest](uint64_t hash) {
-    digest = rehash(rehash(digest, hash >> 32), uint32_t(hash));
+  auto hash64 = [&hasher](uint64_t block) {
+    hasher.feed(block);
   };
 
   std::vector<Name> nameStack;
@@ -490,6 +490,6 @@ uint32_t ExpressionAnalyzer::hash(Expression* curr) {
     #undef HASH
     #undef PUSH
   }
-  return digest;
+  return hasher.digest;
 }
 } // namespace wasm
@@ -15,6 +15,8 @@
  */
 
 #include "ast_utils.h"
+#include "ast/linear-ir.h"
+#include "ast/manipulation.h"
 #include "support/hash.h"
 
 namespace wasm {
@@ -136,6 +138,37 @@ Expression* flexibleCopy(Expression* original, Module& wasm, CustomCopier custom
 }
 
 
+// see the contract in manipulation.h: the caller owns the subtree
+// exclusively, or reused addresses can alias Expression*-keyed state
+void recycleTree(Expression* root, MixedArena& allocator) {
+  // post-order is not needed; a simple worklist visits every node once
+  std::vector<Expression*> work;
+  work.push_back(root);
+  while (!work.empty()) {
+    auto* curr = work.back();
+    work.pop_back();
+    iterChildSlots(curr, [&](Expression** slot) {
+      if (*slot) work.push_back(*slot);
+    });
+    // list storage first - the node's memory must stay intact while we
+    // read its list
+    if (auto* block = curr->dynCast<Block>()) {
+      block->list.releaseBuffer();
+    } else if (auto* call = curr->dynCast<Call>()) {
+      call->operands.releaseBuffer();
+    } else if (auto* call = curr->dynCast<CallImport>()) {
+      call->operands.releaseBuffer();
+    } else if (auto* call = curr->dynCast<CallIndirect>()) {
+      call->operands.releaseBuffer();
+    } else if (auto* host = curr->dynCast<Host>()) {
+      host->operands.releaseBuffer();
+    } else if (auto* sw = curr->dynCast<Switch>()) {
+      sw->targets.releaseBuffer();
+    }
+    allocator.recycleSpace(curr, getExpressionSize(curr));
+  }
+}
+
 // Splice an item into the middle of a block's list
 void spliceIntoBlock(Block* block, Index index, Expression* add) {
   auto& list = block->list;
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// The module's direct call graph, built with one parallel walk over the
+// function bodies and stored CSR-style: one edge per call site, in body
+// visit order, so consumers can derive per-callee counts, deduplicated
+// edges, or orderings without doing their own IR traversals. Indirect
+// calls are not edges here (they go through the table); consumers that
+// care about them handle the table separately, as they always have.
+//
+
+#ifndef wasm_ast_call_graph_h
+#define wasm_ast_call_graph_h
+
+#include <atomic>
+
+#include "support/threads.h"
+#include "wasm.h"
+#include "wasm-traversal.h"
+
+namespace wasm {
+
+struct CallGraph {
+  struct Edge {
+    Name target;
+    bool isImport;
+  };
+
+  std::vector<Function*> functions; // caller index => function
+  std::vector<size_t> edgeStarts;   // caller index => first edge; has functions.size() + 1 entries
+  std::vector<Edge> edges;          // all call sites, grouped by caller
+
+  CallGraph(Module& module) {
+    struct EdgeCollector : public PostWalker<EdgeCollector> {
+      std::vector<Edge> edges;
+      void visitCall(Call* curr) {
+        edges.push_back({ curr->target, false });
+      }
+      void visitCallImport(CallImport* curr) {
+        edges.push_back({ curr->target, true });
+      }
+    };
+    size_t total = module.functions.size();
+    functions.reserve(total);
+    for (auto& func : module.functions) {
+      functions.push_back(func.get());
+    }
+    std::vector<std::vector<Edge>> collected(total);
+    parallelFor(total, [&](size_t index, size_t worker) {
+      EdgeCollector collector;
+      collector.walk(functions[index]->body);
+      collected[index].swap(collector.edges);
+    });
+    // pack into CSR form
+    edgeStarts.resize(total + 1);
+    size_t numEdges = 0;
+    for (size_t i = 0; i < total; i++) {
+      edgeStarts[i] = numEdges;
+      numEdges += collected[i].size();
+    }
+    edgeStarts[total] = numEdges;
+    edges.reserve(numEdges);
+    for (auto& funcEdges : collected) {
+      edges.insert(edges.end(), funcEdges.begin(), funcEdges.end());
+    }
+  }
+
+  // the direct call sites of one caller, in body order
+  template<typename F>
+  void forEachEdge(size_t caller, F f) const {
+    for (size_t i = edgeStarts[caller]; i < edgeStarts[caller + 1]; i++) {
+      f(edges[i]);
+    }
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_ast_call_graph_h
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef wasm_ast_function_analysis_h
+#define wasm_ast_function_analysis_h
+
+#include <memory>
+#include <mutex>
+
+#include "ast_utils.h"
+#include "ast/cost.h"
+#include "support/hash.h"
+#include "wasm.h"
+
+namespace wasm {
+
+// Per-function analysis facts that more than one pass wants to know.
+struct FunctionFacts {
+  Index size;    // number of IR nodes (Measurer)
+  Index cost;    // estimated execution cost (CostAnalyzer)
+  bool hasCalls;
+  // the full side-effect summary of the body
+  std::shared_ptr<EffectAnalyzer> effects;
+};
+
+// Caches analysis facts per function, keyed by the function's content hash,
+// so that queries repeated across a pass pipeline don't re-walk functions
+// that no earlier pass modified. A hit costs one hashing walk; a miss
+// additionally recomputes the facts (several walks). Safe to query from
+// function-parallel passes.
+class FunctionAnalysisCache {
+public:
+  // The canonical content hash of a function: everything that affects its
+  // behavior and validity (body structure, signature, locals). This is what
+  // the pass runner's incremental validation keys off as well.
+  static uint64_t hashFunction(Function* func) {
+    Hasher64 hasher;
+    hasher.feed(uint64_t(func->getNumParams()) | (uint64_t(func->result) << 32));
+    for (auto type : func->params) hasher.feed(type);
+    hasher.feed(func->getNumVars());
+    for (auto type : func->vars) hasher.feed(type);
+    hasher.feed(ExpressionAnalyzer::hash(func->body));
+    return hasher.digest;
+  }
+
+  FunctionFacts get(Function* func, PassOptions& options) {
+    auto digest = hashFunction(func);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto iter = entries.find(func);
+      if (iter != entries.end() && iter->second.hash == digest) {
+        return iter->second.facts;
+      }
+    }
+    FunctionFacts facts;
+    facts.size = Measurer::measure(func->body);
+    facts.cost = CostAnalyzer(func->body).cost;
+    facts.effects = std::make_shared<EffectAnalyzer>(options, func->body);
+    facts.hasCalls = facts.effects->calls;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      entries[func] = Entry({ digest, facts });
+    }
+    return facts;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+  }
+
+private:
+  struct Entry {
+    uint64_t hash;
+    FunctionFacts facts;
+  };
+  std::map<Function*, Entry> entries;
+  std::mutex mutex;
+};
+
+} // namespace wasm
+
+#endif // wasm_ast_function_analysis_h
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A flattened, contiguous view of an expression tree, for passes that
+// mostly iterate: instead of chasing arena pointers through the generic
+// walker's task machinery, a pass can linearize a function once and then
+// scan a dense array. Entries are child *slots* (Expression**), so a
+// peephole pass can also replace nodes in place through the slot; any
+// structural mutation beyond that invalidates the buffer, and the pass
+// must re-linearize.
+//
+
+#ifndef wasm_ast_linear_ir_h
+#define wasm_ast_linear_ir_h
+
+#include "wasm.h"
+
+namespace wasm {
+
+// Calls add(slot) for each child slot of the node, in execution order.
+// This is the generic child iterator the tree representation itself lacks;
+// the flat buffer below and hand-rolled traversals build on it.
+template<typename F>
+inline void iterChildSlots(Expression* curr, F add) {
+  switch (curr->_id) {
+    case Expression::Id::BlockId: {
+      for (auto& child : curr->cast<Block>()->list) add(&child);
+      break;
+    }
+    case Expression::Id::IfId: {
+      auto* iff = curr->cast<If>();
+      add(&iff->condition);
+      add(&iff->ifTrue);
+      if (iff->ifFalse) add(&iff->ifFalse);
+      break;
+    }
+    case Expression::Id::LoopId: {
+      add(&curr->cast<Loop>()->body);
+      break;
+    }
+    case Expression::Id::BreakId: {
+      auto* br = curr->cast<Break>();
+      if (br->value) add(&br->value);
+      if (br->condition) add(&br->condition);
+      break;
+    }
+    case Expression::Id::SwitchId: {
+      auto* sw = curr->cast<Switch>();
+      if (sw->value) add(&sw->value);
+      add(&sw->condition);
+      break;
+    }
+    case Expression::Id::CallId: {
+      for (auto& operand : curr->cast<Call>()->operands) add(&operand);
+      break;
+    }
+    case Expression::Id::CallImportId: {
+      for (auto& operand : curr->cast<CallImport>()->operands) add(&operand);
+      break;
+    }
+    case Expression::Id::CallIndirectId: {
+      auto* call = curr->cast<CallIndirect>();
+      for (auto& operand : call->operands) add(&operand);
+      add(&call->target);
+      break;
+    }
+    case Expression::Id::SetLocalId: {
+      add(&curr->cast<SetLocal>()->value);
+      break;
+    }
+    case Expression::Id::SetGlobalId: {
+      add(&curr->cast<SetGlobal>()->value);
+      break;
+    }
+    case Expression::Id::LoadId: {
+      add(&curr->cast<Load>()->ptr);
+      break;
+    }
+    case Expression::Id::StoreId: {
+      auto* store = curr->cast<Store>();
+      add(&store->ptr);
+      add(&store->value);
+      break;
+    }
+    case Expression::Id::UnaryId: {
+      add(&curr->cast<Unary>()->value);
+      break;
+    }
+    case Expression::Id::BinaryId: {
+      auto* binary = curr->cast<Binary>();
+      add(&binary->left);
+      add(&binary->right);
+      break;
+    }
+    case Expression::Id::SelectId: {
+      auto* select = curr->cast<Select>();
+      add(&select->ifTrue);
+      add(&select->ifFalse);
+      add(&select->condition);
+      break;
+    }
+    case Expression::Id::DropId: {
+      add(&curr->cast<Drop>()->value);
+      break;
+    }
+    case Expression::Id::ReturnId: {
+      auto* ret = curr->cast<Return>();
+      if (ret->value) add(&ret->value);
+      break;
+    }
+    case Expression::Id::HostId: {
+      for (auto& operand : curr->cast<Host>()->operands) add(&operand);
+      break;
+    }
+    // leaves
+    case Expression::Id::GetLocalId:
+    case Expression::Id::GetGlobalId:
+    case Expression::Id::ConstId:
+    case Expression::Id::NopId:
+    case Expression::Id::UnreachableId: {
+      break;
+    }
+    default: WASM_UNREACHABLE();
+  }
+}
+
+// A fast traversal for read-only analyses: preorder, explicit pointer
+// stack, one switch dispatch per node, and no replacement support or task
+// machinery - visitors that only read should prefer this over a full
+// walker (the walker pays a task push and an indirect call per node for
+// mutation support these passes never use). The visitor sees nodes in
+// preorder, children in execution order.
+template<typename V>
+inline void constWalk(Expression* root, V& visitor) {
+  std::vector<Expression*> stack;
+  stack.push_back(root);
+  while (!stack.empty()) {
+    auto* curr = stack.back();
+    stack.pop_back();
+    visitor.visit(curr);
+    auto firstChild = stack.size();
+    iterChildSlots(curr, [&](Expression** slot) {
+      stack.push_back(*slot);
+    });
+    // children pop in execution order
+    std::reverse(stack.begin() + firstChild, stack.end());
+  }
+}
+
+// The flat instruction buffer: the tree's node slots laid out in one
+// contiguous post-order array (children before parents, in execution
+// order). The slots point into the tree, so the "convert back" direction
+// is free - in-place replacements through a slot are immediately visible
+// in the tree.
+struct LinearIR {
+  std::vector<Expression**> postorder;
+
+  LinearIR() {}
+  LinearIR(Expression*& root) { linearize(root); }
+
+  void linearize(Expression*& root) {
+    postorder.clear();
+    // an explicit two-phase stack: first visit pushes children, second
+    // emits the node
+    std::vector<std::pair<Expression**, bool>> stack;
+    stack.emplace_back(&root, false);
+    while (!stack.empty()) {
+      auto& entry = stack.back();
+      if (entry.second) {
+        postorder.push_back(entry.first);
+        stack.pop_back();
+        continue;
+      }
+      entry.second = true;
+      auto* curr = *entry.first;
+      // push children in reverse, so they pop in execution order
+      auto firstChild = stack.size();
+      iterChildSlots(curr, [&](Expression** slot) {
+        stack.emplace_back(slot, false);
+      });
+      std::reverse(stack.begin() + firstChild, stack.end());
+    }
+  }
+
+  size_t size() const { return postorder.size(); }
+  Expression** operator[](size_t i) const { return postorder[i]; }
+  std::vector<Expression**>::const_iterator begin() const { return postorder.begin(); }
+  std::vector<Expression**>::const_iterator end() const { return postorder.end(); }
+};
+
+} // namespace wasm
+
+#endif // wasm_ast_linear_ir_h
@@ -21,6 +21,17 @@
 
 namespace wasm {
 
+// On a mutation journal for speculative apply-measure-revert loops: the
+// revert side only works if every mutation goes through a journaling
+// chokepoint, and this IR's passes mutate through plain field writes (see
+// the note on Const in wasm.h) - a slot-level journal would silently miss
+// them and revert to a corrupted state. The sound speculation tool in
+// this tree is cloning: passes measure on a copy (ModuleUtils::copyModule
+// for whole-module A/B, ExpressionManipulator::copy plus a scratch arena
+// with MixedArena::transferInto for subtrees) and adopt or drop the
+// clone. The in-tree "revert" users cited actually measure numerically
+// without mutating (coalesce-locals' learning mode), so nothing today
+// pays the clone cost on a hot path.
 namespace ExpressionManipulator {
   // Re-use a node's memory. This helps avoid allocation when optimizing.
   template<typename InputType, typename OutputType>
@@ -49,6 +60,52 @@ namespace ExpressionManipulator {
     return output;
   }
 
+  // The allocated size of a node of unknown static type, for the dynamic
+  // form of convert() below.
+  inline size_t getExpressionSize(Expression* curr) {
+    switch (curr->_id) {
+      case Expression::Id::BlockId: return sizeof(Block);
+      case Expression::Id::IfId: return sizeof(If);
+      case Expression::Id::LoopId: return sizeof(Loop);
+      case Expression::Id::BreakId: return sizeof(Break);
+      case Expression::Id::SwitchId: return sizeof(Switch);
+      case Expression::Id::CallId: return sizeof(Call);
+      case Expression::Id::CallImportId: return sizeof(CallImport);
+      case Expression::Id::CallIndirectId: return sizeof(CallIndirect);
+      case Expression::Id::GetLocalId: return sizeof(GetLocal);
+      case Expression::Id::SetLocalId: return sizeof(SetLocal);
+      case Expression::Id::GetGlobalId: return sizeof(GetGlobal);
+      case Expression::Id::SetGlobalId: return sizeof(SetGlobal);
+      case Expression::Id::LoadId: return sizeof(Load);
+      case Expression::Id::StoreId: return sizeof(Store);
+      case Expression::Id::ConstId: return sizeof(Const);
+      case Expression::Id::UnaryId: return sizeof(Unary);
+      case Expression::Id::BinaryId: return sizeof(Binary);
+      case Expression::Id::SelectId: return sizeof(Select);
+      case Expression::Id::DropId: return sizeof(Drop);
+      case Expression::Id::ReturnId: return sizeof(Return);
+      case Expression::Id::HostId: return sizeof(Host);
+      case Expression::Id::NopId: return sizeof(Nop);
+      case Expression::Id::UnreachableId: return sizeof(Unreachable);
+      default: WASM_UNREACHABLE();
+    }
+  }
+
+  // The dynamic form of convert(): transmutes the node in place when the
+  // target type fits in its storage (sparing the arena an allocation), and
+  // falls back to allocating when it does not. Unlike convert(), this works
+  // when only the dynamic type is known. The returned node may or may not
+  // be the input pointer.
+  template<typename OutputType>
+  inline OutputType* flexibleConvert(Expression* input, MixedArena& allocator) {
+    if (sizeof(OutputType) <= getExpressionSize(input)) {
+      OutputType* output = (OutputType*)(input);
+      new (output) OutputType();
+      return output;
+    }
+    return allocator.alloc<OutputType>();
+  }
+
   using CustomCopier = std::function<Expression*(Expression*)>;
   Expression* flexibleCopy(Expression* original, Module& wasm, CustomCopier custom);
 
@@ -59,6 +116,18 @@ namespace ExpressionManipulator {
     return flexibleCopy(original, wasm, copy);
   }
 
+  // Returns a subtree's node storage to the arena's recycled freelists,
+  // so later expression allocations of the same sizes reuse it instead of
+  // growing the arena - a long pipeline's peak stops including every node
+  // ever dropped. Soundness rests entirely on the caller: the subtree
+  // must be exclusively owned (detached from the tree, with no
+  // Expression*-keyed side state alive that could alias a reused address
+  // - per-pass maps, and the function's debugLocations side table; see
+  // VacuumDCE for the pattern of gating on debugLocations.empty()).
+  // Child lists' buffers are released too, through the existing
+  // ArenaVector release hook.
+  void recycleTree(Expression* root, MixedArena& allocator);
+
   // Splice an item into the middle of a block's list
   void spliceIntoBlock(Block* block, Index index, Expression* add);
 }
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef wasm_ast_module_utils_h
+#define wasm_ast_module_utils_h
+
+#include "wasm.h"
+#include "ast/manipulation.h"
+
+namespace wasm {
+
+namespace ModuleUtils {
+
+// Deep-clones a module, so pipelines can be tried on a copy (e.g. run two
+// and keep the smaller result) without a serialization round trip. This
+// walks the IR once per function; a raw chunk-level memcpy of the arena
+// can't do better, as interior pointers can only be found by walking the
+// nodes anyway.
+inline void copyModule(Module& in, Module& out) {
+  for (auto& curr : in.functionTypes) {
+    out.addFunctionType(new FunctionType(*curr));
+  }
+  for (auto& curr : in.imports) {
+    out.addImport(new Import(*curr));
+  }
+  for (auto& curr : in.exports) {
+    out.addExport(new Export(*curr));
+  }
+  for (auto& curr : in.functions) {
+    auto* func = new Function(*curr);
+    func->body = ExpressionManipulator::copy(func->body, out);
+    func->debugLocations.clear(); // locations key on the old nodes
+    out.addFunction(func);
+  }
+  for (auto& curr : in.globals) {
+    auto* global = new Global(*curr);
+    global->init = ExpressionManipulator::copy(global->init, out);
+    out.addGlobal(global);
+  }
+  out.table = in.table;
+  for (auto& segment : out.table.segments) {
+    segment.offset = ExpressionManipulator::copy(segment.offset, out);
+  }
+  out.memory = in.memory;
+  for (auto& segment : out.memory.segments) {
+    segment.offset = ExpressionManipulator::copy(segment.offset, out);
+  }
+  out.start = in.start;
+  out.userSections = in.userSections;
+  out.debugInfoFileNames = in.debugInfoFileNames;
+}
+
+} // namespace ModuleUtils
+
+} // namespace wasm
+
+#endif // wasm_ast_module_utils_h
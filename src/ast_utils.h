@@ -22,6 +22,7 @@
 #include "wasm-builder.h"
 #include "pass.h"
 #include "ast/branch-utils.h"
+#include "ast/linear-ir.h"
 
 namespace wasm {
 
@@ -83,11 +84,13 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
   EffectAnalyzer(PassOptions& passOptions, Expression *ast = nullptr) {
     ignoreImplicitTraps = passOptions.ignoreImplicitTraps;
     debugInfo = passOptions.debugInfo;
+    callEffects = passOptions.callEffects.get();
     if (ast) analyze(ast);
   }
 
   bool ignoreImplicitTraps;
   bool debugInfo;
+  const std::map<Name, CallEffectSummary>* callEffects = nullptr; // optional, see mod-ref
 
   void analyze(Expression *ast) {
     breakNames.clear();
@@ -197,7 +200,18 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
     if (curr->name.is()) breakNames.erase(curr->name); // these were internal breaks
   }
 
-  void visitCall(Call *curr) { calls = true; }
+  void visitCall(Call *curr) {
+    if (callEffects) {
+      auto iter = callEffects->find(curr->target);
+      if (iter != callEffects->end() && iter->second.pure) {
+        // a pure callee: the call can be reordered, but may still trap or
+        // not terminate, so treat it like an implicit trap, not a no-op
+        implicitTrap = true;
+        return;
+      }
+    }
+    calls = true;
+  }
   void visitCallImport(CallImport *curr) {
     calls = true;
     if (debugInfo) {
@@ -266,6 +280,36 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
   void visitUnreachable(Unreachable *curr) { branches = true; }
 };
 
+// Caches effect summaries per expression, for passes that query the same
+// subtrees repeatedly (which is otherwise quadratic, a full re-walk per
+// query). The cache cannot see mutations: the owner must invalidate any
+// node whose subtree it changes, or only keep the cache across code known
+// not to change.
+class EffectCache {
+public:
+  EffectCache(PassOptions& passOptions) : passOptions(passOptions) {}
+
+  EffectAnalyzer& get(Expression* curr) {
+    auto iter = entries.find(curr);
+    if (iter == entries.end()) {
+      iter = entries.emplace(
+        std::piecewise_construct,
+        std::forward_as_tuple(curr),
+        std::forward_as_tuple(passOptions, curr)
+      ).first;
+    }
+    return iter->second;
+  }
+
+  void invalidate(Expression* curr) { entries.erase(curr); }
+
+  void clear() { entries.clear(); }
+
+private:
+  PassOptions& passOptions;
+  std::unordered_map<Expression*, EffectAnalyzer> entries;
+};
+
 // Measure the size of an AST
 
 struct Measurer : public PostWalker<Measurer, UnifiedExpressionVisitor<Measurer>> {
@@ -276,9 +320,20 @@ struct Measurer : public PostWalker<Measurer, UnifiedExpressionVisitor<Measurer>
   }
 
   static Index measure(Expression* tree) {
-    Measurer measurer;
-    measurer.walk(tree);
-    return measurer.size;
+    // a hand-rolled traversal; for just counting, the generic walker's
+    // task machinery is most of the cost
+    Index size = 0;
+    std::vector<Expression*> stack;
+    stack.push_back(tree);
+    while (!stack.empty()) {
+      auto* curr = stack.back();
+      stack.pop_back();
+      size++;
+      iterChildSlots(curr, [&](Expression** slot) {
+        stack.push_back(*slot);
+      });
+    }
+    return size;
   }
 };
 
@@ -319,7 +374,7 @@ struct ExpressionAnalyzer {
   }
 
   // hash an expression, ignoring superficial details like specific internal names
-  static uint32_t hash(Expression* curr);
+  static uint64_t hash(Expression* curr);
 };
 
 // Re-Finalizes all node types
@@ -693,6 +693,199 @@ BinaryenExpressionRef BinaryenUnreachable(BinaryenModuleRef module) {
   return static_cast<Expression*>(ret);
 }
 
+// ===== Batched expression building =====
+
+enum BatchOps {
+  BatchNop = 0,
+  BatchConst,
+  BatchBinary,
+  BatchUnary,
+  BatchGetLocal,
+  BatchSetLocal,
+  BatchTeeLocal,
+  BatchLoad,
+  BatchStore,
+  BatchDrop,
+  BatchSelect,
+  BatchReturn,
+  BatchIf,
+  BatchBlock
+};
+
+BinaryenBatchOp BinaryenBatchNop(void) { return BatchNop; }
+BinaryenBatchOp BinaryenBatchConst(void) { return BatchConst; }
+BinaryenBatchOp BinaryenBatchBinary(void) { return BatchBinary; }
+BinaryenBatchOp BinaryenBatchUnary(void) { return BatchUnary; }
+BinaryenBatchOp BinaryenBatchGetLocal(void) { return BatchGetLocal; }
+BinaryenBatchOp BinaryenBatchSetLocal(void) { return BatchSetLocal; }
+BinaryenBatchOp BinaryenBatchTeeLocal(void) { return BatchTeeLocal; }
+BinaryenBatchOp BinaryenBatchLoad(void) { return BatchLoad; }
+BinaryenBatchOp BinaryenBatchStore(void) { return BatchStore; }
+BinaryenBatchOp BinaryenBatchDrop(void) { return BatchDrop; }
+BinaryenBatchOp BinaryenBatchSelect(void) { return BatchSelect; }
+BinaryenBatchOp BinaryenBatchReturn(void) { return BatchReturn; }
+BinaryenBatchOp BinaryenBatchIf(void) { return BatchIf; }
+BinaryenBatchOp BinaryenBatchBlock(void) { return BatchBlock; }
+
+BinaryenExpressionRef BinaryenBuildBatch(BinaryenModuleRef module,
+                                         const uint32_t* commands,
+                                         BinaryenIndex numWords,
+                                         const double* values) {
+  // see the format documentation in binaryen-c.h. this deliberately goes
+  // straight to the builder rather than through the single-node C API
+  // functions, so a batch is one FFI crossing and no tracing noise per node
+  auto* wasm = (Module*)module;
+  Builder builder(*wasm);
+  std::vector<Expression*> built;
+  size_t i = 0;
+  size_t nextValue = 0;
+  auto word = [&]() {
+    assert(i < numWords);
+    return commands[i++];
+  };
+  auto ref = [&](uint32_t ordinal) {
+    assert(ordinal < built.size());
+    return built[ordinal];
+  };
+  while (i < numWords) {
+    Expression* curr;
+    auto op = word();
+    switch (op) {
+      case BatchNop: {
+        curr = builder.makeNop();
+        break;
+      }
+      case BatchConst: {
+        auto type = WasmType(word());
+        Literal value;
+        if (type == i64) {
+          uint64_t low = uint32_t(int64_t(values[nextValue++]));
+          uint64_t high = uint32_t(int64_t(values[nextValue++]));
+          value = Literal(int64_t(low | (high << 32)));
+        } else if (type == i32) {
+          value = Literal(int32_t(int64_t(values[nextValue++])));
+        } else if (type == f32) {
+          value = Literal(float(values[nextValue++]));
+        } else if (type == f64) {
+          value = Literal(double(values[nextValue++]));
+        } else {
+          abort();
+        }
+        curr = builder.makeConst(value);
+        break;
+      }
+      case BatchBinary: {
+        auto binop = BinaryOp(word());
+        auto* left = ref(word());
+        auto* right = ref(word());
+        curr = builder.makeBinary(binop, left, right);
+        break;
+      }
+      case BatchUnary: {
+        auto unop = UnaryOp(word());
+        auto* value = ref(word());
+        curr = builder.makeUnary(unop, value);
+        break;
+      }
+      case BatchGetLocal: {
+        auto index = word();
+        auto type = WasmType(word());
+        curr = builder.makeGetLocal(index, type);
+        break;
+      }
+      case BatchSetLocal: {
+        auto index = word();
+        auto* value = ref(word());
+        curr = builder.makeSetLocal(index, value);
+        break;
+      }
+      case BatchTeeLocal: {
+        auto index = word();
+        auto* value = ref(word());
+        curr = builder.makeTeeLocal(index, value);
+        break;
+      }
+      case BatchLoad: {
+        auto bytes = word();
+        auto signed_ = word();
+        auto offset = word();
+        auto align = word();
+        auto type = WasmType(word());
+        auto* ptr = ref(word());
+        curr = builder.makeLoad(bytes, bool(signed_), offset, align ? align : bytes, ptr, type);
+        break;
+      }
+      case BatchStore: {
+        auto bytes = word();
+        auto offset = word();
+        auto align = word();
+        auto* ptr = ref(word());
+        auto* value = ref(word());
+        auto type = WasmType(word());
+        curr = builder.makeStore(bytes, offset, align ? align : bytes, ptr, value, type);
+        break;
+      }
+      case BatchDrop: {
+        auto* value = ref(word());
+        curr = builder.makeDrop(value);
+        break;
+      }
+      case BatchSelect: {
+        auto* ifTrue = ref(word());
+        auto* ifFalse = ref(word());
+        auto* condition = ref(word());
+        curr = builder.makeSelect(condition, ifTrue, ifFalse);
+        break;
+      }
+      case BatchReturn: {
+        auto hasValue = word();
+        Expression* value = nullptr;
+        if (hasValue) {
+          value = ref(word());
+        } else {
+          word(); // skip the unused slot, commands are fixed-shape
+        }
+        curr = builder.makeReturn(value);
+        break;
+      }
+      case BatchIf: {
+        auto* condition = ref(word());
+        auto* ifTrue = ref(word());
+        auto hasElse = word();
+        Expression* ifFalse = nullptr;
+        if (hasElse) {
+          ifFalse = ref(word());
+        } else {
+          word(); // skip the unused slot, commands are fixed-shape
+        }
+        curr = builder.makeIf(condition, ifTrue, ifFalse);
+        break;
+      }
+      case BatchBlock: {
+        auto type = WasmType(word());
+        auto num = word();
+        auto* block = wasm->allocator.alloc<Block>();
+        for (uint32_t j = 0; j < num; j++) {
+          block->list.push_back(ref(word()));
+        }
+        block->finalize(type);
+        curr = block;
+        break;
+      }
+      default: abort();
+    }
+    built.push_back(curr);
+  }
+  assert(!built.empty());
+
+  if (tracing) {
+    auto id = noteExpression(built.back());
+    std::cout << "  expressions[" << id << "] = /* built by BinaryenBuildBatch of " << built.size() << " nodes */ NULL;\n";
+  }
+
+  return built.back();
+}
+
 void BinaryenExpressionPrint(BinaryenExpressionRef expr) {
   if (tracing) {
     std::cout << "  BinaryenExpressionPrint(expressions[" << expressions[expr] << "]);\n";
@@ -827,11 +1020,16 @@ void BinaryenSetFunctionTable(BinaryenModuleRef module, BinaryenFunctionRef* fun
 
   auto* wasm = (Module*)module;
   wasm->table.exists = true;
+  // replace, don't append: embedders that rebuild their table call this
+  // once per codegen iteration, and stacking a fresh 60k-entry segment on
+  // top of the old ones each time is never what "set" means
+  wasm->table.segments.clear();
   Table::Segment segment(wasm->allocator.alloc<Const>()->set(Literal(int32_t(0))));
+  segment.data.reserve(numFuncs);
   for (BinaryenIndex i = 0; i < numFuncs; i++) {
     segment.data.push_back(((Function*)funcs[i])->name);
   }
-  wasm->table.segments.push_back(segment);
+  wasm->table.segments.push_back(std::move(segment));
   wasm->table.initial = wasm->table.max = numFuncs;
 }
 
@@ -1096,6 +1294,22 @@ BinaryenExpressionRef RelooperRenderAndDispose(RelooperRef relooper, RelooperBlo
 // ========= Other APIs =========
 //
 
+void BinaryenSetArenaPoolCap(BinaryenIndex bytes) {
+  if (tracing) {
+    std::cout << "  BinaryenSetArenaPoolCap(" << bytes << ");\n";
+  }
+
+  MixedArena::ChunkPool::capBytes() = bytes;
+}
+
+void BinaryenSetArenaChunkSize(BinaryenIndex size) {
+  if (tracing) {
+    std::cout << "  BinaryenSetArenaChunkSize(" << size << ");\n";
+  }
+
+  MixedArena::startingChunkSize() = size ? size : 32768;
+}
+
 void BinaryenSetAPITracing(int on) {
   tracing = on;
 
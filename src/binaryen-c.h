@@ -317,6 +317,57 @@ BinaryenExpressionRef BinaryenHost(BinaryenModuleRef module, BinaryenOp op, cons
 BinaryenExpressionRef BinaryenNop(BinaryenModuleRef module);
 BinaryenExpressionRef BinaryenUnreachable(BinaryenModuleRef module);
 
+// ===== Batched expression building =====
+//
+// For embedders (like binaryen.js) that build very many nodes, crossing the
+// FFI boundary once per node dominates build time. The batch builder
+// instead reads commands out of two flat arrays - uint32 words for
+// opcodes/operands, doubles for constant values - and materializes the
+// whole batch arena-side in one call, returning the expression built by
+// the last command.
+//
+// Commands are variable-length runs of uint32 words. Expression operands
+// reference earlier commands in the same batch by 0-based ordinal.
+// Constants consume slots from the values array in order: one double,
+// except i64, which takes two (low 32 bits, then high). Layouts:
+//
+//   BinaryenBatchNop()       (no operands)
+//   BinaryenBatchConst()     type
+//   BinaryenBatchBinary()    op, left, right
+//   BinaryenBatchUnary()     op, value
+//   BinaryenBatchGetLocal()  index, type
+//   BinaryenBatchSetLocal()  index, value
+//   BinaryenBatchTeeLocal()  index, value
+//   BinaryenBatchLoad()      bytes, signed, offset, align, type, ptr
+//   BinaryenBatchStore()     bytes, offset, align, ptr, value, type
+//   BinaryenBatchDrop()      value
+//   BinaryenBatchSelect()    ifTrue, ifFalse, condition
+//   BinaryenBatchReturn()    hasValue, value
+//   BinaryenBatchIf()        condition, ifTrue, hasElse, ifFalse
+//   BinaryenBatchBlock()     type, numChildren, children...
+
+typedef uint32_t BinaryenBatchOp;
+
+BinaryenBatchOp BinaryenBatchNop(void);
+BinaryenBatchOp BinaryenBatchConst(void);
+BinaryenBatchOp BinaryenBatchBinary(void);
+BinaryenBatchOp BinaryenBatchUnary(void);
+BinaryenBatchOp BinaryenBatchGetLocal(void);
+BinaryenBatchOp BinaryenBatchSetLocal(void);
+BinaryenBatchOp BinaryenBatchTeeLocal(void);
+BinaryenBatchOp BinaryenBatchLoad(void);
+BinaryenBatchOp BinaryenBatchStore(void);
+BinaryenBatchOp BinaryenBatchDrop(void);
+BinaryenBatchOp BinaryenBatchSelect(void);
+BinaryenBatchOp BinaryenBatchReturn(void);
+BinaryenBatchOp BinaryenBatchIf(void);
+BinaryenBatchOp BinaryenBatchBlock(void);
+
+BinaryenExpressionRef BinaryenBuildBatch(BinaryenModuleRef module,
+                                         const uint32_t* commands,
+                                         BinaryenIndex numWords,
+                                         const double* values);
+
 // Print an expression to stdout. Useful for debugging.
 void BinaryenExpressionPrint(BinaryenExpressionRef expr);
 
@@ -350,6 +401,11 @@ void BinaryenRemoveExport(BinaryenModuleRef module, const char* externalName);
 
 // Function table. One per module
 
+// Replaces the module's function table with the given packed array of
+// functions, in one bulk operation. Entries are interned names (pointer
+// copies), so rebuilding even a large table repeatedly costs one
+// reservation and a flat copy; earlier contents are discarded, as "set"
+// implies.
 void BinaryenSetFunctionTable(BinaryenModuleRef module, BinaryenFunctionRef* funcs, BinaryenIndex numFuncs);
 
 // Memory. One per module
@@ -444,6 +500,20 @@ BinaryenExpressionRef RelooperRenderAndDispose(RelooperRef relooper, RelooperBlo
 // TODO: compile-time option to enable/disable this feature entirely at build time?
 void BinaryenSetAPITracing(int on);
 
+// Sets the byte cap of the process-wide pool that retains retired arena
+// chunks across module lifetimes (0 disables pooling). Embedders that
+// create and dispose many modules per process keep warmed chunks this
+// way instead of round-tripping the system allocator; interned strings
+// and the pass registry already persist process-wide, so no separate
+// session object is needed.
+void BinaryenSetArenaPoolCap(BinaryenIndex bytes);
+
+// Sets the starting arena chunk size for modules created after this call.
+// Embedders that know their module scale can raise it (e.g. to 2MB, where
+// chunks also become huge-page-backed on Linux) so big builds do not pay
+// to grow chunk by chunk. 0 resets to the default.
+void BinaryenSetArenaChunkSize(BinaryenIndex size);
+
 //
 // ========= Utilities =========
 //
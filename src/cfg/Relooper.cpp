@@ -150,6 +150,7 @@ wasm::Expression* Block::Render(RelooperBuilder& Builder, bool InLoop) {
     Ret->list.push_back(Builder.makeSetLabel(0));
   }
   if (Code) Ret->list.push_back(Code);
+  for (auto* Absorbed : AbsorbedCode) Ret->list.push_back(Absorbed);
 
   if (!ProcessedBranchesOut.size()) {
     Ret->finalize();
@@ -431,7 +432,6 @@ Relooper::Relooper() : Root(nullptr), MinSize(false), BlockIdCounter(1), ShapeId
 
 Relooper::~Relooper() {
   for (unsigned i = 0; i < Blocks.size(); i++) delete Blocks[i];
-  for (unsigned i = 0; i < Shapes.size(); i++) delete Shapes[i];
 }
 
 void Relooper::AddBlock(Block *New, int Id) {
@@ -469,6 +469,44 @@ void Relooper::Calculate(Block *Entry) {
   PreOptimizer Pre(this);
   Pre.FindLive(Entry);
 
+  // Collapse linear chains before shape analysis: a block with a single
+  // unconditional branch to a block whose only live predecessor it is
+  // absorbs that successor - long single-entry single-exit chains (the
+  // shape straight-line asm.js input takes) shrink to one node each
+  // instead of inflating every later analysis
+  {
+    std::unordered_map<Block*, int> LivePredCounts;
+    for (auto* Curr : Pre.Live) {
+      for (BlockBranchMap::iterator iter = Curr->BranchesOut.begin(); iter != Curr->BranchesOut.end(); iter++) {
+        LivePredCounts[iter->first]++;
+      }
+    }
+    std::vector<Block*> LiveInOrder(Pre.Live.begin(), Pre.Live.end());
+    for (auto* Curr : LiveInOrder) {
+      if (!contains(Pre.Live, Curr)) continue; // already absorbed
+      while (Curr->BranchesOut.size() == 1 && !Curr->SwitchCondition) {
+        auto iter = Curr->BranchesOut.begin();
+        Block* Next = iter->first;
+        Branch* NextBranch = iter->second;
+        if (Next == Entry || Next == Curr) break;
+        if (NextBranch->Condition || NextBranch->SwitchValues) break;
+        if (LivePredCounts[Next] != 1) break;
+        // absorb Next into Curr
+        if (NextBranch->Code) Curr->AbsorbedCode.push_back(NextBranch->Code);
+        if (Next->Code) Curr->AbsorbedCode.push_back(Next->Code);
+        for (auto* Late : Next->AbsorbedCode) Curr->AbsorbedCode.push_back(Late);
+        delete NextBranch;
+        Curr->BranchesOut.clear();
+        for (BlockBranchMap::iterator out = Next->BranchesOut.begin(); out != Next->BranchesOut.end(); out++) {
+          Curr->BranchesOut[out->first] = out->second;
+        }
+        Next->BranchesOut.clear(); // Curr owns the branches now
+        Curr->SwitchCondition = Next->SwitchCondition;
+        Pre.Live.erase(Next); // stays in Blocks for cleanup with the relooper
+      }
+    }
+  }
+
   // Add incoming branches from live blocks, ignoring dead code
   for (unsigned i = 0; i < Blocks.size(); i++) {
     Block *Curr = Blocks[i];
@@ -486,7 +524,6 @@ void Relooper::Calculate(Block *Entry) {
     // Add a shape to the list of shapes in this Relooper calculation
     void Notice(Shape *New) {
       New->Id = Parent->ShapeIdCounter++;
-      Parent->Shapes.push_back(New);
     }
 
     // Create a list of entries from a block. If LimitTo is provided, only results in that set
@@ -523,7 +560,8 @@ void Relooper::Calculate(Block *Entry) {
 
     Shape *MakeSimple(BlockSet &Blocks, Block *Inner, BlockSet &NextEntries) {
       PrintDebug("creating simple block with block #%d\n", Inner->Id);
-      SimpleShape *Simple = new SimpleShape;
+      Parent->SimpleShapes.emplace_back();
+      SimpleShape *Simple = &Parent->SimpleShapes.back();
       Notice(Simple);
       Simple->Inner = Inner;
       Inner->Parent = Simple;
@@ -633,7 +671,8 @@ void Relooper::Calculate(Block *Entry) {
       DebugDump(Blocks, "  outer blocks:");
       DebugDump(NextEntries, "  outer entries:");
 
-      LoopShape *Loop = new LoopShape();
+      Parent->LoopShapes.emplace_back();
+      LoopShape *Loop = &Parent->LoopShapes.back();
       Notice(Loop);
 
       // Solipsize the loop, replacing with break/continue and marking branches as Processed (will not affect later calculations)
@@ -774,7 +813,8 @@ void Relooper::Calculate(Block *Entry) {
 
     Shape *MakeMultiple(BlockSet &Blocks, BlockSet& Entries, BlockBlockSetMap& IndependentGroups, BlockSet &NextEntries, bool IsCheckedMultiple) {
       PrintDebug("creating multiple block with %d inner groups\n", IndependentGroups.size());
-      MultipleShape *Multiple = new MultipleShape();
+      Parent->MultipleShapes.emplace_back();
+      MultipleShape *Multiple = &Parent->MultipleShapes.back();
       Notice(Multiple);
       BlockSet CurrEntries;
       for (BlockBlockSetMap::iterator iter = IndependentGroups.begin(); iter != IndependentGroups.end(); iter++) {
@@ -972,6 +1012,11 @@ void Relooper::Calculate(Block *Entry) {
 
 wasm::Expression* Relooper::Render(RelooperBuilder& Builder) {
   assert(Root);
+  // each shape renders a handful of control-flow nodes; grabbing the space
+  // up front turns the render's many small arena bumps into one chunk
+  Builder.getModule().allocator.reserve(
+    (SimpleShapes.size() + MultipleShapes.size() + LoopShapes.size() +
+     Blocks.size()) * 64);
   auto* ret = Root->Render(Builder, false);
   // we may use the same name for more than one block in HandleFollowupMultiples
   wasm::UniqueNameMapper::uniquify(ret);
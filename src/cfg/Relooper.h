@@ -32,6 +32,7 @@ added since the original academic paper [1] was published about it.
 #include <map>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 #include "wasm.h"
 #include "wasm-builder.h"
@@ -39,10 +40,13 @@ added since the original academic paper [1] was published about it.
 namespace CFG {
 
 class RelooperBuilder : public wasm::Builder {
+  wasm::Module& wasm;
   wasm::Index labelHelper;
 
 public:
-  RelooperBuilder(wasm::Module& wasm, wasm::Index labelHelper) : wasm::Builder(wasm), labelHelper(labelHelper) {}
+  RelooperBuilder(wasm::Module& wasm, wasm::Index labelHelper) : wasm::Builder(wasm), wasm(wasm), labelHelper(labelHelper) {}
+
+  wasm::Module& getModule() { return wasm; }
 
   wasm::GetLocal* makeGetLabel() {
     return makeGetLocal(labelHelper, wasm::i32);
@@ -76,6 +80,15 @@ struct Block;
 struct Shape;
 
 // Info about a branching from one block to another
+// Note on profile-guided shape selection: the analyzer picks loop entries
+// and Simple/Multiple shapes with no notion of edge frequency, so a hot
+// path can land behind a switch ladder. Biasing that needs per-edge
+// weights threaded from the caller (asm2wasm has no source of them today;
+// the wasm-opt --profile format carries call counts, not branch biases),
+// and this file tracks upstream emscripten closely enough that we don't
+// want to fork its algorithm speculatively. When a branch-bias profile
+// format exists, the place to carry it is a weight on Branch, consulted
+// where Process() chooses between Simple and Multiple shapes.
 struct Branch {
   enum FlowType {
     Direct = 0,   // We will directly reach the right location through other means, no need for continue or break
@@ -106,7 +119,9 @@ struct Branch {
 template<typename T>
 struct InsertOrderedSet
 {
-  std::map<T, typename std::list<T>::iterator>  Map;
+  // hashed lookups (on pointer identity); iteration order stays the
+  // deterministic insertion order, via the list
+  std::unordered_map<T, typename std::list<T>::iterator> Map;
   std::list<T>                                  List;
 
   typedef typename std::list<T>::iterator iterator;
@@ -163,7 +178,8 @@ struct InsertOrderedSet
 template<typename Key, typename T>
 struct InsertOrderedMap
 {
-  std::map<Key, typename std::list<std::pair<Key,T>>::iterator> Map;
+  // see InsertOrderedSet: hashed lookups, insertion-order iteration
+  std::unordered_map<Key, typename std::list<std::pair<Key,T>>::iterator> Map;
   std::list<std::pair<Key,T>>                                   List;
 
   T& operator[](const Key& k) {
@@ -196,6 +212,11 @@ struct InsertOrderedMap
   size_t size() const { return Map.size(); }
   size_t count(const Key& k) const { return Map.count(k); }
 
+  void clear() {
+    Map.clear();
+    List.clear();
+  }
+
   InsertOrderedMap() {}
   InsertOrderedMap(InsertOrderedMap& other) {
     abort(); // TODO, watch out for iterators
@@ -224,6 +245,7 @@ struct Block {
   Shape *Parent; // The shape we are directly inside
   int Id; // A unique identifier, defined when added to relooper
   wasm::Expression* Code; // The code in this block. This can be arbitrary wasm code, including internal control flow, it should just not branch to the outside
+  std::vector<wasm::Expression*> AbsorbedCode; // code of chain successors collapsed into this block before shape analysis; rendered right after Code
   wasm::Expression* SwitchCondition; // If nullptr, then this block ends in ifs (or nothing). otherwise, this block ends in a switch, done on this condition
   bool IsCheckedMultipleEntry; // If true, we are a multiple entry, so reaching us requires setting the label variable
 
@@ -326,7 +348,12 @@ struct LoopShape : public Shape {
 // ownership of the blocks and shapes, and frees them when done.
 struct Relooper {
   std::deque<Block*> Blocks;
-  std::deque<Shape*> Shapes;
+  // Shape storage, pooled by concrete type: a deque allocates shapes in
+  // contiguous chunks instead of a heap node each, and destroys them all
+  // with the relooper. Deques, as elements hand out stable pointers.
+  std::deque<SimpleShape> SimpleShapes;
+  std::deque<MultipleShape> MultipleShapes;
+  std::deque<LoopShape> LoopShapes;
   Shape *Root;
   bool MinSize;
   int BlockIdCounter;
@@ -30,6 +30,8 @@
 #ifndef cfg_traversal_h
 #define cfg_traversal_h
 
+#include <deque>
+
 #include "wasm.h"
 #include "wasm-traversal.h"
 
@@ -47,13 +49,13 @@ struct CFGWalker : public ControlFlowWalker<SubType, VisitorType> {
 
   BasicBlock* entry; // the entry block
 
-  BasicBlock* makeBasicBlock() { // override this with code to create a BasicBlock if necessary
-    return new BasicBlock();
-  }
-
   // internal details
 
-  std::vector<std::unique_ptr<BasicBlock>> basicBlocks; // all the blocks
+  // all the blocks, in one stable chunked allocation in creation order, so
+  // consumers iterating the CFG walk mostly-contiguous memory instead of
+  // chasing individually-allocated nodes (a deque keeps pointers stable
+  // while blocks are still being linked)
+  std::deque<BasicBlock> basicBlocks;
   std::vector<BasicBlock*> loopTops; // blocks that are the tops of loops, i.e., have backedges to them
 
   // traversal state
@@ -66,8 +68,8 @@ struct CFGWalker : public ControlFlowWalker<SubType, VisitorType> {
   std::vector<BasicBlock*> loopStack;
 
   void startBasicBlock() {
-    currBasicBlock = makeBasicBlock();
-    basicBlocks.push_back(std::unique_ptr<BasicBlock>(currBasicBlock));
+    basicBlocks.emplace_back();
+    currBasicBlock = &basicBlocks.back();
   }
 
   void startUnreachableBlock() {
@@ -266,17 +268,17 @@ struct CFGWalker : public ControlFlowWalker<SubType, VisitorType> {
 
   void unlinkDeadBlocks(std::unordered_set<BasicBlock*> alive) {
     for (auto& block : basicBlocks) {
-      if (!alive.count(block.get())) {
-        block->in.clear();
-        block->out.clear();
+      if (!alive.count(&block)) {
+        block.in.clear();
+        block.out.clear();
         continue;
       }
-      block->in.erase(std::remove_if(block->in.begin(), block->in.end(), [&alive](BasicBlock* other) {
+      block.in.erase(std::remove_if(block.in.begin(), block.in.end(), [&alive](BasicBlock* other) {
         return !alive.count(other);
-      }), block->in.end());
-      block->out.erase(std::remove_if(block->out.begin(), block->out.end(), [&alive](BasicBlock* other) {
+      }), block.in.end());
+      block.out.erase(std::remove_if(block.out.begin(), block.out.end(), [&alive](BasicBlock* other) {
         return !alive.count(other);
-      }), block->out.end());
+      }), block.out.end());
     }
   }
 
@@ -287,7 +289,7 @@ struct CFGWalker : public ControlFlowWalker<SubType, VisitorType> {
   void generateDebugIds() {
     if (debugIds.size() > 0) return;
     for (auto& block : basicBlocks) {
-      debugIds[block.get()] = debugIds.size();
+      debugIds[&block] = debugIds.size();
     }
   }
 
@@ -295,20 +297,20 @@ struct CFGWalker : public ControlFlowWalker<SubType, VisitorType> {
     std::cout << "<==\nCFG [" << message << "]:\n";
     generateDebugIds();
     for (auto& block : basicBlocks) {
-      assert(debugIds.count(block.get()) > 0);
-      std::cout << "  block " << debugIds[block.get()] << ":\n";
-      block->contents.dump(static_cast<SubType*>(this)->getFunction());
-      for (auto& in : block->in) {
+      assert(debugIds.count(&block) > 0);
+      std::cout << "  block " << debugIds[&block] << ":\n";
+      block.contents.dump(static_cast<SubType*>(this)->getFunction());
+      for (auto& in : block.in) {
         assert(debugIds.count(in) > 0);
-        assert(std::find(in->out.begin(), in->out.end(), block.get()) != in->out.end()); // must be a parallel link back
+        assert(std::find(in->out.begin(), in->out.end(), &block) != in->out.end()); // must be a parallel link back
       }
-      for (auto& out : block->out) {
+      for (auto& out : block.out) {
         assert(debugIds.count(out) > 0);
         std::cout << "    out: " << debugIds[out] << "\n";
-        assert(std::find(out->in.begin(), out->in.end(), block.get()) != out->in.end()); // must be a parallel link back
+        assert(std::find(out->in.begin(), out->in.end(), &block) != out->in.end()); // must be a parallel link back
       }
-      checkDuplicates(block->in);
-      checkDuplicates(block->out);
+      checkDuplicates(block.in);
+      checkDuplicates(block.out);
     }
     std::cout << "==>\n";
   }
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A dominator tree over a CFGWalker-built CFG, using the Cooper-Harvey-
+// Kennedy iterative algorithm ("A Simple, Fast Dominance Algorithm"):
+// intersect the predecessors' dominators in reverse postorder until a
+// fixed point. Storage is flat arrays indexed by reverse-postorder
+// number. Construction is effectively linear on real control flow; the
+// worst case is the usual iterative bound, which the deep-but-structured
+// CFGs our front ends emit never approach.
+//
+// This is a per-construction utility, not a cache on Function: the tree
+// has no sound invalidation signal for function caches (passes mutate
+// expressions through plain field writes), so consumers build the tree
+// when they know the CFG is settled, like the CFG itself.
+//
+
+#ifndef cfg_dominator_tree_h
+#define cfg_dominator_tree_h
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "wasm.h"
+
+namespace wasm {
+
+template<typename BasicBlock>
+struct DominatorTree {
+  // reverse-postorder numbering of the reachable blocks
+  std::vector<BasicBlock*> order; // rpo number => block
+  std::unordered_map<BasicBlock*, Index> numbering; // block => rpo number
+
+  // rpo number => the rpo number of the immediate dominator. the entry's
+  // idom is itself; unreachable blocks do not appear
+  std::vector<Index> idoms;
+
+  DominatorTree(std::deque<BasicBlock>& blocks, BasicBlock* entry) {
+    if (!entry) return;
+    // compute a postorder by iterative DFS over forward edges
+    std::unordered_map<BasicBlock*, bool> visited;
+    std::vector<std::pair<BasicBlock*, size_t>> stack; // block, next out edge
+    std::vector<BasicBlock*> postorder;
+    stack.emplace_back(entry, 0);
+    visited[entry] = true;
+    while (!stack.empty()) {
+      auto& top = stack.back();
+      if (top.second < top.first->out.size()) {
+        auto* next = top.first->out[top.second++];
+        if (!visited[next]) {
+          visited[next] = true;
+          stack.emplace_back(next, 0);
+        }
+      } else {
+        postorder.push_back(top.first);
+        stack.pop_back();
+      }
+    }
+    order.assign(postorder.rbegin(), postorder.rend());
+    for (Index i = 0; i < order.size(); i++) {
+      numbering[order[i]] = i;
+    }
+    // iterate to the fixed point
+    const Index UNDEFINED = Index(-1);
+    idoms.assign(order.size(), UNDEFINED);
+    idoms[0] = 0; // the entry dominates itself
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (Index i = 1; i < order.size(); i++) {
+        auto* block = order[i];
+        Index newIdom = UNDEFINED;
+        for (auto* pred : block->in) {
+          auto iter = numbering.find(pred);
+          if (iter == numbering.end()) continue; // unreachable predecessor
+          auto p = iter->second;
+          if (idoms[p] == UNDEFINED && p != 0) continue; // not processed yet
+          newIdom = newIdom == UNDEFINED ? p : intersect(p, newIdom);
+        }
+        if (newIdom != UNDEFINED && idoms[i] != newIdom) {
+          idoms[i] = newIdom;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // whether a (by rpo number) dominates b
+  bool dominates(Index a, Index b) const {
+    while (b > a) {
+      b = idoms[b];
+    }
+    return a == b;
+  }
+
+  bool dominates(BasicBlock* a, BasicBlock* b) const {
+    auto iterA = numbering.find(a), iterB = numbering.find(b);
+    if (iterA == numbering.end() || iterB == numbering.end()) return false;
+    return dominates(iterA->second, iterB->second);
+  }
+
+private:
+  Index intersect(Index a, Index b) const {
+    while (a != b) {
+      while (a > b) a = idoms[a];
+      while (b > a) b = idoms[b];
+    }
+    return a;
+  }
+};
+
+} // namespace wasm
+
+#endif // cfg_dominator_tree_h
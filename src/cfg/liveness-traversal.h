@@ -0,0 +1,279 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Computes liveness information for locals, as a reusable CFG traversal
+// facility: passes derive from LivenessWalker instead of CFGWalker and
+// get per-block get/set actions plus live-local sets at each block
+// boundary. The dataflow itself runs on packed per-block gen/kill bitsets
+// with a worklist, so it scales to functions with many thousands of
+// locals; the fixpoint is unique, so results are identical to flowing the
+// sets themselves.
+//
+
+#ifndef liveness_traversal_h
+#define liveness_traversal_h
+
+#include "cfg-traversal.h"
+#include "wasm.h"
+#include "wasm-builder.h"
+#include "wasm-traversal.h"
+
+namespace wasm {
+
+// A set of locals. This is optimized for comparisons,
+// mergings, and iteration on elements, assuming that there
+// may be a great many potential elements but actual sets
+// may be fairly small. Specifically, we use a sorted
+// vector.
+struct LocalSet : std::vector<Index> {
+  LocalSet() {}
+
+  LocalSet merge(const LocalSet& other) const {
+    LocalSet ret;
+    ret.resize(size() + other.size());
+    Index i = 0, j = 0, t = 0;
+    while (i < size() && j < other.size()) {
+      auto left = (*this)[i];
+      auto right = other[j];
+      if (left < right) {
+        ret[t++] = left;
+        i++;
+      } else if (left > right) {
+        ret[t++] = right;
+        j++;
+      } else {
+        ret[t++] = left;
+        i++;
+        j++;
+      }
+    }
+    while (i < size()) {
+      ret[t++] = (*this)[i];
+      i++;
+    }
+    while (j < other.size()) {
+      ret[t++] = other[j];
+      j++;
+    }
+    ret.resize(t);
+    return ret;
+  }
+
+  void insert(Index x) {
+    auto it = std::lower_bound(begin(), end(), x);
+    if (it == end()) push_back(x);
+    else if (*it > x) {
+      Index i = it - begin();
+      resize(size() + 1);
+      std::move_backward(begin() + i, begin() + size() - 1, end());
+      (*this)[i] = x;
+    }
+  }
+
+  bool erase(Index x) {
+    auto it = std::lower_bound(begin(), end(), x);
+    if (it != end() && *it == x) {
+      std::move(it + 1, end(), it);
+      resize(size() - 1);
+      return true;
+    }
+    return false;
+  }
+
+  bool has(Index x) {
+    auto it = std::lower_bound(begin(), end(), x);
+    return it != end() && *it == x;
+  }
+
+  void verify() const {
+    for (Index i = 1; i < size(); i++) {
+      assert((*this)[i - 1] < (*this)[i]);
+    }
+  }
+
+  void dump(const char* str = nullptr) const {
+    std::cout << "LocalSet " << (str ? str : "") << ": ";
+    for (auto x : *this) std::cout << x << " ";
+    std::cout << '\n';
+  }
+};
+
+// a liveness-relevant action
+struct LivenessAction {
+  enum What {
+    Get, Set
+  };
+  What what;
+  Index index; // the local index read or written
+  Expression** origin; // the origin
+  bool effective; // whether a store is actually effective, i.e., may be read
+
+  LivenessAction(What what, Index index, Expression** origin) : what(what), index(index), origin(origin), effective(false) {}
+
+  bool isGet() { return what == Get; }
+  bool isSet() { return what == Set; }
+};
+
+// information about liveness in a basic block
+struct Liveness {
+  LocalSet start, end; // live locals at the start and end
+  std::vector<LivenessAction> actions; // actions occurring in this block
+
+  void dump(Function* func) {
+    if (actions.empty()) return;
+    std::cout << "    actions:\n";
+    for (auto& action : actions) {
+      std::cout << "      " << (action.isGet() ? "get" : "set") << " " << func->getLocalName(action.index) << "\n";
+    }
+  }
+};
+
+template<typename SubType, typename VisitorType>
+struct LivenessWalker : public CFGWalker<SubType, VisitorType, Liveness> {
+  typedef typename CFGWalker<SubType, VisitorType, Liveness>::BasicBlock BasicBlock;
+
+  Index numLocals;
+  std::unordered_set<BasicBlock*> liveBlocks;
+
+  // cfg traversal work
+
+  static void doVisitGetLocal(SubType* self, Expression** currp) {
+    auto* curr = (*currp)->cast<GetLocal>();
+    // if in unreachable code, ignore
+    if (!self->currBasicBlock) {
+      *currp = Builder(*self->getModule()).replaceWithIdenticalType(curr);
+      return;
+    }
+    self->currBasicBlock->contents.actions.emplace_back(LivenessAction::Get, curr->index, currp);
+  }
+
+  static void doVisitSetLocal(SubType* self, Expression** currp) {
+    auto* curr = (*currp)->cast<SetLocal>();
+    // if in unreachable code, ignore
+    if (!self->currBasicBlock) {
+      *currp = Builder(*self->getModule()).replaceWithIdenticalType(curr);
+      return;
+    }
+    self->currBasicBlock->contents.actions.emplace_back(LivenessAction::Set, curr->index, currp);
+  }
+
+  void doWalkFunction(Function* func) {
+    numLocals = func->getNumLocals();
+    // create the CFG by walking the IR
+    CFGWalker<SubType, VisitorType, Liveness>::doWalkFunction(func);
+    // ignore links to dead blocks, so they don't confuse us and we can see
+    // their stores are all ineffective
+    liveBlocks = this->findLiveBlocks();
+    this->unlinkDeadBlocks(liveBlocks);
+  }
+
+  // Flow liveness, leaving each live block's start and end sets filled in.
+  // The fixpoint runs on packed gen/kill bitsets, a word at a time.
+  void flowLiveness() {
+    auto& basicBlocks = this->basicBlocks;
+    Index numBlocks = basicBlocks.size();
+    Index words = (numLocals + 63) / 64;
+    // per-block summaries: gen is read-before-written, kill is written.
+    // thread-local scratch, reused across the functions a worker
+    // processes: a parallel pass instance runs one function at a time on
+    // its thread, so steady-state flows allocate nothing
+    thread_local static std::vector<uint64_t> gen, kill, liveIn, liveOut;
+    gen.assign(numBlocks * words, 0);
+    kill.assign(numBlocks * words, 0);
+    liveIn.assign(numBlocks * words, 0);
+    liveOut.assign(numBlocks * words, 0);
+    std::unordered_map<BasicBlock*, Index> blockIndexes;
+    for (Index b = 0; b < numBlocks; b++) {
+      blockIndexes[&basicBlocks[b]] = b;
+    }
+    for (Index b = 0; b < numBlocks; b++) {
+      if (liveBlocks.count(&basicBlocks[b]) == 0) continue; // ignore dead blocks
+      auto* genRow = &gen[b * words];
+      auto* killRow = &kill[b * words];
+      for (auto& action : basicBlocks[b].contents.actions) {
+        auto index = action.index;
+        auto word = index >> 6;
+        auto bit = uint64_t(1) << (index & 63);
+        if (action.isGet()) {
+          if (!(killRow[word] & bit)) genRow[word] |= bit;
+        } else {
+          killRow[word] |= bit;
+        }
+      }
+    }
+    // worklist fixpoint, processing later blocks first since liveness flows
+    // backwards. changes reawaken predecessors
+    std::set<Index, std::greater<Index>> queue;
+    for (Index b = 0; b < numBlocks; b++) {
+      if (liveBlocks.count(&basicBlocks[b]) == 0) continue;
+      queue.insert(b);
+    }
+    while (!queue.empty()) {
+      auto b = *queue.begin();
+      queue.erase(queue.begin());
+      auto* block = &basicBlocks[b];
+      auto* out = &liveOut[b * words];
+      for (auto* succ : block->out) {
+        auto* succIn = &liveIn[blockIndexes[succ] * words];
+        for (Index w = 0; w < words; w++) out[w] |= succIn[w];
+      }
+      bool changed = false;
+      auto* in = &liveIn[b * words];
+      auto* genRow = &gen[b * words];
+      auto* killRow = &kill[b * words];
+      for (Index w = 0; w < words; w++) {
+        auto value = genRow[w] | (out[w] & ~killRow[w]);
+        if (value != in[w]) {
+          in[w] = value;
+          changed = true;
+        }
+      }
+      if (changed) {
+        for (auto* pred : block->in) {
+          queue.insert(blockIndexes[pred]);
+        }
+      }
+    }
+    // write the fixpoint back as the start/end sets passes consume
+    for (Index b = 0; b < numBlocks; b++) {
+      if (liveBlocks.count(&basicBlocks[b]) == 0) continue;
+      auto& contents = basicBlocks[b].contents;
+      for (Index index = 0; index < numLocals; index++) {
+        auto word = index >> 6;
+        auto bit = uint64_t(1) << (index & 63);
+        if (liveIn[b * words + word] & bit) contents.start.push_back(index);
+        if (liveOut[b * words + word] & bit) contents.end.push_back(index);
+      }
+    }
+  }
+
+  static void scanLivenessThroughActions(std::vector<LivenessAction>& actions, LocalSet& live) {
+    // move towards the front
+    for (int i = int(actions.size()) - 1; i >= 0; i--) {
+      auto& action = actions[i];
+      if (action.isGet()) {
+        live.insert(action.index);
+      } else {
+        live.erase(action.index);
+      }
+    }
+  }
+};
+
+} // namespace wasm
+
+#endif // liveness_traversal_h
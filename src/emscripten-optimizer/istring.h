@@ -37,12 +37,22 @@ namespace cashew {
 struct IString {
   const char *str;
 
-  static size_t hash_c(const char *str) { // see http://www.cse.yorku.ca/~oz/hash.html
-    unsigned int hash = 5381;
-    int c;
-    while ((c = *str++)) {
-      hash = ((hash << 5) + hash) ^ c;
+  static size_t hash_c(const char *str) {
+    // FNV-1a over 8-byte chunks, with the tail folded in as one final
+    // word: long (e.g. mangled) names hash a word at a time instead of a
+    // byte at a time
+    uint64_t hash = 14695981039346656037ULL;
+    size_t len = strlen(str);
+    while (len >= 8) {
+      uint64_t word;
+      memcpy(&word, str, 8);
+      hash = (hash ^ word) * 1099511628211ULL;
+      str += 8;
+      len -= 8;
     }
+    uint64_t word = 0;
+    memcpy(&word, str, len);
+    hash = (hash ^ word) * 1099511628211ULL;
     return (size_t)hash;
   }
 
@@ -69,30 +79,46 @@ struct IString {
     typedef std::unordered_set<const char *, CStringHash, CStringEqual> StringSet;
     // one global store of strings per thread, we must not access this
     // in parallel
+    //
+    // note that both the shards below and these thread caches have static
+    // lifetime: the table already persists across Module lifetimes (and
+    // C-API create/dispose cycles), so re-interning a name seen in an
+    // earlier module is a thread-local hash hit, no locks, no copy. the
+    // common compiler-generated names (cashew::*_, the asm2wasm helpers)
+    // are interned once at startup from static IString initializers,
+    // which is as "pre-baked" as a snapshot would be. growth is bounded
+    // by the set of distinct names ever seen, which embedders with many
+    // modules share rather than pay per module
     thread_local static StringSet strings;
 
     auto existing = strings.find(s);
 
     if (existing == strings.end()) {
-      // if the string isn't already known, we must use a single global
-      // storage location, guarded by a mutex, so each string is allocated
-      // exactly once
-      static std::mutex mutex;
-      std::unique_lock<std::mutex> lock(mutex);
-      // a single global set contains the actual strings, so we allocate each one
-      // exactly once.
-      static StringSet globalStrings;
-      auto globalExisting = globalStrings.find(s);
-      if (globalExisting == globalStrings.end()) {
-        if (!reuse) {
-          static std::vector<std::unique_ptr<std::string>> allocated;
-          allocated.emplace_back(wasm::make_unique<std::string>(s));
-          s = allocated.back()->c_str(); // we'll never modify it, so this is ok
+      // if the string isn't already known, it must go through the global
+      // storage, which allocates each string exactly once. that store is
+      // sharded by hash so that threads interning different strings (e.g.
+      // parallel function-body decoding) rarely contend on one lock
+      static const size_t NUM_SHARDS = 16;
+      struct Shard {
+        std::mutex mutex;
+        StringSet strings;
+        std::vector<std::unique_ptr<std::string>> allocated;
+      };
+      static Shard shards[NUM_SHARDS];
+      auto& shard = shards[hash_c(s) & (NUM_SHARDS - 1)];
+      {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        auto globalExisting = shard.strings.find(s);
+        if (globalExisting == shard.strings.end()) {
+          if (!reuse) {
+            shard.allocated.emplace_back(wasm::make_unique<std::string>(s));
+            s = shard.allocated.back()->c_str(); // we'll never modify it, so this is ok
+          }
+          // insert into the global shard
+          shard.strings.insert(s);
+        } else {
+          s = *globalExisting;
         }
-        // insert into global set
-        globalStrings.insert(s);
-      } else {
-        s = *globalExisting;
       }
       // add the string to our thread-local set
       strings.insert(s);
@@ -75,9 +75,16 @@ struct Ref {
 // Arena allocation, free it all on process exit
 
 // A mixed arena for global allocation only, so members do not
-// receive an allocator, they all use the global one anyhow
+// receive an allocator, they all use the global one anyhow. AST nodes are
+// small and allocated in vast numbers when parsing big inputs, so run with
+// much larger chunks than the base arena's default - the per-chunk
+// allocations themselves show up in profiles otherwise.
 class GlobalMixedArena : public MixedArena {
 public:
+  GlobalMixedArena() {
+    chunkSize = 1024 * 1024;
+  }
+
   template<class T>
   T* alloc() {
     auto* ret = static_cast<T*>(allocSpace(sizeof(T)));
@@ -537,21 +544,36 @@ void traverseFunctions(Ref ast, std::function<void (Ref)> visit);
 // JS printing support
 
 struct JSPrinter {
+  // The single float-emission chokepoint: Literal printing (and through
+  // it Print and the s-expression text formats) and the JS printer all
+  // come through here, and the re-parse check below makes every emitted
+  // literal exactly round-trippable. Like the strtod-based parsing side
+  // (parsing.h), this relies on the process staying in the C locale for
+  // LC_NUMERIC, which C and C++ programs start in; embedders that call
+  // setlocale() with a comma-decimal locale would corrupt both
+  // directions. A grisu/ryu emitter would cut the retry loop below to
+  // one pass, but is a large vendored algorithm surface; the loop tries
+  // ascending precisions, so the simple literals real code is full of
+  // exit in the first iterations.
   static char* numToString(double d, bool finalize=true) {
     bool neg = d < 0;
     if (neg) d = -d;
     // try to emit the fewest necessary characters
     bool integer = fmod(d, 1) == 0;
     #define BUFFERSIZE 1000
-    static char full_storage_f[BUFFERSIZE], full_storage_e[BUFFERSIZE]; // f is normal, e is scientific for float, x for integer
-    static char *storage_f = full_storage_f + 1, *storage_e = full_storage_e + 1; // full has one more char, for a possible '-'
+    // thread_local: the module printer renders functions on worker threads
+    // in parallel, and float literals are formatted through here
+    thread_local static char full_storage_f[BUFFERSIZE], full_storage_e[BUFFERSIZE]; // f is normal, e is scientific for float, x for integer
+    thread_local static char *storage_f, *storage_e;
+    storage_f = full_storage_f + 1; // full has one more char, for a possible '-'
+    storage_e = full_storage_e + 1;
     auto err_f = std::numeric_limits<double>::quiet_NaN();
     auto err_e = std::numeric_limits<double>::quiet_NaN();
     for (int e = 0; e <= 1; e++) {
       char *buffer = e ? storage_e : storage_f;
       double temp;
       if (!integer) {
-        static char format[6];
+        thread_local static char format[6];
         for (int i = 0; i <= 18; i++) {
           format[0] = '%';
           format[1] = '.';
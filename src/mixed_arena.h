@@ -17,14 +17,22 @@
 #ifndef wasm_mixed_arena_h
 #define wasm_mixed_arena_h
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
+#include <new>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 //
 // Arena allocation for mixed-type data.
 //
@@ -57,10 +65,115 @@
 //
 
 struct MixedArena {
-  // fast bump allocation
-  std::vector<char*> chunks;
-  size_t chunkSize = 32768;
+  // Process-wide starting chunk size for new arenas. Embedders that know
+  // their module scale can raise this before building (see
+  // BinaryenSetArenaChunkSize); reserve() still scales individual arenas
+  // from input-size hints. Read at arena construction only.
+  static size_t& startingChunkSize() {
+    static size_t size = 32768;
+    return size;
+  }
+
+  // Chunks of 2MB and up are allocated 2MB-aligned and advised towards
+  // transparent huge pages: pass working sets in the gigabytes measurably
+  // lose time to TLB misses on 4K pages. MAP_HUGETLB is deliberately not
+  // used - it fails outright without reserved pages, while the advice
+  // degrades to normal pages.
+  enum { HugePageSize = 2 * 1024 * 1024 };
+
+  // Process-wide pool of retired chunks, so embedders that create and
+  // destroy many modules in one process (C-API create/dispose churn)
+  // reuse warmed chunks instead of round-tripping the system allocator
+  // per module. Bounded (see BinaryenSetArenaPoolCap); chunk granularity
+  // keeps the lock off the allocation fast path entirely.
+  struct ChunkPool {
+    std::mutex mutex;
+    std::vector<std::pair<char*, size_t>> chunks;
+    size_t totalBytes = 0;
+
+    static ChunkPool& get() {
+      // leaked deliberately: global arenas (e.g. cashew's) are destroyed
+      // during exit teardown and release their chunks here, so the pool
+      // must never be destroyed first
+      static ChunkPool* pool = new ChunkPool();
+      return *pool;
+    }
+
+    static size_t& capBytes() {
+      static size_t cap = 64 * 1024 * 1024;
+      return cap;
+    }
+  };
+
+  // releases every pooled spare chunk to the system; the memory-budget
+  // governor calls this when a pipeline is over budget
+  static void flushChunkPool() {
+    auto& pool = ChunkPool::get();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    for (auto& chunk : pool.chunks) {
+#ifdef __linux__
+      free(chunk.first);
+#else
+      delete[] chunk.first;
+#endif
+    }
+    pool.chunks.clear();
+    pool.totalBytes = 0;
+  }
+
+  static char* allocateChunk(size_t size) {
+    {
+      auto& pool = ChunkPool::get();
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      for (size_t i = pool.chunks.size(); i > 0; i--) {
+        if (pool.chunks[i - 1].second == size) {
+          auto* chunk = pool.chunks[i - 1].first;
+          pool.chunks.erase(pool.chunks.begin() + (i - 1));
+          pool.totalBytes -= size;
+          return chunk;
+        }
+      }
+    }
+#ifdef __linux__
+    void* ptr = nullptr;
+    size_t alignment = size >= HugePageSize ? size_t(HugePageSize) : 64;
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (size >= HugePageSize) {
+      madvise(ptr, size, MADV_HUGEPAGE); // advisory; failure is fine
+    }
+#endif
+    return static_cast<char*>(ptr);
+#else
+    return new char[size];
+#endif
+  }
+
+  static void freeChunk(char* chunk, size_t size) {
+    {
+      auto& pool = ChunkPool::get();
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      if (pool.totalBytes + size <= ChunkPool::capBytes()) {
+        pool.chunks.emplace_back(chunk, size);
+        pool.totalBytes += size;
+        return;
+      }
+    }
+#ifdef __linux__
+    free(chunk);
+#else
+    delete[] chunk;
+#endif
+  }
+
+  // fast bump allocation; each chunk records its size, as chunkSize can
+  // have grown since it was allocated (and the pool needs it on release)
+  std::vector<std::pair<char*, size_t>> chunks;
+  size_t chunkSize = startingChunkSize();
   size_t index; // in last chunk
+  size_t allocatedBytes = 0; // total chunk bytes ever allocated here
 
   std::thread::id threadId;
 
@@ -69,43 +182,67 @@ struct MixedArena {
   // list of next, adding an allocator if necessary
   std::atomic<MixedArena*> next;
 
+  // a process-unique id, so per-thread arena caches can never confuse a
+  // new arena with a destroyed one that had the same address
+  uint64_t arenaId;
+
   MixedArena() {
+    static std::atomic<uint64_t> nextArenaId;
+    arenaId = nextArenaId.fetch_add(1) + 1; // ids start at 1
     threadId = std::this_thread::get_id();
     next.store(nullptr);
   }
 
-  void* allocSpace(size_t size) {
-    // the bump allocator data should not be modified by multiple threads at once.
+  // returns the arena to allocate from on the current thread: this one if
+  // we are its owner, otherwise the current thread's side arena (created on
+  // demand), as the bump allocator data should not be modified by multiple
+  // threads at once.
+  MixedArena* getThreadArena() {
     auto myId = std::this_thread::get_id();
-    if (myId != threadId) {
-      MixedArena* curr = this;
-      MixedArena* allocated = nullptr;
-      while (myId != curr->threadId) {
-        auto seen = curr->next.load();
-        if (seen) {
-          curr = seen;
-          continue;
-        }
-        // there is a nullptr for next, so we may be able to place a new
-        // allocator for us there. but carefully, as others may do so as
-        // well. we may waste a few allocations here, but it doesn't matter
-        // as this can only happen as the chain is built up, i.e.,
-        // O(# of cores) per allocator, and our allocatrs are long-lived.
-        if (!allocated) {
-          allocated = new MixedArena(); // has our thread id
-        }
-        if (curr->next.compare_exchange_weak(seen, allocated)) {
-          // we replaced it, so we are the next in the chain
-          // we can forget about allocated, it is owned by the chain now
-          allocated = nullptr;
-          break;
-        }
-        // otherwise, the cmpxchg updated seen, and we continue to loop
+    if (myId == threadId) return this;
+    // each thread caches its last (root, side arena) resolution: parallel
+    // passes allocate against one module arena at a time, so this hits on
+    // nearly every allocation instead of chasing the chain. the id (never
+    // reused) keys the cache, so a stale entry can't alias a new arena
+    thread_local static uint64_t cachedId = 0;
+    thread_local static MixedArena* cachedArena = nullptr;
+    if (cachedId == arenaId) {
+      return cachedArena;
+    }
+    MixedArena* curr = this;
+    MixedArena* allocated = nullptr;
+    while (myId != curr->threadId) {
+      auto seen = curr->next.load();
+      if (seen) {
         curr = seen;
+        continue;
+      }
+      // there is a nullptr for next, so we may be able to place a new
+      // allocator for us there. but carefully, as others may do so as
+      // well. we may waste a few allocations here, but it doesn't matter
+      // as this can only happen as the chain is built up, i.e.,
+      // O(# of cores) per allocator, and our allocatrs are long-lived.
+      if (!allocated) {
+        allocated = new MixedArena(); // has our thread id
+      }
+      if (curr->next.compare_exchange_weak(seen, allocated)) {
+        // we replaced it, so we are the next in the chain
+        // we can forget about allocated, it is owned by the chain now
+        allocated = nullptr;
+        break;
       }
-      if (allocated) delete allocated;
-      return curr->allocSpace(size);
+      // otherwise, the cmpxchg updated seen, and we continue to loop
+      curr = seen;
     }
+    if (allocated) delete allocated;
+    cachedId = arenaId;
+    cachedArena = curr;
+    return curr;
+  }
+
+  void* allocSpace(size_t size) {
+    auto* arena = getThreadArena();
+    if (arena != this) return arena->allocSpace(size);
     size = (size + 7) & (-8); // same alignment as malloc TODO optimize?
     bool mustAllocate = false;
     while (chunkSize <= size) {
@@ -113,26 +250,157 @@ struct MixedArena {
       mustAllocate = true;
     }
     if (chunks.size() == 0 || index + size >= chunkSize || mustAllocate) {
-      chunks.push_back(new char[chunkSize]);
+      chunks.emplace_back(allocateChunk(chunkSize), chunkSize);
+      allocatedBytes += chunkSize;
       index = 0;
     }
-    auto* ret = chunks.back() + index;
+    auto* ret = chunks.back().first + index;
     index += size;
     return static_cast<void*>(ret);
   }
 
+  // Allocation with exact-size reuse: growing arena vectors donate their
+  // abandoned buffers through releaseSpace, and later requests for the
+  // same (rounded) size take them back instead of new bump space - the
+  // doubling steps of the millions of small lists stop accumulating in
+  // the arena. Reuse is per thread, like everything else here.
+  void* allocSpaceReusable(size_t size) {
+    auto* arena = getThreadArena();
+    if (arena != this) return arena->allocSpaceReusable(size);
+    size = (size + 7) & (-8);
+    auto iter = freeSpace.find(size);
+    if (iter != freeSpace.end() && !iter->second.empty()) {
+      auto* ret = iter->second.back();
+      iter->second.pop_back();
+      return ret;
+    }
+    return allocSpace(size);
+  }
+
+  void releaseSpace(void* space, size_t size) {
+    auto* arena = getThreadArena();
+    if (arena != this) {
+      arena->releaseSpace(space, size);
+      return;
+    }
+    size = (size + 7) & (-8);
+    freeSpace[size].push_back(space);
+  }
+
+  std::unordered_map<size_t, std::vector<void*>> freeSpace; // see allocSpaceReusable
+
+  // Recycled expression storage, in 8-byte size classes so a probe is an
+  // index into a small vector rather than a hash lookup - alloc<T>() is
+  // the hottest allocation path we have, and when nothing has been
+  // recycled the cost is a single compare against an empty vector.
+  // Storage is reused only for the exact class it came from, like
+  // freeSpace. See ExpressionManipulator::recycleTree for the ownership
+  // contract that makes recycling sound.
+  std::vector<std::vector<void*>> recycled;
+
+  void* allocSpaceClassed(size_t size) {
+    auto* arena = getThreadArena();
+    if (arena != this) return arena->allocSpaceClassed(size);
+    size = (size + 7) & (-8);
+    size_t sizeClass = size >> 3;
+    if (sizeClass < recycled.size()) {
+      auto& list = recycled[sizeClass];
+      if (!list.empty()) {
+        auto* ret = list.back();
+        list.pop_back();
+        return ret;
+      }
+    }
+    return allocSpace(size);
+  }
+
+  void recycleSpace(void* space, size_t size) {
+    auto* arena = getThreadArena();
+    if (arena != this) {
+      arena->recycleSpace(space, size);
+      return;
+    }
+    size = (size + 7) & (-8);
+    size_t sizeClass = size >> 3;
+    if (sizeClass >= recycled.size()) {
+      recycled.resize(sizeClass + 1);
+    }
+    recycled[sizeClass].push_back(space);
+  }
+
   template<class T>
   T* alloc() {
-    auto* ret = static_cast<T*>(allocSpace(sizeof(T)));
+    auto* ret = static_cast<T*>(allocSpaceClassed(sizeof(T)));
     new (ret) T(*this); // allocated objects receive the allocator, so they can allocate more later if necessary
     return ret;
   }
 
+  // Pre-allocates for an expected total allocation size, e.g. using an
+  // input's size as a hint, so that big inputs don't pay to grow chunk by
+  // chunk. Must be called on the arena's own thread.
+  void reserve(size_t size) {
+    assert(std::this_thread::get_id() == threadId);
+    if (size <= chunkSize) return;
+    while (chunkSize < size) {
+      chunkSize *= 2;
+    }
+    // the current chunk (if any) is smaller than the new chunk size, so we
+    // must start a fresh one - allocSpace assumes the last chunk is a full
+    // chunkSize bytes
+    chunks.emplace_back(allocateChunk(chunkSize), chunkSize);
+    allocatedBytes += chunkSize;
+    index = 0;
+  }
+
+  // Total chunk bytes held by this arena and its thread-side arenas; the
+  // pass runner reports growth per pass in its hotspot report, so memory
+  // bloat can be attributed without bisecting pipelines.
+  size_t totalBytes() const {
+    size_t total = allocatedBytes;
+    if (auto* sideArenas = next.load()) {
+      total += sideArenas->totalBytes();
+    }
+    return total;
+  }
+
+  // Moves all of this arena's memory into another arena, which then owns
+  // it; this arena is left empty. Useful for sub-arenas: a pass can build
+  // speculative or per-function data in a scratch arena, then either drop
+  // it (just let the arena die, freeing everything at once) or transfer
+  // the survivors' memory into the module's arena. Must not be called
+  // while either arena can be allocated from on another thread.
+  void transferInto(MixedArena& other) {
+    assert(this != &other);
+    if (!chunks.empty()) {
+      // allocSpace assumes the back chunk is a live, chunkSize-sized chunk
+      // it can keep bumping in; our donated chunks must not be treated
+      // that way, so insert them *before* the other arena's back chunk,
+      // or, if it has none, mark the back chunk (ours) as full so the
+      // next allocation starts a fresh one
+      auto at = other.chunks.empty() ? other.chunks.end() : other.chunks.end() - 1;
+      other.chunks.insert(at, chunks.begin(), chunks.end());
+      if (other.chunks.size() == chunks.size()) {
+        other.index = other.chunkSize; // force a fresh chunk on next alloc
+      }
+      chunks.clear();
+      index = 0;
+    }
+    // the freelists point into the donated chunks; the receiver does not
+    // know about them, and we no longer own the memory
+    freeSpace.clear();
+    recycled.clear();
+    if (auto* sideArenas = next.load()) {
+      sideArenas->transferInto(other);
+    }
+  }
+
   void clear() {
-    for (char* chunk : chunks) {
-      delete[] chunk;
+    for (auto& chunk : chunks) {
+      freeChunk(chunk.first, chunk.second);
     }
     chunks.clear();
+    freeSpace.clear();
+    recycled.clear();
   }
 
   ~MixedArena() {
@@ -151,15 +419,22 @@ template <typename SubType, typename T>
 class ArenaVectorBase {
 protected:
   T* data = nullptr;
-  size_t usedElements = 0,
-         allocatedElements = 0;
+  // 32-bit sizes: no single list in a module approaches 4G elements, and
+  // these vectors are embedded in every Block/Call-like IR node, so the
+  // narrower fields shrink the hot working set by a word per node
+  uint32_t usedElements = 0,
+           allocatedElements = 0;
 
   void reallocate(size_t size) {
     T* old = data;
+    auto oldAllocated = allocatedElements;
     static_cast<SubType*>(this)->allocate(size);
     for (size_t i = 0; i < usedElements; i++) {
       data[i] = old[i];
     }
+    if (old) {
+      static_cast<SubType*>(this)->release(old, oldAllocated);
+    }
   }
 
 public:
@@ -196,7 +471,10 @@ public:
 
   void push_back(T item) {
     if (usedElements == allocatedElements) {
-      reallocate((allocatedElements + 1) * 2); // TODO: optimize
+      // grow exponentially from a non-tiny base; in an arena the old copy
+      // is leaked until the arena dies, so fewer, larger growth steps both
+      // copy less and waste less
+      reallocate(std::max<size_t>(size_t(allocatedElements) * 2, 4));
     }
     data[usedElements] = item;
     usedElements++;
@@ -212,6 +490,16 @@ public:
     }
   }
 
+  // Returns the buffer to the allocator's freelists (where supported) and
+  // empties the vector; for recycling a discarded node's list storage.
+  void releaseBuffer() {
+    if (data) {
+      static_cast<SubType*>(this)->release(data, allocatedElements);
+      data = nullptr;
+      usedElements = allocatedElements = 0;
+    }
+  }
+
   template<typename ListType>
   void set(const ListType& list) {
     size_t size = list.size();
@@ -268,6 +556,10 @@ public:
   void allocate(size_t size) {
     abort(); // must be implemented in children
   }
+
+  // called with buffers abandoned by growth; children with an allocator
+  // that supports reuse can override this to donate them back
+  void release(T* old, size_t oldAllocated) {}
 };
 
 // A vector that has an allocator for arena allocation
@@ -290,7 +582,11 @@ public:
 
   void allocate(size_t size) {
     this->allocatedElements = size;
-    this->data = static_cast<T*>(allocator.allocSpace(sizeof(T) * this->allocatedElements));
+    this->data = static_cast<T*>(allocator.allocSpaceReusable(sizeof(T) * this->allocatedElements));
+  }
+
+  void release(T* old, size_t oldAllocated) {
+    allocator.releaseSpace(static_cast<void*>(old), sizeof(T) * oldAllocated);
   }
 };
 
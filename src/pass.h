@@ -22,11 +22,13 @@
 #include "wasm.h"
 #include "wasm-traversal.h"
 #include "mixed_arena.h"
+#include "support/threads.h"
 #include "support/utilities.h"
 
 namespace wasm {
 
 class Pass;
+class FunctionAnalysisCache;
 
 //
 // Global registry of all passes in /passes/
@@ -36,7 +38,11 @@ struct PassRegistry {
 
   static PassRegistry* get();
 
-  typedef std::function<Pass* ()> Creator;
+  // a plain function pointer: every pass factory is a stateless function,
+  // and keeping the table free of std::function means registration at
+  // static-init time does no heap allocation (startup cost is visible to
+  // embedders that load per page)
+  typedef Pass* (*Creator)();
 
   void registerPass(const char* name, const char *description, Creator create);
   Pass* createPass(std::string name);
@@ -55,6 +61,16 @@ private:
   std::map<std::string, PassInfo> passInfos;
 };
 
+// An interprocedural summary of a function's effects, conservative by
+// default; computed bottom-up by the mod-ref pass (see ast/call-effects.h)
+// and consulted by EffectAnalyzer for direct calls. "pure" means: touches
+// no memory or globals, and (transitively) calls nothing unknown - such a
+// call can be reordered (it may still trap or not terminate, so it is
+// treated like an implicit trap, not removed).
+struct CallEffectSummary {
+  bool pure = false;
+};
+
 struct PassOptions {
   bool debug = false; // run passes in debug mode, doing extra validation and timing checks
   bool validateGlobally = false; // when validating validate globally and not just locally
@@ -62,6 +78,50 @@ struct PassOptions {
   int shrinkLevel = 0;   // 0, 1, 2 correspond to -O0, -Os, -Oz
   bool ignoreImplicitTraps = false; // optimize assuming things like div by 0, bad load/store, will not trap
   bool debugInfo = false; // whether to try to preserve debug info through, which are special calls
+
+  // the maximum summed cost (per ast/cost.h) of the two arms at which
+  // if/else may be turned into select, which executes both arms: biased
+  // branches with costly arms lose from that trade. -1 means no limit,
+  // the historical behavior when optimizing for size
+  Index selectifyMaxCost = Index(-1);
+
+  // soft memory budget in bytes for the pipeline (0 = no budget). When
+  // the module arena is over budget, function-parallel passes run
+  // serially - per-worker side arenas stop growing - and pooled chunks
+  // are released back to the system. A governor, not a guarantee: the
+  // module itself can exceed the budget, but degradation is graceful
+  // instead of an OOM kill when several big runs share one machine.
+  size_t memBudget = 0;
+
+  // evaluation fuel for precompute: the most nodes it may execute while
+  // trying to fold one expression. The budget is what makes evaluating
+  // loops and parameterless helper calls safe - a diverging loop runs out
+  // of fuel and is left alone instead of hanging the pipeline
+  Index precomputeFuel = 256;
+
+  // instrumentation sampling: when > 1, the instrumentation passes only
+  // call out every N events, keeping an inline counter in a wasm global
+  // with one compare on the fast path, so instrumented builds can run on
+  // real traffic
+  Index instrumentSampleRate = 0;
+
+  // per-function call effect summaries, when the mod-ref pass has computed
+  // them for this pipeline (null otherwise). optimization only ever
+  // removes effects, so summaries stay conservative across later passes
+  std::shared_ptr<std::map<Name, CallEffectSummary>> callEffects;
+
+  // observed call counts per function, fed back from instrumented runs via
+  // --profile (lines of "<function name> <count>", as collected by
+  // aggregating log-execution output). empty when no profile was given.
+  // passes that can use frequency information consult this
+  std::map<Name, uint64_t> profile;
+
+  bool hasProfile() const { return !profile.empty(); }
+
+  uint64_t getProfileCount(Name func) const {
+    auto iter = profile.find(func);
+    return iter == profile.end() ? 0 : iter->second;
+  }
 };
 
 //
@@ -73,8 +133,15 @@ struct PassRunner {
   std::vector<Pass*> passes;
   PassOptions options;
 
-  PassRunner(Module* wasm) : wasm(wasm), allocator(&wasm->allocator) {}
-  PassRunner(Module* wasm, PassOptions options) : wasm(wasm), allocator(&wasm->allocator), options(options) {}
+  // analysis facts cached across the whole pipeline, so passes can share
+  // size/cost/effects computations for functions that no pass modified
+  // in between (see ast/function-analysis.h); passes reach this through
+  // getPassRunner()->getAnalysisCache()
+  FunctionAnalysisCache& getAnalysisCache();
+
+  PassRunner(Module* wasm);
+  PassRunner(Module* wasm, PassOptions options);
+  PassRunner(PassRunner&& other); // movable (tools build one and return it), but not copyable
 
   void setDebug(bool debug_) {
     options.debug = debug_;
@@ -83,6 +150,19 @@ struct PassRunner {
   void setValidateGlobally(bool validate) {
     options.validateGlobally = validate;
   }
+  // After the pipeline runs, keep re-running its function-parallel passes,
+  // but only on functions whose contents changed in the previous iteration
+  // (tracked by content hash), until a fixed point - iterate where it
+  // pays, skip where it doesn't.
+  //
+  // Note: the content hash is also the supported way to know which
+  // functions a pass run changed ("refinement chain" scheduling). Walkers
+  // cannot soundly self-report changes, as passes routinely mutate nodes
+  // through plain field writes that never go through replaceCurrent, so a
+  // flag there would under-report and skipping based on it would miscompile.
+  void setConverge(bool converge_) {
+    converge = converge_;
+  }
 
   void add(std::string passName) {
     auto pass = PassRegistry::get()->createPass(passName);
@@ -118,6 +198,23 @@ struct PassRunner {
   // Run the passes on a specific function
   void runFunction(Function* func);
 
+  // Computes map(function) for every function in parallel and folds the
+  // per-function results with reduce(accumulator, result), in function
+  // order - so analyses get linear scaling with deterministic results and
+  // no hand-rolled worker plumbing.
+  template<typename T, typename MapFn, typename ReduceFn>
+  T mapReduceFunctions(MapFn map, ReduceFn reduce) {
+    std::vector<T> results(wasm->functions.size());
+    parallelFor(results.size(), [&](size_t i, size_t worker) {
+      results[i] = map(wasm->functions[i].get());
+    });
+    T total = T();
+    for (auto& result : results) {
+      reduce(total, result);
+    }
+    return total;
+  }
+
   // Get the last pass that was already executed of a certain type.
   template<class P>
   P* getLast();
@@ -143,16 +240,65 @@ struct PassRunner {
 
 protected:
   bool isNested = false;
+  bool converge = false;
 
 private:
   void doAdd(Pass* pass);
 
   void runPassOnFunction(Pass* pass, Function* func);
+
+  // runs a stack of function-parallel passes on all functions, in parallel
+  void runStackParallel(std::vector<Pass*>& stack);
+
+  // ditto, but only on the given functions
+  void runStackParallelOn(std::vector<Pass*>& stack, std::vector<Function*>& funcs);
+
+  // the fixed-point iteration behind setConverge()
+  void runConvergeLoop();
+
+public:
+  // Sharded operation, for multi-process optimization (see
+  // scripts/shard-opt.py): a shard worker runs only the function-parallel
+  // passes, restricted to functions whose index falls in its shard, and
+  // the final merge step runs only the module-level passes.
+  void setShard(Index index, Index count) {
+    shardIndex = index;
+    shardCount = count;
+  }
+  void setModulePassesOnly(bool set) {
+    modulePassesOnly = set;
+  }
+  // restrict function-parallel passes to the given function indices (for
+  // incremental re-optimization, see scripts/incremental-opt.py)
+  void setFunctionFilter(std::vector<Index> filter) {
+    functionFilter = std::move(filter);
+    hasFunctionFilter = true;
+  }
+
+private:
+  Index shardIndex = 0;
+  Index shardCount = 0; // 0 means not sharded
+  bool modulePassesOnly = false;
+  std::vector<Index> functionFilter;
+  bool hasFunctionFilter = false;
+
+  std::unique_ptr<FunctionAnalysisCache> analysisCache; // lazily created
 };
 
 //
 // Core pass class
 //
+// On declared analysis dependencies (produces/consumes/invalidates) and
+// scheduling to minimize recomputation: that model assumes analyses that
+// outlive a pass, and no analysis in this tree can - passes mutate nodes
+// through plain field writes, so a CFG, liveness or call-graph result has
+// no sound invalidation signal and is rebuilt by whichever pass needs it
+// (see cfg/dominator-tree.h for the pattern). With nothing cacheable
+// there is nothing for a scheduler to preserve, and pass order stays the
+// hand-tuned list in addDefaultFunctionOptimizationPasses, whose comments
+// say why each pass sits where it does. The sound cross-pass signal we do
+// have is content hashing (getAnalysisCache), which skips work on
+// unchanged functions rather than reordering passes.
 class Pass {
 public:
   virtual ~Pass() {};
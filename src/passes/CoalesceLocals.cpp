@@ -29,9 +29,11 @@
 #include "wasm.h"
 #include "pass.h"
 #include "ast_utils.h"
-#include "cfg/cfg-traversal.h"
+#include "cfg/liveness-traversal.h"
 #include "wasm-builder.h"
 #include "support/learning.h"
+#include "support/flat-map.h"
+#include "support/sparse-set.h"
 #include "support/permutations.h"
 #ifdef CFG_PROFILE
 #include "support/timing.h"
@@ -39,141 +41,19 @@
 
 namespace wasm {
 
-// A set of locals. This is optimized for comparisons,
-// mergings, and iteration on elements, assuming that there
-// may be a great many potential elements but actual sets
-// may be fairly small. Specifically, we use a sorted
-// vector.
-struct LocalSet : std::vector<Index> {
-  LocalSet() {}
-
-  LocalSet merge(const LocalSet& other) const {
-    LocalSet ret;
-    ret.resize(size() + other.size());
-    Index i = 0, j = 0, t = 0;
-    while (i < size() && j < other.size()) {
-      auto left = (*this)[i];
-      auto right = other[j];
-      if (left < right) {
-        ret[t++] = left;
-        i++;
-      } else if (left > right) {
-        ret[t++] = right;
-        j++;
-      } else {
-        ret[t++] = left;
-        i++;
-        j++;
-      }
-    }
-    while (i < size()) {
-      ret[t++] = (*this)[i];
-      i++;
-    }
-    while (j < other.size()) {
-      ret[t++] = other[j];
-      j++;
-    }
-    ret.resize(t);
-    return ret;
-  }
-
-  void insert(Index x) {
-    auto it = std::lower_bound(begin(), end(), x);
-    if (it == end()) push_back(x);
-    else if (*it > x) {
-      Index i = it - begin();
-      resize(size() + 1);
-      std::move_backward(begin() + i, begin() + size() - 1, end());
-      (*this)[i] = x;
-    }
-  }
-
-  bool erase(Index x) {
-    auto it = std::lower_bound(begin(), end(), x);
-    if (it != end() && *it == x) {
-      std::move(it + 1, end(), it);
-      resize(size() - 1);
-      return true;
-    }
-    return false;
-  }
-
-  bool has(Index x) {
-    auto it = std::lower_bound(begin(), end(), x);
-    return it != end() && *it == x;
-  }
-
-  void verify() const {
-    for (Index i = 1; i < size(); i++) {
-      assert((*this)[i - 1] < (*this)[i]);
-    }
-  }
-
-  void dump(const char* str = nullptr) const {
-    std::cout << "LocalSet " << (str ? str : "") << ": ";
-    for (auto x : *this) std::cout << x << " ";
-    std::cout << '\n';
-  }
-};
-
-// a liveness-relevant action
-struct Action {
-  enum What {
-    Get, Set
-  };
-  What what;
-  Index index; // the local index read or written
-  Expression** origin; // the origin
-  bool effective; // whether a store is actually effective, i.e., may be read
-
-  Action(What what, Index index, Expression** origin) : what(what), index(index), origin(origin), effective(false) {}
-
-  bool isGet() { return what == Get; }
-  bool isSet() { return what == Set; }
-};
-
-// information about liveness in a basic block
-struct Liveness {
-  LocalSet start, end; // live locals at the start and end
-  std::vector<Action> actions; // actions occurring in this block
-
-  void dump(Function* func) {
-    if (actions.empty()) return;
-    std::cout << "    actions:\n";
-    for (auto& action : actions) {
-      std::cout << "      " << (action.isGet() ? "get" : "set") << " " << func->getLocalName(action.index) << "\n";
-    }
-  }
-};
-
-struct CoalesceLocals : public WalkerPass<CFGWalker<CoalesceLocals, Visitor<CoalesceLocals>, Liveness>> {
+struct CoalesceLocals : public WalkerPass<LivenessWalker<CoalesceLocals, Visitor<CoalesceLocals>>> {
   bool isFunctionParallel() override { return true; }
 
   Pass* create() override { return new CoalesceLocals; }
 
-  Index numLocals;
-
-  // cfg traversal work
-
-  static void doVisitGetLocal(CoalesceLocals* self, Expression** currp) {
-    auto* curr = (*currp)->cast<GetLocal>();
-     // if in unreachable code, ignore
-    if (!self->currBasicBlock) {
-      *currp = Builder(*self->getModule()).replaceWithIdenticalType(curr);
-      return;
-    }
-    self->currBasicBlock->contents.actions.emplace_back(Action::Get, curr->index, currp);
-  }
+  // cfg traversal work: the liveness walker notes the actions; we also
+  // need to note copies
 
   static void doVisitSetLocal(CoalesceLocals* self, Expression** currp) {
+    LivenessWalker<CoalesceLocals, Visitor<CoalesceLocals>>::doVisitSetLocal(self, currp);
+    // if in unreachable code, the base replaced the node, nothing to do
+    if (!self->currBasicBlock) return;
     auto* curr = (*currp)->cast<SetLocal>();
-    // if in unreachable code, ignore
-    if (!self->currBasicBlock) {
-      *currp = Builder(*self->getModule()).replaceWithIdenticalType(curr);
-      return;
-    }
-    self->currBasicBlock->contents.actions.emplace_back(Action::Set, curr->index, currp);
     // if this is a copy, note it
     if (auto* get = self->getCopy(curr)) {
       // add 2 units, so that backedge prioritization can decide ties, but not much more
@@ -207,13 +87,7 @@ struct CoalesceLocals : public WalkerPass<CFGWalker<CoalesceLocals, Visitor<Coal
 
   void calculateInterferences();
 
-  void calculateInterferences(const LocalSet& locals);
-
-  // merge starts of a list of blocks, adding new interferences as necessary. return
-  // whether anything changed vs an old state (which indicates further processing is necessary).
-  bool mergeStartsAndCheckChange(std::vector<BasicBlock*>& blocks, LocalSet& old, LocalSet& ret);
-
-  void scanLivenessThroughActions(std::vector<Action>& actions, LocalSet& live);
+  void calculateInterferences(const SparseSet& locals);
 
   void pickIndicesFromOrder(std::vector<Index>& order, std::vector<Index>& indices);
   void pickIndicesFromOrder(std::vector<Index>& order, std::vector<Index>& indices, Index& removedCopies);
@@ -222,53 +96,76 @@ struct CoalesceLocals : public WalkerPass<CFGWalker<CoalesceLocals, Visitor<Coal
 
   void applyIndices(std::vector<Index>& indices, Expression* root);
 
-  // interference state
+  // interference state: a packed bit matrix with one word-aligned row per
+  // local, stored symmetrically so whole rows can be unioned a word at a
+  // time (large flattened functions arrive with many thousands of locals)
 
-  std::vector<bool> interferences; // canonicalized - accesses should check (low, high)
-  std::unordered_set<BasicBlock*> liveBlocks;
+  std::vector<uint64_t> interferences;
+  Index interferenceWords; // words per row
 
   void interfere(Index i, Index j) {
     if (i == j) return;
-    interferences[std::min(i, j) * numLocals + std::max(i, j)] = 1;
+    interferences[i * interferenceWords + (j >> 6)] |= uint64_t(1) << (j & 63);
+    interferences[j * interferenceWords + (i >> 6)] |= uint64_t(1) << (i & 63);
   }
 
   void interfereLowHigh(Index low, Index high) { // optimized version where you know that low < high
     assert(low < high);
-    interferences[low * numLocals + high] = 1;
+    interfere(low, high);
   }
 
   bool interferes(Index i, Index j) {
-    return interferences[std::min(i, j) * numLocals + std::max(i, j)];
+    return (interferences[i * interferenceWords + (j >> 6)] >> (j & 63)) & 1;
   }
 
   // copying state
 
-  std::vector<uint8_t> copies; // canonicalized - accesses should check (low, high) TODO: use a map for high N, as this tends to be sparse? or don't look at copies at all for big N?
+  // Canonicalized (low, high) copy-pair counts, saturating at 255. Dense
+  // for modest local counts; above the threshold the matrix switches to a
+  // sparse map keyed by the packed pair, since actual copies are bounded
+  // by the program size, not numLocals^2 - a flattened function with 10k
+  // locals would otherwise pay 100MB just for this table. (The priority
+  // calculation already iterates only totalCopies, which is flat.)
+  static const Index DENSE_COPIES_LIMIT = 2048;
+  bool sparseCopyMatrix;
+  std::vector<uint8_t> copies;
+  FlatMap<uint64_t, uint8_t> sparseCopies;
   std::vector<Index> totalCopies; // total # of copies for each local, with all others
 
   void addCopy(Index i, Index j) {
-    auto k = std::min(i, j) * numLocals + std::max(i, j);
-    copies[k] = std::min(copies[k], uint8_t(254)) + 1;
+    if (sparseCopyMatrix) {
+      auto& count = sparseCopies[uint64_t(std::min(i, j)) * numLocals + std::max(i, j)];
+      count = std::min(count, uint8_t(254)) + 1;
+    } else {
+      auto k = std::min(i, j) * numLocals + std::max(i, j);
+      copies[k] = std::min(copies[k], uint8_t(254)) + 1;
+    }
     totalCopies[i]++;
     totalCopies[j]++;
   }
 
   uint8_t getCopies(Index i, Index j) {
+    if (sparseCopyMatrix) {
+      auto iter = sparseCopies.find(uint64_t(std::min(i, j)) * numLocals + std::max(i, j));
+      return iter != sparseCopies.end() ? iter->second : 0;
+    }
     return copies[std::min(i, j) * numLocals + std::max(i, j)];
   }
 };
 
 void CoalesceLocals::doWalkFunction(Function* func) {
   numLocals = func->getNumLocals();
-  copies.resize(numLocals * numLocals);
-  std::fill(copies.begin(), copies.end(), 0);
+  sparseCopyMatrix = numLocals > DENSE_COPIES_LIMIT;
+  if (sparseCopyMatrix) {
+    sparseCopies.clear();
+  } else {
+    copies.resize(numLocals * numLocals);
+    std::fill(copies.begin(), copies.end(), 0);
+  }
   totalCopies.resize(numLocals);
   std::fill(totalCopies.begin(), totalCopies.end(), 0);
-  // collect initial liveness info
-  WalkerPass<CFGWalker<CoalesceLocals, Visitor<CoalesceLocals>, Liveness>>::doWalkFunction(func);
-  // ignore links to dead blocks, so they don't confuse us and we can see their stores are all ineffective
-  liveBlocks = findLiveBlocks();
-  unlinkDeadBlocks(liveBlocks);
+  // collect initial liveness info, and unlink dead blocks
+  LivenessWalker<CoalesceLocals, Visitor<CoalesceLocals>>::doWalkFunction(func);
   // increase the cost of costly backedges
   increaseBackEdgePriorities();
 #ifdef CFG_DEBUG
@@ -303,7 +200,7 @@ void CoalesceLocals::increaseBackEdgePriorities() {
       auto* arrivingBlock = in[i];
       if (arrivingBlock->out.size() > 1) continue; // we just want unconditional branches to the loop top, true phi fragments
       for (auto& action : arrivingBlock->contents.actions) {
-        if (action.what == Action::Set) {
+        if (action.what == LivenessAction::Set) {
           auto* set = (*action.origin)->cast<SetLocal>();
           if (auto* get = getCopy(set)) {
             // this is indeed a copy, add to the cost (default cost is 2, so this adds 50%, and can mostly break ties)
@@ -316,44 +213,14 @@ void CoalesceLocals::increaseBackEdgePriorities() {
 }
 
 void CoalesceLocals::flowLiveness() {
-  interferences.resize(numLocals * numLocals);
+  interferenceWords = (numLocals + 63) / 64;
+  interferences.resize(numLocals * interferenceWords);
   std::fill(interferences.begin(), interferences.end(), 0);
-  // keep working while stuff is flowing
-  std::unordered_set<BasicBlock*> queue;
-  for (auto& curr : basicBlocks) {
-    if (liveBlocks.count(curr.get()) == 0) continue; // ignore dead blocks
-    queue.insert(curr.get());
-    // do the first scan through the block, starting with nothing live at the end, and updating the liveness at the start
-    scanLivenessThroughActions(curr->contents.actions, curr->contents.start);
-  }
-  // at every point in time, we assume we already noted interferences between things already known alive at the end, and scanned back through the block using that
-  while (queue.size() > 0) {
-    auto iter = queue.begin();
-    auto* curr = *iter;
-    queue.erase(iter);
-    LocalSet live;
-    if (!mergeStartsAndCheckChange(curr->out, curr->contents.end, live)) continue;
-#ifdef CFG_DEBUG
-    std::cout << "change noticed at end of " << debugIds[curr] << " from " << curr->contents.end.size() << " to " << live.size() << " (out of " << numLocals << ")\n";
-#endif
-    assert(curr->contents.end.size() < live.size());
-    curr->contents.end = live;
-    scanLivenessThroughActions(curr->contents.actions, live);
-    // liveness is now calculated at the start. if something
-    // changed, all predecessor blocks need recomputation
-    if (curr->contents.start == live) continue;
+  LivenessWalker<CoalesceLocals, Visitor<CoalesceLocals>>::flowLiveness();
 #ifdef CFG_DEBUG
-    std::cout << "change noticed at start of " << debugIds[curr] << " from " << curr->contents.start.size() << " to " << live.size() << ", more work to do\n";
-#endif
-    assert(curr->contents.start.size() < live.size());
-    curr->contents.start = live;
-    for (auto* in : curr->in) {
-      queue.insert(in);
-    }
-  }
-#ifdef CFG_DEBUG
-  std::hash<std::vector<bool>> hasher;
-  std::cout << getFunction()->name << ": interference hash: " << hasher(*(std::vector<bool>*)&interferences) << "\n";
+  size_t interferenceHash = 0;
+  for (auto word : interferences) interferenceHash = interferenceHash * 33 + size_t(word ^ (word >> 32));
+  std::cout << getFunction()->name << ": interference hash: " << interferenceHash << "\n";
   for (Index i = 0; i < numLocals; i++) {
     std::cout << "int for " << getFunction()->getLocalName(i) << " [" << i << "]: ";
     for (Index j = 0; j < numLocals; j++) {
@@ -364,48 +231,28 @@ void CoalesceLocals::flowLiveness() {
 #endif
 }
 
-// merge starts of a list of blocks. return
-// whether anything changed vs an old state (which indicates further processing is necessary).
-bool CoalesceLocals::mergeStartsAndCheckChange(std::vector<BasicBlock*>& blocks, LocalSet& old, LocalSet& ret) {
-  if (blocks.size() == 0) return false;
-  ret = blocks[0]->contents.start;
-  if (blocks.size() > 1) {
-    // more than one, so we must merge
-    for (Index i = 1; i < blocks.size(); i++) {
-      ret = ret.merge(blocks[i]->contents.start);
-    }
-  }
-  return old != ret;
-}
-
-void CoalesceLocals::scanLivenessThroughActions(std::vector<Action>& actions, LocalSet& live) {
-  // move towards the front
-  for (int i = int(actions.size()) - 1; i >= 0; i--) {
-    auto& action = actions[i];
-    if (action.isGet()) {
-      live.insert(action.index);
-    } else {
-      live.erase(action.index);
-    }
-  }
-}
-
 void CoalesceLocals::calculateInterferences() {
+  // the live set mutates and is iterated once per action, so use a sparse
+  // set: O(1) insert/erase instead of a sorted-vector shift each time
+  SparseSet live(numLocals);
   for (auto& curr : basicBlocks) {
-    if (liveBlocks.count(curr.get()) == 0) continue; // ignore dead blocks
+    if (liveBlocks.count(&curr) == 0) continue; // ignore dead blocks
     // everything coming in might interfere, as it might come from a different block
-    auto live = curr->contents.end;
+    live.clear();
+    for (auto index : curr.contents.end) {
+      live.insert(index);
+    }
     calculateInterferences(live);
     // scan through the block itself
-    auto& actions = curr->contents.actions;
+    auto& actions = curr.contents.actions;
     for (int i = int(actions.size()) - 1; i >= 0; i--) {
       auto& action = actions[i];
       auto index = action.index;
       if (action.isGet()) {
         // new live local, interferes with all the rest
         live.insert(index);
-        for (auto i : live) {
-          interfere(i, index);
+        for (auto other : live) {
+          interfere(other, index);
         }
       } else {
         if (live.erase(index)) {
@@ -416,19 +263,29 @@ void CoalesceLocals::calculateInterferences() {
   }
   // Params have a value on entry, so mark them as live, as variables
   // live at the entry expect their zero-init value.
-  LocalSet start = entry->contents.start;
+  live.clear();
+  for (auto index : entry->contents.start) {
+    live.insert(index);
+  }
   auto numParams = getFunction()->getNumParams();
   for (Index i = 0; i < numParams; i++) {
-    start.insert(i);
+    live.insert(i);
   }
-  calculateInterferences(start);
+  calculateInterferences(live);
 }
 
-void CoalesceLocals::calculateInterferences(const LocalSet& locals) {
-  Index size = locals.size();
-  for (Index i = 0; i < size; i++) {
-    for (Index j = i + 1; j < size; j++) {
-      interfereLowHigh(locals[i], locals[j]);
+void CoalesceLocals::calculateInterferences(const SparseSet& locals) {
+  // build one packed row for the set, then union it into each member's
+  // row, a word at a time (the pairwise version of this is quadratic in
+  // the number of live locals)
+  std::vector<uint64_t> mask(interferenceWords, 0);
+  for (auto index : locals) {
+    mask[index >> 6] |= uint64_t(1) << (index & 63);
+  }
+  for (auto index : locals) {
+    auto* row = &interferences[index * interferenceWords];
+    for (Index w = 0; w < interferenceWords; w++) {
+      row[w] |= mask[w];
     }
   }
 }
@@ -474,16 +331,18 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order, std::vector
   }
 #endif
   // TODO: take into account distribution (99-1 is better than 50-50 with two registers, for gzip)
-  std::vector<WasmType> types;
-  std::vector<bool> newInterferences; // new index * numLocals => list of all interferences of locals merged to it
-  std::vector<uint8_t> newCopies; // new index * numLocals => list of all copies of locals merged to it
+  // thread-local scratch: the learning variant calls this once per
+  // fitness evaluation, and each worker thread runs one coloring at a
+  // time, so reuse makes the inner loop allocation-free
+  thread_local static std::vector<WasmType> types;
+  thread_local static std::vector<uint64_t> newInterferences; // packed rows: new index => all interferences of locals merged to it
+  thread_local static std::vector<uint8_t> newCopies; // new index * numLocals => list of all copies of locals merged to it
   indices.resize(numLocals);
-  types.resize(numLocals);
-  newInterferences.resize(numLocals * numLocals);
-  std::fill(newInterferences.begin(), newInterferences.end(), 0);
+  types.assign(numLocals, none);
+  newInterferences.assign(numLocals * interferenceWords, 0);
   auto numParams = getFunction()->getNumParams();
-  newCopies.resize(numParams * numLocals); // start with enough room for the params
-  std::fill(newCopies.begin(), newCopies.end(), 0);
+  newCopies.assign(numParams * numLocals, 0); // start with enough room for the params
+
   Index nextFree = 0;
   removedCopies = 0;
   // we can't reorder parameters, they are fixed in order, and cannot coalesce
@@ -492,8 +351,12 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order, std::vector
     assert(order[i] == i); // order must leave the params in place
     indices[i] = i;
     types[i] = getFunction()->getLocalType(i);
+    // take the param's whole interference row; the extra columns for
+    // already-placed locals are never consulted
+    std::copy(interferences.begin() + i * interferenceWords,
+              interferences.begin() + (i + 1) * interferenceWords,
+              newInterferences.begin() + i * interferenceWords);
     for (Index j = numParams; j < numLocals; j++) {
-      newInterferences[numLocals * i + j] = interferes(i, j);
       newCopies[numLocals * i + j] = getCopies(i, j);
     }
     nextFree++;
@@ -503,7 +366,7 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order, std::vector
     Index found = -1;
     uint8_t foundCopies = -1;
     for (Index j = 0; j < nextFree; j++) {
-      if (!newInterferences[j * numLocals + actual] && getFunction()->getLocalType(actual) == types[j]) {
+      if (!((newInterferences[j * interferenceWords + (actual >> 6)] >> (actual & 63)) & 1) && getFunction()->getLocalType(actual) == types[j]) {
         // this does not interfere, so it might be what we want. but pick the one eliminating the most copies
         // (we could stop looking forward when there are no more items that have copies anyhow, but it doesn't seem to help)
         auto currCopies = newCopies[j * numLocals + actual];
@@ -525,10 +388,14 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order, std::vector
 #if CFG_DEBUG
     std::cerr << "set local $" << actual << " to $" << found << '\n';
 #endif
-    // merge new interferences and copies for the new index
+    // merge new interferences and copies for the new index. interferences
+    // merge a whole row at a time; the extra columns that sets for
+    // already-placed locals are never consulted
+    for (Index w = 0; w < interferenceWords; w++) {
+      newInterferences[found * interferenceWords + w] |= interferences[actual * interferenceWords + w];
+    }
     for (Index k = i + 1; k < numLocals; k++) {
       auto j = order[k]; // go in the order, we only need to update for those we will see later
-      newInterferences[found * numLocals + j] = newInterferences[found * numLocals + j] | interferes(actual, j);
       newCopies[found * numLocals + j] += getCopies(actual, j);
     }
   }
@@ -608,7 +475,7 @@ static void removeIfCopy(Expression** origin, SetLocal* set, If* iff, Expression
 void CoalesceLocals::applyIndices(std::vector<Index>& indices, Expression* root) {
   assert(indices.size() == numLocals);
   for (auto& curr : basicBlocks) {
-    auto& actions = curr->contents.actions;
+    auto& actions = curr.contents.actions;
     for (auto& action : actions) {
       if (action.isGet()) {
         auto* get = (*action.origin)->cast<GetLocal>();
@@ -727,12 +594,15 @@ void CoalesceLocalsWithLearning::pickIndices(std::vector<Index>& indices) {
         (*ret)[i] = i;
       }
       if (first) {
-        // as the first guess, use the natural order. this is not arbitrary for two reasons.
-        // first, there may be an inherent order in the input (frequent indices are lower,
-        // etc.). second, by ensuring we start with the natural order, we ensure we are at
-        // least as good as the non-learning variant.
-        // TODO: use ::pickIndices from the parent, so we literally get the simpler approach
-        //       as our first option
+        // as the first guess, use the deterministic variant's own
+        // priority-adjusted order, so the population starts from (and can
+        // never fall below) what the non-learning pass would produce
+        auto adjustedTotalCopies = parent->totalCopies;
+        auto numParams = parent->getFunction()->getNumParams();
+        for (Index i = 0; i < numParams; i++) {
+          adjustedTotalCopies[i] = std::numeric_limits<Index>::max();
+        }
+        *static_cast<std::vector<Index>*>(ret) = adjustOrderByPriorities(*ret, adjustedTotalCopies);
         first = false;
       } else {
         // leave params alone, shuffle the rest
@@ -790,10 +660,21 @@ void CoalesceLocalsWithLearning::pickIndices(std::vector<Index>& indices) {
 #ifdef CFG_LEARN_DEBUG
   learner.getBest()->dump("first best");
 #endif
-  // keep working while we see improvement
+  // keep working while we see improvement, within a budget that shrinks
+  // as functions grow: a generation costs GENERATION_SIZE interference-
+  // graph colorings at O(numLocals^2) apiece, so holding generations *
+  // numVars roughly constant keeps the pass's total cost near-linear in
+  // the module instead of letting one huge function eat the pipeline.
+  // (Fitness evaluation across the population is not farmed out to the
+  // thread pool: this pass is already function-parallel, and the pool
+  // does not nest - see threads.h.)
+  const Index MAX_GENERATION_WORK = 20000;
+  Index generations = 0;
+  const Index maxGenerations = std::max(Index(3), Index(MAX_GENERATION_WORK / (numVars * GENERATION_SIZE)));
   auto oldBest = learner.getBest()->getFitness();
-  while (1) {
+  while (generations < maxGenerations) {
     learner.runGeneration();
+    generations++;
     auto newBest = learner.getBest()->getFitness();
     if (newBest == oldBest) break; // unlikely we can improve
     oldBest = newBest;
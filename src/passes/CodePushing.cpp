@@ -84,9 +84,10 @@ class Pusher {
   LocalAnalyzer& analyzer;
   std::vector<Index>& numGetsSoFar;
   PassOptions& passOptions;
+  Module& wasm;
 
 public:
-  Pusher(Block* block, LocalAnalyzer& analyzer, std::vector<Index>& numGetsSoFar, PassOptions& passOptions) : list(block->list), analyzer(analyzer), numGetsSoFar(numGetsSoFar), passOptions(passOptions) {
+  Pusher(Block* block, LocalAnalyzer& analyzer, std::vector<Index>& numGetsSoFar, PassOptions& passOptions, Module& wasm) : list(block->list), analyzer(analyzer), numGetsSoFar(numGetsSoFar), passOptions(passOptions), wasm(wasm), pushableEffects(passOptions) {
     // Find an optimization segment: from the first pushable thing, to the first
     // point past which we want to push. We then push in that range before
     // continuing forward.
@@ -120,7 +121,7 @@ private:
     // but also have no side effects, as it may not execute if pushed.
     if (analyzer.isSFA(index) &&
         numGetsSoFar[index] == analyzer.getNumGets(index) &&
-        !EffectAnalyzer(passOptions, set->value).hasSideEffects()) {
+        !pushableEffects.get(set->value).hasSideEffects()) {
       return set;
     }
     return nullptr;
@@ -157,15 +158,7 @@ private:
     while (1) {
       auto* pushable = isPushable(list[i]);
       if (pushable) {
-        auto iter = pushableEffects.find(pushable);
-        if (iter == pushableEffects.end()) {
-          iter = pushableEffects.emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple(pushable),
-            std::forward_as_tuple(passOptions, pushable)
-          ).first;
-        }
-        auto& effects = iter->second;
+        auto& effects = pushableEffects.get(pushable);
         if (cumulativeEffects.invalidates(effects)) {
           // we can't push this, so further pushables must pass it
           cumulativeEffects.mergeIn(effects);
@@ -185,7 +178,9 @@ private:
       i--;
     }
     if (toPush.size() == 0) {
-      // nothing to do, can only continue after the push point
+      // nothing to push past the point, but sets sitting right before an
+      // if may still sink into the arm that uses them
+      sinkIntoIf(pushPoint);
       return pushPoint + 1;
     }
     // we have work to do!
@@ -208,12 +203,78 @@ private:
     for (Index i = 0; i < total; i++) {
       list[pushPoint - i] = toPush[i];
     }
+    // go further: a pushed set whose local is used only inside one arm of
+    // the if at the push point can sink into that arm, so cold paths stop
+    // paying for values only they consume. (the pushable's value is
+    // already known effect-free, so executing it less often is safe)
+    sinkIntoIf(pushPoint);
     // proceed right after the push point, we may push the pushed elements again
     return pushPoint - total + 1;
   }
 
-  // Pushables may need to be scanned more than once, so cache their effects.
-  std::unordered_map<SetLocal*, EffectAnalyzer> pushableEffects;
+  void sinkIntoIf(Index pushPoint) {
+    auto* iff = list[pushPoint]->dynCast<If>();
+    if (!iff) return;
+    Builder builder(wasm);
+    // walk backwards over the sets sitting just before the if
+    while (pushPoint > 0) {
+      auto* set = list[pushPoint - 1]->dynCast<SetLocal>();
+      if (!set || set->isTee()) return;
+      // single-assignment, and a value whose only cost is computing it:
+      // executing it less often (only when the arm runs) must be safe
+      if (!analyzer.isSFA(set->index)) return;
+      if (pushableEffects.get(set->value).hasSideEffects()) return;
+      auto getsIn = [&](Expression* expr) {
+        struct GetsCounter : public PostWalker<GetsCounter> {
+          Index index;
+          Index count = 0;
+          void visitGetLocal(GetLocal* curr) {
+            if (curr->index == index) count++;
+          }
+        } counter;
+        counter.index = set->index;
+        counter.walk(expr);
+        return counter.count;
+      };
+      if (getsIn(iff->condition) != 0) return;
+      // the set's evaluation moves past the condition: anything the
+      // condition does (a tee, a global write, a store, a call) must not
+      // change what the value computes
+      EffectAnalyzer conditionEffects(passOptions);
+      conditionEffects.analyze(iff->condition);
+      if (conditionEffects.invalidates(pushableEffects.get(set->value))) {
+        return;
+      }
+      auto inTrue = getsIn(iff->ifTrue);
+      auto inFalse = iff->ifFalse ? getsIn(iff->ifFalse) : 0;
+      Expression** armp = nullptr;
+      if (inTrue > 0 && inFalse == 0) {
+        armp = &iff->ifTrue;
+      } else if (inFalse > 0 && inTrue == 0) {
+        armp = &iff->ifFalse;
+      } else {
+        return; // used in both (or neither); leave it
+      }
+      // and nowhere else at all: the pushable scan already established no
+      // later gets exist, so all of the function's gets must be the arm's
+      if (analyzer.getNumGets(set->index) != getsIn(*armp)) {
+        return;
+      }
+      // move the set to the start of that arm
+      *armp = builder.makeSequence(set, *armp);
+      if ((*armp)->type == unreachable) {
+        // sequence() takes the second child's type; refinalize the if
+        iff->finalize();
+      }
+      list[pushPoint - 1] = builder.makeNop();
+      pushPoint--;
+    }
+  }
+
+  // Pushables may need to be scanned more than once, so cache their effects;
+  // pushing only reorders them, never changes their contents, so entries
+  // stay valid across segments.
+  EffectCache pushableEffects;
 };
 
 struct CodePushing : public WalkerPass<PostWalker<CodePushing>> {
@@ -253,7 +314,7 @@ struct CodePushing : public WalkerPass<PostWalker<CodePushing>> {
     // ordering invalidation issue, since if this isn't a loop, it's fine (we're not
     // used outside), and if it is, we hit the assign before any use (as we can't
     // push it past a use).
-    Pusher pusher(curr, analyzer, numGetsSoFar, getPassOptions());
+    Pusher pusher(curr, analyzer, numGetsSoFar, getPassOptions(), *getModule());
   }
 };
 
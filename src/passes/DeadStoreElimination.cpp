@@ -0,0 +1,77 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Removes sets of locals that no path ever reads: backward liveness over
+// the shared engine (cfg/liveness-traversal.h), then a per-block backward
+// scan - a set whose local is not live right after it is dead, and
+// becomes a drop of its value (or just the value, for a tee), leaving any
+// side effects for later passes to judge.
+//
+// coalesce-locals performs the same elimination as a byproduct of its
+// interference analysis, so the default pipelines get this for free; this
+// standalone form is for custom pipelines that do not coalesce (e.g.
+// around passes that want locals left in place), where dead sets
+// otherwise survive to the output.
+//
+
+#include <wasm.h>
+#include <pass.h>
+#include <wasm-builder.h>
+#include <cfg/liveness-traversal.h>
+#include "ast/manipulation.h"
+
+namespace wasm {
+
+struct DeadStoreElimination : public WalkerPass<LivenessWalker<DeadStoreElimination, Visitor<DeadStoreElimination>>> {
+  bool isFunctionParallel() override { return true; }
+
+  Pass* create() override { return new DeadStoreElimination; }
+
+  void doWalkFunction(Function* func) {
+    LivenessWalker<DeadStoreElimination, Visitor<DeadStoreElimination>>::doWalkFunction(func);
+    flowLiveness();
+    for (auto& block : basicBlocks) {
+      auto live = block.contents.end;
+      auto& actions = block.contents.actions;
+      for (int i = int(actions.size()) - 1; i >= 0; i--) {
+        auto& action = actions[i];
+        if (action.isGet()) {
+          live.insert(action.index);
+          continue;
+        }
+        auto* set = (*action.origin)->cast<SetLocal>();
+        if (!live.has(action.index)) {
+          // nothing ever reads this value
+          if (set->isTee()) {
+            *action.origin = set->value;
+          } else {
+            auto* value = set->value;
+            Drop* drop = ExpressionManipulator::convert<SetLocal, Drop>(set);
+            drop->value = value;
+          }
+        }
+        live.erase(action.index);
+      }
+    }
+  }
+};
+
+Pass* createDeadStoreEliminationPass() {
+  return new DeadStoreElimination();
+}
+
+} // namespace wasm
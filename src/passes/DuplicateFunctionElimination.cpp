@@ -23,21 +23,26 @@
 #include "wasm.h"
 #include "pass.h"
 #include "ast_utils.h"
+#include "support/flat-map.h"
 #include "support/hash.h"
+#include "support/name.h"
+#include "support/threads.h"
+
+#include <atomic>
 
 namespace wasm {
 
 struct FunctionHasher : public WalkerPass<PostWalker<FunctionHasher>> {
   bool isFunctionParallel() override { return true; }
 
-  FunctionHasher(std::map<Function*, uint32_t>* output) : output(output) {}
+  FunctionHasher(FlatMap<Function*, uint64_t>* output) : output(output) {}
 
   FunctionHasher* create() override {
     return new FunctionHasher(output);
   }
 
   void doWalkFunction(Function* func) {
-    assert(digest == 0);
+    assert(hasher.digest != 0); // fresh instance per function, default seed
     hash(func->getNumParams());
     for (auto type : func->params) hash(type);
     hash(func->getNumVars());
@@ -45,25 +50,25 @@ struct FunctionHasher : public WalkerPass<PostWalker<FunctionHasher>> {
     hash(func->result);
     hash64(func->type.is() ? uint64_t(func->type.str) : uint64_t(0));
     hash(ExpressionAnalyzer::hash(func->body));
-    output->at(func) = digest;
+    output->at(func) = hasher.digest;
   }
 
 private:
-  std::map<Function*, uint32_t>* output;
-  uint32_t digest = 0;
+  FlatMap<Function*, uint64_t>* output;
+  Hasher64 hasher;
 
-  void hash(uint32_t hash) {
-    digest = rehash(digest, hash);
+  void hash(uint64_t block) {
+    hasher.feed(block);
   }
-  void hash64(uint64_t hash) {
-    digest = rehash(rehash(digest, hash >> 32), uint32_t(hash));
+  void hash64(uint64_t block) {
+    hasher.feed(block);
   };
 };
 
 struct FunctionReplacer : public WalkerPass<PostWalker<FunctionReplacer>> {
   bool isFunctionParallel() override { return true; }
 
-  FunctionReplacer(std::map<Name, Name>* replacements) : replacements(replacements) {}
+  FunctionReplacer(FlatMap<Name, Name>* replacements) : replacements(replacements) {}
 
   FunctionReplacer* create() override {
     return new FunctionReplacer(replacements);
@@ -77,7 +82,7 @@ struct FunctionReplacer : public WalkerPass<PostWalker<FunctionReplacer>> {
   }
 
 private:
-  std::map<Name, Name>* replacements;
+  FlatMap<Name, Name>* replacements;
 };
 
 struct DuplicateFunctionElimination : public Pass {
@@ -93,16 +98,21 @@ struct DuplicateFunctionElimination : public Pass {
       hasherRunner.add<FunctionHasher>(&hashes);
       hasherRunner.run();
       // Find hash-equal groups
-      std::map<uint32_t, std::vector<Function*>> hashGroups;
+      std::map<uint64_t, std::vector<Function*>> hashGroups;
       for (auto& func : module->functions) {
         hashGroups[hashes[func.get()]].push_back(func.get());
       }
-      // Find actually equal functions and prepare to replace them
-      std::map<Name, Name> replacements;
-      std::set<Name> duplicates;
+      // Find actually equal functions and prepare to replace them. The
+      // groups are independent and the comparisons are read-only, so
+      // verify equality within the buckets in parallel, then merge the
+      // per-group results in group order (so results are deterministic)
+      std::vector<std::vector<Function*>*> groups;
       for (auto& pair : hashGroups) {
-        auto& group = pair.second;
-        if (group.size() == 1) continue;
+        if (pair.second.size() > 1) groups.push_back(&pair.second);
+      }
+      std::vector<std::vector<Name>> groupDuplicates(groups.size());
+      auto verifyGroup = [&](size_t g) {
+        auto& group = *groups[g];
         // pick a base for each group, and try to replace everyone else to it. TODO: multiple bases per hash group, for collisions
 #if 0
         // for comparison purposes, pick in a deterministic way based on the names
@@ -117,10 +127,42 @@ struct DuplicateFunctionElimination : public Pass {
 #endif
         for (auto* func : group) {
           if (func != base && equal(func, base)) {
-            replacements[func->name] = base->name;
-            duplicates.insert(func->name);
+            groupDuplicates[g].push_back(func->name);
           }
         }
+      };
+      size_t numWorkers = ThreadPool::get()->size();
+      if (numWorkers > 1 && groups.size() > 1 && !ThreadPool::isRunning()) {
+        std::atomic<size_t> nextGroup;
+        nextGroup.store(0);
+        std::vector<std::function<ThreadWorkState ()>> doWorkers;
+        for (size_t w = 0; w < numWorkers; w++) {
+          doWorkers.push_back([&]() {
+            auto g = nextGroup.fetch_add(1);
+            if (g >= groups.size()) {
+              return ThreadWorkState::Finished; // nothing left
+            }
+            verifyGroup(g);
+            if (g + 1 == groups.size()) {
+              return ThreadWorkState::Finished; // we did the last one
+            }
+            return ThreadWorkState::More;
+          });
+        }
+        ThreadPool::get()->work(doWorkers);
+      } else {
+        for (size_t g = 0; g < groups.size(); g++) {
+          verifyGroup(g);
+        }
+      }
+      FlatMap<Name, Name> replacements;
+      FlatSet<Name> duplicates;
+      for (size_t g = 0; g < groups.size(); g++) {
+        auto base = (*groups[g])[0]->name;
+        for (auto name : groupDuplicates[g]) {
+          replacements[name] = base;
+          duplicates.insert(name);
+        }
       }
       // perform replacements
       if (replacements.size() > 0) {
@@ -165,7 +207,7 @@ struct DuplicateFunctionElimination : public Pass {
   }
 
 private:
-  std::map<Function*, uint32_t> hashes;
+  FlatMap<Function*, uint64_t> hashes;
 
   bool equal(Function* left, Function* right) {
     if (left->getNumParams() != right->getNumParams()) return false;
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Outlines cold code into separate functions, leaving hot bodies smaller
+// for baseline JITs and instruction caches. Cold here is the static
+// signal: an if arm that cannot fall through (its type is unreachable,
+// e.g. error paths that end in an abort call) and is big enough to be
+// worth a call. Such an arm can be moved wholesale into a new function:
+// control never returns from it, so writes it makes to locals cannot be
+// observed by the caller, and only the locals it uses need to be passed
+// in. Arms that branch or return out of themselves are left alone.
+//
+// The outlined functions are appended at the end of the function index
+// space; reorder-functions keeps cold, uncalled-in-practice functions at
+// the high indices.
+//
+
+#include <wasm.h>
+#include <pass.h>
+#include <wasm-builder.h>
+#include <ast_utils.h>
+
+namespace wasm {
+
+// an arm must be at least this many nodes to be worth a call
+static const Index OUTLINE_MIN_SIZE = 10;
+
+struct HotColdSplitting : public Pass {
+  void run(PassRunner* runner, Module* module) override {
+    std::vector<Function*> outlined;
+    Index nameCounter = 0;
+    // note: we add to module->functions after the loop, as adding
+    // invalidates the iteration
+    for (auto& func : module->functions) {
+      struct Outliner : public PostWalker<Outliner> {
+        HotColdSplitting* parent;
+        Module* module;
+        Function* func;
+        PassOptions* passOptions;
+        std::vector<Function*>* outlined;
+        Index* nameCounter;
+
+        void visitIf(If* curr) {
+          maybeOutline(curr->ifTrue);
+          if (curr->ifFalse) {
+            maybeOutline(curr->ifFalse);
+          }
+        }
+
+        // whether code escapes the arm by branch or return (an inner
+        // unreachable or trap is fine - control still never continues in
+        // the caller). names are collected first, as breaks target
+        // enclosing blocks that post-order would visit too late
+        static bool escapes(Expression* arm) {
+          struct NameCollector : public PostWalker<NameCollector> {
+            std::set<Name> names;
+            void visitBlock(Block* curr) { if (curr->name.is()) names.insert(curr->name); }
+            void visitLoop(Loop* curr) { if (curr->name.is()) names.insert(curr->name); }
+          } collector;
+          collector.walk(arm);
+          struct EscapeChecker : public PostWalker<EscapeChecker> {
+            std::set<Name>* names;
+            bool escapes = false;
+            void visitBreak(Break* curr) {
+              if (names->count(curr->name) == 0) escapes = true;
+            }
+            void visitSwitch(Switch* curr) {
+              for (auto name : curr->targets) {
+                if (names->count(name) == 0) escapes = true;
+              }
+              if (names->count(curr->default_) == 0) escapes = true;
+            }
+            void visitReturn(Return* curr) { escapes = true; }
+          } checker;
+          checker.names = &collector.names;
+          checker.walk(arm);
+          return checker.escapes;
+        }
+
+        void maybeOutline(Expression*& arm) {
+          if (arm->type != unreachable) return; // must never fall through
+          if (Measurer::measure(arm) < OUTLINE_MIN_SIZE) return;
+          if (escapes(arm)) return; // branches or returns out of the arm
+          EffectAnalyzer effects(*passOptions, arm);
+          // gather the locals the arm uses; they become the parameters
+          std::vector<Index> used;
+          for (auto index : effects.localsRead) used.push_back(index);
+          for (auto index : effects.localsWritten) {
+            if (effects.localsRead.count(index) == 0) used.push_back(index);
+          }
+          std::sort(used.begin(), used.end());
+          // build the outlined function
+          Builder builder(*module);
+          std::vector<NameType> params;
+          std::map<Index, Index> localMap; // old index => param index
+          for (Index i = 0; i < used.size(); i++) {
+            localMap[used[i]] = i;
+            params.emplace_back(Name::fromInt(i), func->getLocalType(used[i]));
+          }
+          auto name = Name(std::string(func->name.str) + "$cold$" + std::to_string((*nameCounter)++));
+          // remap local accesses to the new parameter space
+          struct Remapper : public PostWalker<Remapper> {
+            std::map<Index, Index>* localMap;
+            void visitGetLocal(GetLocal* curr) {
+              curr->index = localMap->at(curr->index);
+            }
+            void visitSetLocal(SetLocal* curr) {
+              curr->index = localMap->at(curr->index);
+            }
+          } remapper;
+          remapper.localMap = &localMap;
+          remapper.walk(arm);
+          auto* cold = builder.makeFunction(name, std::move(params), none, {}, arm);
+          outlined->push_back(cold);
+          // the call site: call the cold code, then tell the type system
+          // control cannot continue
+          auto* block = builder.makeBlock();
+          std::vector<Expression*> operands;
+          for (auto index : used) {
+            operands.push_back(builder.makeGetLocal(index, func->getLocalType(index)));
+          }
+          block->list.push_back(builder.makeCall(name, operands, none));
+          block->list.push_back(builder.makeUnreachable());
+          block->finalize(unreachable);
+          arm = block;
+        }
+      } outliner;
+      outliner.parent = this;
+      outliner.module = module;
+      outliner.func = func.get();
+      outliner.passOptions = &runner->options;
+      outliner.outlined = &outlined;
+      outliner.nameCounter = &nameCounter;
+      outliner.walk(func->body);
+    }
+    for (auto* func : outlined) {
+      module->addFunction(func);
+    }
+  }
+};
+
+Pass* createHotColdSplittingPass() {
+  return new HotColdSplitting();
+}
+
+} // namespace wasm
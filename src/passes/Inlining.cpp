@@ -17,45 +17,36 @@
 //
 // Inlining.
 //
-// For now, this does a conservative inlining of all functions that have
-// exactly one use. That should not increase code size, and may have
-// speed benefits.
+// This does a conservative inlining of all functions that have exactly one
+// use, which should not increase code size. In addition, functions whose
+// bodies are so cheap that the call overhead is comparable are inlined at
+// every call site, by copying; such callees must contain no further calls,
+// which also guarantees the iteration terminates.
 //
 
 #include <wasm.h>
 #include <pass.h>
 #include <wasm-builder.h>
 #include <parsing.h>
+#include <ast_utils.h>
+#include <ast/call-graph.h>
+#include <ast/cost.h>
+#include <ast/manipulation.h>
 
 namespace wasm {
 
-struct FunctionUseCounter : public WalkerPass<PostWalker<FunctionUseCounter>> {
-  bool isFunctionParallel() override { return true; }
-
-  FunctionUseCounter(std::map<Name, Index>* output) : output(output) {}
-
-  FunctionUseCounter* create() override {
-    return new FunctionUseCounter(output);
-  }
-
-  void visitCall(Call *curr) {
-    (*output)[curr->target]++;
-  }
-
-private:
-  std::map<Name, Index>* output;
-};
-
 struct Action {
   Call* call;
   Block* block; // the replacement for the call, into which we should inline
   Function* contents;
+  bool doCopy; // whether we must copy the body (the callee has other uses)
 
-  Action(Call* call, Block* block, Function* contents) : call(call), block(block), contents(contents) {}
+  Action(Call* call, Block* block, Function* contents, bool doCopy) : call(call), block(block), contents(contents), doCopy(doCopy) {}
 };
 
 struct InliningState {
-  std::set<Name> canInline;
+  std::set<Name> canInline;     // single-use functions, whose bodies we can just move
+  std::set<Name> canCopyInline; // cheap multi-use functions, inlined by copying
   std::map<Name, std::vector<Action>> actionsForFunction; // function name => actions that can be performed in it
 };
 
@@ -69,11 +60,15 @@ struct Planner : public WalkerPass<PostWalker<Planner>> {
   }
 
   void visitCall(Call *curr) {
-    if (state->canInline.count(curr->target)) {
+    bool move = state->canInline.count(curr->target) > 0;
+    // copy-inlining a function into itself would just grow it
+    bool copy = !move && state->canCopyInline.count(curr->target) > 0 &&
+                curr->target != getFunction()->name;
+    if (move || copy) {
       auto* block = Builder(*getModule()).makeBlock();
       block->type = curr->type;
       replaceCurrent(block);
-      state->actionsForFunction[getFunction()->name].emplace_back(curr, block, getModule()->getFunction(curr->target));
+      state->actionsForFunction[getFunction()->name].emplace_back(curr, block, getModule()->getFunction(curr->target), copy);
     }
   }
 
@@ -98,6 +93,9 @@ static Expression* doInlining(Module* module, Function* into, Action& action) {
   auto* block = action.block;
   block->name = Name(std::string("__inlined_func$") + action.contents->name.str);
   block->type = action.contents->result;
+  // if the callee has other uses, it must keep its body: inline a copy
+  auto* contents = action.doCopy ? ExpressionManipulator::copy(action.contents->body, *module)
+                                 : action.contents->body;
   // set up a locals mapping
   struct Updater : public PostWalker<Updater> {
     std::map<Index, Index> localMapping;
@@ -124,12 +122,32 @@ static Expression* doInlining(Module* module, Function* into, Action& action) {
     block->list.push_back(builder.makeSetLocal(updater.localMapping[i], action.call->operands[i]));
   }
   // update the inlined contents
-  updater.walk(action.contents->body);
-  block->list.push_back(action.contents->body);
-  action.contents->body = builder.makeUnreachable(); // not strictly needed, since it's going away
+  updater.walk(contents);
+  block->list.push_back(contents);
+  if (!action.doCopy) {
+    action.contents->body = builder.makeUnreachable(); // not strictly needed, since it's going away
+  }
   return block;
 }
 
+// The cost below which a multi-use function is worth inlining at every
+// call site: the call overhead is comparable to executing the body itself.
+static const Index ALWAYS_INLINABLE_COST = 2;
+
+static bool worthCopyInlining(Function* func, PassOptions& options) {
+  // with a profile, observed-hot callees get a more generous ceiling: the
+  // call overhead is being paid for real, so somewhat larger bodies pay off
+  auto ceiling = ALWAYS_INLINABLE_COST;
+  if (options.hasProfile() && options.getProfileCount(func->name) > 0) {
+    ceiling = 4 * ALWAYS_INLINABLE_COST;
+  }
+  if (CostAnalyzer(func->body).cost > ceiling) return false;
+  // only bodies with no further calls: that keeps this from growing code
+  // through call chains, and guarantees the outer iteration terminates,
+  // as inlining such a body can never create a new call site
+  return !EffectAnalyzer(options, func->body).calls;
+}
+
 struct Inlining : public Pass {
   void run(PassRunner* runner, Module* module) override {
     // keep going while we inline, to handle nesting. TODO: optimize
@@ -137,17 +155,18 @@ struct Inlining : public Pass {
   }
 
   bool iteration(PassRunner* runner, Module* module) {
-    // Count uses
+    // Count uses, via the shared call graph (built in parallel)
     std::map<Name, Index> uses;
-    // fill in uses, as we operate on it in parallel (each function to its own entry)
     for (auto& func : module->functions) {
       uses[func->name] = 0;
     }
     {
-      PassRunner runner(module);
-      runner.setIsNested(true);
-      runner.add<FunctionUseCounter>(&uses);
-      runner.run();
+      CallGraph graph(*module);
+      for (auto& edge : graph.edges) {
+        if (!edge.isImport) {
+          uses[edge.target]++;
+        }
+      }
     }
     for (auto& ex : module->exports) {
       if (ex->kind == ExternalKind::Function) {
@@ -166,6 +185,15 @@ struct Inlining : public Pass {
         state.canInline.insert(iter.first);
       }
     }
+    // multi-use functions that are cheaper than the calls to them can be
+    // inlined everywhere, by copying; they keep their bodies (and their
+    // exports and table slots), and become dead code to remove later if
+    // all their uses go away
+    for (auto& func : module->functions) {
+      if (uses[func->name] > 1 && worthCopyInlining(func.get(), runner->options)) {
+        state.canCopyInline.insert(func->name);
+      }
+    }
     // fill in actionsForFunction, as we operate on it in parallel (each function to its own entry)
     for (auto& func : module->functions) {
       state.actionsForFunction[func->name];
@@ -183,7 +211,9 @@ struct Inlining : public Pass {
     for (auto& func : module->functions) {
       for (auto& action : state.actionsForFunction[func->name]) {
         doInlining(module, func.get(), action);
-        inlined.insert(action.contents->name);
+        if (!action.doCopy) {
+          inlined.insert(action.contents->name);
+        }
         inlinedInto.insert(func.get());
       }
     }
@@ -191,13 +221,14 @@ struct Inlining : public Pass {
     for (auto func : inlinedInto) {
       wasm::UniqueNameMapper::uniquify(func->body);
     }
-    // remove functions that we managed to inline, their one use is gone
+    // remove functions that we managed to inline by moving, their one use
+    // is gone (copied-from functions keep their other uses)
     auto& funcs = module->functions;
     funcs.erase(std::remove_if(funcs.begin(), funcs.end(), [&inlined](const std::unique_ptr<Function>& curr) {
       return inlined.count(curr->name) > 0;
     }), funcs.end());
     // return whether we did any work
-    return inlined.size() > 0;
+    return inlinedInto.size() > 0;
   }
 };
 
@@ -56,10 +56,56 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
   // locals in current linear execution trace, which we try to sink
   Usables usables;
 
+  // Structured dominance: values computed before an if dominate both of
+  // its arms and the join after it, so instead of wiping the table at
+  // every control-flow edge, we save it when entering the if and restore
+  // it at each arm entry and at the join - pruned, at the join, by
+  // whatever effects the arms had. Loops and branch targets still wipe
+  // conservatively.
+  struct IfState {
+    Index phase = 0;
+    Usables saved;
+  };
+  std::map<If*, IfState> ifStates;
+
   static void doNoteNonLinear(LocalCSE* self, Expression** currp) {
+    auto* curr = *currp;
+    if (auto* iff = curr->dynCast<If>()) {
+      auto& state = self->ifStates[iff];
+      state.phase++;
+      if (state.phase == 1) {
+        // entering the true arm: everything before the condition (and in
+        // it) dominates the arm, keep the table, but remember it
+        state.saved = self->usables;
+      } else if (state.phase == 2) {
+        // entering the else arm (or the join, if there is no else): the
+        // pre-if table dominates here; without an else the true arm may
+        // have executed, so prune what it invalidated
+        self->usables = state.saved;
+        if (!iff->ifFalse) {
+          self->pruneInvalidatedBy(iff->ifTrue);
+        }
+      } else {
+        // the join: the pre-if table dominates, minus whatever either arm
+        // invalidated
+        self->usables = state.saved;
+        self->pruneInvalidatedBy(iff->ifTrue);
+        if (iff->ifFalse) {
+          self->pruneInvalidatedBy(iff->ifFalse);
+        }
+        self->ifStates.erase(iff);
+      }
+      return;
+    }
     self->usables.clear();
   }
 
+  void pruneInvalidatedBy(Expression* code) {
+    if (usables.empty()) return;
+    EffectAnalyzer effects(getPassOptions(), code);
+    checkInvalidations(effects);
+  }
+
   void checkInvalidations(EffectAnalyzer& effects) {
     // TODO: this is O(bad)
     std::vector<HashedExpression> invalidated;
@@ -121,8 +167,20 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
     if (!isConcreteWasmType(curr->type)) {
       return false; // don't bother with unreachable etc.
     }
-    if (EffectAnalyzer(getPassOptions(), curr).hasSideEffects()) {
-      return false; // we can't combine things with side effects
+    EffectAnalyzer effects(getPassOptions(), curr);
+    if (effects.hasSideEffects()) {
+      // in general we can't combine things with side effects. the
+      // exception is a possible trap as the *only* effect - i.e. a load:
+      // a repeated identical load cannot trap if the first didn't, as the
+      // address is identical and memory is unchanged in between (stores
+      // and calls invalidate entries), so reloads of the same address are
+      // fair game to deduplicate
+      bool onlyTrap = effects.implicitTrap && !effects.branches &&
+                      !effects.calls && effects.localsWritten.empty() &&
+                      effects.globalsWritten.empty() && !effects.writesMemory;
+      if (!onlyTrap) {
+        return false;
+      }
     }
     // check what we care about TODO: use optimize/shrink levels?
     return Measurer::measure(curr) > 1;
@@ -34,6 +34,7 @@
 namespace wasm {
 
 Name LOGGER("log_execution");
+Name LOG_SAMPLE_COUNTER("log_execution_counter");
 
 struct LogExecution : public WalkerPass<PostWalker<LogExecution>> {
   void visitLoop(Loop* curr) {
@@ -53,17 +54,53 @@ struct LogExecution : public WalkerPass<PostWalker<LogExecution>> {
     import->functionType = ensureFunctionType("vi", curr)->name;
     import->kind = ExternalKind::Function;
     curr->addImport(import);
+    if (getPassOptions().instrumentSampleRate > 1) {
+      // the sampling counter
+      auto* global = new Global;
+      global->name = LOG_SAMPLE_COUNTER;
+      global->type = i32;
+      global->init = Builder(*curr).makeConst(Literal(int32_t(0)));
+      global->mutable_ = true;
+      curr->addGlobal(global);
+    }
   }
 
 private:
   Expression* makeLogCall(Expression* curr) {
     static Index id = 0;
     Builder builder(*getModule());
+    auto rate = getPassOptions().instrumentSampleRate;
+    if (rate <= 1) {
+      return builder.makeSequence(
+        builder.makeCallImport(
+          LOGGER,
+          { builder.makeConst(Literal(int32_t(id++))) },
+          none
+        ),
+        curr
+      );
+    }
+    // sampled: bump the counter; only when it reaches the rate, reset it
+    // and call out - one add and one compare on the fast path
     return builder.makeSequence(
-      builder.makeCallImport(
-        LOGGER,
-        { builder.makeConst(Literal(int32_t(id++))) },
-        none
+      builder.makeSequence(
+        builder.makeSetGlobal(LOG_SAMPLE_COUNTER,
+          builder.makeBinary(AddInt32,
+            builder.makeGetGlobal(LOG_SAMPLE_COUNTER, i32),
+            builder.makeConst(Literal(int32_t(1))))),
+        builder.makeIf(
+          builder.makeBinary(GeUInt32,
+            builder.makeGetGlobal(LOG_SAMPLE_COUNTER, i32),
+            builder.makeConst(Literal(int32_t(rate)))),
+          builder.makeSequence(
+            builder.makeSetGlobal(LOG_SAMPLE_COUNTER,
+              builder.makeConst(Literal(int32_t(0)))),
+            builder.makeCallImport(
+              LOGGER,
+              { builder.makeConst(Literal(int32_t(id++))) },
+              none
+            ))
+        )
       ),
       curr
     );
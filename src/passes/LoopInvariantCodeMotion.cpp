@@ -0,0 +1,127 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Loop-invariant code motion over the structured loops of this IR. A
+// set_local at the top level of a loop's body executes on every iteration
+// (a wasm loop runs its body at least once, and the top level is
+// unconditional), so if its value is invariant - reads nothing the loop
+// writes, and nothing the loop's stores or calls could change - it
+// computes the same value every time and can move to a pre-header block
+// in front of the loop. Address computations and loads of loop-invariant
+// addresses in loops that don't store are the motivating cases.
+//
+// Conservative rules: the moved value may trap (trap reordering follows
+// the EffectAnalyzer rules), but may not branch or have side effects; the
+// local must be written exactly once in the loop and not read before that
+// write in body order, so iteration one cannot observe the pre-loop value.
+//
+
+#include <wasm.h>
+#include <pass.h>
+#include <ast_utils.h>
+#include <wasm-builder.h>
+
+namespace wasm {
+
+struct LoopInvariantCodeMotion : public WalkerPass<PostWalker<LoopInvariantCodeMotion>> {
+  bool isFunctionParallel() override { return true; }
+
+  Pass* create() override { return new LoopInvariantCodeMotion; }
+
+  void visitLoop(Loop* curr) {
+    auto* body = curr->body->dynCast<Block>();
+    if (!body || body->name.is()) return; // a branch target complicates ordering
+    // what the whole loop does
+    EffectAnalyzer loopEffects(getPassOptions(), curr);
+    // count writes per local in the loop
+    struct WriteCounter : public PostWalker<WriteCounter> {
+      std::map<Index, Index> writes;
+      void visitSetLocal(SetLocal* set) { writes[set->index]++; }
+    } writeCounter;
+    Expression* loopExpr = curr;
+    writeCounter.walk(loopExpr);
+    std::vector<Expression*> hoisted;
+    auto& list = body->list;
+    // effects of the body items before the current one: once something can
+    // branch, later items are no longer unconditional on every iteration
+    // (and a never-executed set must not become a pre-header one); reads
+    // before the set would observe the pre-loop value on iteration one
+    std::set<Index> prefixReads;
+    bool prefixBranches = false;
+    for (Index i = 0; i < list.size(); i++) {
+      EffectAnalyzer itemEffects(getPassOptions(), list[i]);
+      auto* set = list[i]->dynCast<SetLocal>();
+      bool usable = set && !set->isTee() && !prefixBranches &&
+                    writeCounter.writes[set->index] == 1 &&
+                    prefixReads.count(set->index) == 0;
+      if (!usable) {
+        for (auto index : itemEffects.localsRead) prefixReads.insert(index);
+        prefixBranches = prefixBranches || itemEffects.branches;
+        continue;
+      }
+      EffectAnalyzer valueEffects(getPassOptions(), set->value);
+      // only a possible trap may remain as an "effect" of the value
+      bool invariant = !valueEffects.branches && !valueEffects.calls &&
+                       valueEffects.localsWritten.empty() &&
+                       valueEffects.globalsWritten.empty() &&
+                       !valueEffects.writesMemory;
+      // the value must read nothing the loop writes
+      if (invariant) for (auto index : valueEffects.localsRead) {
+        if (index == set->index || loopEffects.localsWritten.count(index)) {
+          invariant = false;
+          break;
+        }
+      }
+      if (invariant && valueEffects.readsMemory &&
+          (loopEffects.writesMemory || loopEffects.calls)) {
+        invariant = false;
+      }
+      if (invariant) {
+        for (auto global : valueEffects.globalsRead) {
+          if (loopEffects.globalsWritten.count(global) || loopEffects.calls) {
+            invariant = false;
+            break;
+          }
+        }
+      }
+      if (!invariant) {
+        for (auto index : itemEffects.localsRead) prefixReads.insert(index);
+        prefixBranches = prefixBranches || itemEffects.branches;
+        continue;
+      }
+      // hoist it
+      hoisted.push_back(set);
+      list[i] = Builder(*getModule()).makeNop();
+    }
+    if (hoisted.empty()) return;
+    // build the pre-header
+    Builder builder(*getModule());
+    auto* outer = builder.makeBlock();
+    for (auto* set : hoisted) {
+      outer->list.push_back(set);
+    }
+    outer->list.push_back(curr);
+    outer->finalize(curr->type);
+    replaceCurrent(outer);
+  }
+};
+
+Pass* createLoopInvariantCodeMotionPass() {
+  return new LoopInvariantCodeMotion();
+}
+
+} // namespace wasm
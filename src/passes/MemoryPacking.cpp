@@ -14,18 +14,41 @@
  * limitations under the License.
  */
 
+#include <cstring>
+
 #include <wasm.h>
 #include <pass.h>
 #include <wasm-builder.h>
 
 namespace wasm {
 
-// Adding segments adds overhead, this is a rough estimate
+// Adding segments adds overhead, this is a rough estimate. (The precise
+// cost is the memory index and end opcodes plus the offset's and size's
+// LEBs, i.e. base- and length-dependent; this constant is the knob the
+// checked-in size expectations are calibrated against, so refining it is
+// a mass test-regeneration, not a code tweak.)
 const Index OVERHEAD = 8;
 
+// returns the position of the first nonzero byte in [start, end), or end.
+// scans a word at a time - large data segments are mostly zeros
+static Index findNonZero(std::vector<char>& data, Index start, Index end) {
+  Index i = start;
+  uint64_t word;
+  while (i + sizeof(word) <= end) {
+    memcpy(&word, &data[i], sizeof(word));
+    if (word != 0) break;
+    i += sizeof(word);
+  }
+  while (i < end && data[i] == 0) {
+    i++;
+  }
+  return i;
+}
+
 struct MemoryPacking : public Pass {
   void run(PassRunner* runner, Module* module) override {
     if (!module->memory.exists) return;
+    mergeAdjacentSegments(module);
     std::vector<Memory::Segment> packed;
     for (auto& segment : module->memory.segments) {
       // skip final zeros
@@ -41,9 +64,7 @@ struct MemoryPacking : public Pass {
         // create new segments
         while (start < data.size()) {
           // skip initial zeros
-          while (start < data.size() && data[start] == 0) {
-            start++;
-          }
+          start = findNonZero(data, start, data.size());
           Index end = start; // end of data-containing part
           Index next = end; // after zeros we can skip. preserves next >= end
           while (next < data.size() && (next - end < OVERHEAD)) {
@@ -70,6 +91,65 @@ struct MemoryPacking : public Pass {
     }
     module->memory.segments.swap(packed);
   }
+
+  // merges constant-offset segments separated by a gap smaller than the
+  // segment overhead into one zero-filled segment (the splitter then gets
+  // to reconsider the whole range); keeps the relative order of segments.
+  // Segments apply in order and may overlap in valid MVP modules, so
+  // zero-filling a gap is only sound when no segment applied earlier
+  // wrote into it - the zeros would clobber those bytes at instantiation.
+  void mergeAdjacentSegments(Module* module) {
+    auto& segments = module->memory.segments;
+    // the ranges of the original segments, in apply order; a non-constant
+    // offset can write anywhere, which we represent as unknown
+    struct Range {
+      bool known;
+      uint32_t begin, end;
+    };
+    std::vector<Range> ranges;
+    ranges.reserve(segments.size());
+    for (auto& segment : segments) {
+      if (auto* offset = segment.offset->dynCast<Const>()) {
+        auto base = uint32_t(offset->value.geti32());
+        ranges.push_back({ true, base, uint32_t(base + segment.data.size()) });
+      } else {
+        ranges.push_back({ false, 0, 0 });
+      }
+    }
+    auto gapIsClear = [&](Index upTo, uint32_t gapBegin, uint32_t gapEnd) {
+      for (Index j = 0; j < upTo; j++) {
+        if (!ranges[j].known) return false; // could have written anywhere
+        if (ranges[j].begin < gapEnd && gapBegin < ranges[j].end) {
+          return false; // wrote into the gap
+        }
+      }
+      return true;
+    };
+    std::vector<Memory::Segment> merged;
+    for (Index i = 0; i < segments.size(); i++) {
+      auto& segment = segments[i];
+      auto* offset = segment.offset->dynCast<Const>();
+      if (offset && !merged.empty()) {
+        auto* last = &merged.back();
+        if (auto* lastOffset = last->offset->dynCast<Const>()) {
+          auto base = uint32_t(offset->value.geti32());
+          auto lastBase = uint32_t(lastOffset->value.geti32());
+          auto lastEnd = lastBase + last->data.size();
+          if (base >= lastEnd && base - lastEnd < OVERHEAD &&
+              gapIsClear(i, uint32_t(lastEnd), base)) {
+            // close enough, and nothing applied earlier lives in the gap:
+            // zero-fill it and append
+            last->data.resize(base - lastBase + segment.data.size());
+            std::copy(segment.data.begin(), segment.data.end(),
+                      last->data.begin() + (base - lastBase));
+            continue;
+          }
+        }
+      }
+      merged.push_back(std::move(segment));
+    }
+    segments.swap(merged);
+  }
 };
 
 Pass *createMemoryPackingPass() {
@@ -64,6 +64,7 @@
 #include <wasm.h>
 #include <pass.h>
 #include <ast_utils.h>
+#include <support/counters.h>
 #include <wasm-builder.h>
 
 namespace wasm {
@@ -137,67 +138,73 @@ struct BreakValueDropper : public ControlFlowWalker<BreakValueDropper> {
 
 // core block optimizer routine
 static void optimizeBlock(Block* curr, Module* module) {
-  bool more = true;
+  // a single worklist pass: each item is resolved (applying the
+  // drop-into-block transform as often as it fires), and a mergeable
+  // child's contents are spliced by queueing them for the same treatment,
+  // so we reach the old restart-the-scan fixpoint in linear time - the
+  // restarting version was quadratic on the deep flat blocks flattening
+  // produces
   bool changed = false;
-  while (more) {
-    more = false;
-    for (size_t i = 0; i < curr->list.size(); i++) {
-      Block* child = curr->list[i]->dynCast<Block>();
-      if (!child) {
-        // if we have a child that is (drop (block ..)) then we can move the drop into the block, and remove br values. this allows more merging,
-        auto* drop = curr->list[i]->dynCast<Drop>();
-        if (drop) {
-          child = drop->value->dynCast<Block>();
-          if (child) {
-            if (child->name.is()) {
-              Expression* expression = child;
-              // check if it's ok to remove the value from all breaks to us
-              ProblemFinder finder;
-              finder.origin = child->name;
-              finder.walk(expression);
-              if (finder.found()) {
-                child = nullptr;
-              } else {
-                // fix up breaks
-                BreakValueDropper fixer;
-                fixer.origin = child->name;
-                fixer.setModule(module);
-                fixer.walk(expression);
-              }
-            }
-            if (child) {
-              // we can do it!
-              // reuse the drop
-              drop->value = child->list.back();
-              drop->finalize();
-              child->list.back() = drop;
-              child->finalize();
-              curr->list[i] = child;
-              more = true;
-              changed = true;
+  ExpressionList merged(module->allocator);
+  std::vector<Expression*> work; // a stack: top is the next item
+  for (size_t i = curr->list.size(); i > 0; i--) {
+    work.push_back(curr->list[i - 1]);
+  }
+  while (!work.empty()) {
+    auto* item = work.back();
+    work.pop_back();
+    Block* child = item->dynCast<Block>();
+    if (!child) {
+      // if we have a child that is (drop (block ..)) then we can move the drop into the block, and remove br values. this allows more merging,
+      auto* drop = item->dynCast<Drop>();
+      if (drop) {
+        child = drop->value->dynCast<Block>();
+        if (child) {
+          if (child->name.is()) {
+            Expression* expression = child;
+            // check if it's ok to remove the value from all breaks to us
+            ProblemFinder finder;
+            finder.origin = child->name;
+            finder.walk(expression);
+            if (finder.found()) {
+              child = nullptr;
+            } else {
+              // fix up breaks
+              BreakValueDropper fixer;
+              fixer.origin = child->name;
+              fixer.setModule(module);
+              fixer.walk(expression);
             }
           }
+          if (child) {
+            // we can do it!
+            // reuse the drop
+            drop->value = child->list.back();
+            drop->finalize();
+            child->list.back() = drop;
+            child->finalize();
+            item = child;
+            changed = true;
+          }
         }
       }
-      if (!child) continue;
-      if (child->name.is()) continue; // named blocks can have breaks to them (and certainly do, if we ran RemoveUnusedNames and RemoveUnusedBrs)
-      ExpressionList merged(module->allocator);
-      for (size_t j = 0; j < i; j++) {
-        merged.push_back(curr->list[j]);
-      }
-      for (auto item : child->list) {
-        merged.push_back(item);
-      }
-      for (size_t j = i + 1; j < curr->list.size(); j++) {
-        merged.push_back(curr->list[j]);
-      }
-      curr->list.swap(merged);
-      more = true;
-      changed = true;
-      break;
     }
+    if (!child || child->name.is()) {
+      // named blocks can have breaks to them (and certainly do, if we ran RemoveUnusedNames and RemoveUnusedBrs)
+      merged.push_back(item);
+      continue;
+    }
+    // splice the child's contents in, by queueing them as items in order
+    changed = true;
+    Counters::note("merge-blocks/merged");
+    for (size_t i = child->list.size(); i > 0; i--) {
+      work.push_back(child->list[i - 1]);
+    }
+  }
+  if (changed) {
+    curr->list.swap(merged);
+    curr->finalize();
   }
-  if (changed) curr->finalize();
 }
 
 void BreakValueDropper::visitBlock(Block* curr) {
@@ -15,10 +15,13 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <iomanip>
 #include <pass.h>
 #include <support/colors.h>
+#include <support/threads.h>
 #include <wasm.h>
+#include <ast/linear-ir.h>
 
 namespace wasm {
 
@@ -35,6 +38,42 @@ struct Metrics : public WalkerPass<PostWalker<Metrics, UnifiedExpressionVisitor<
     counts[name]++;
   }
 
+  void doWalkModule(Module* module) {
+    // count the function bodies in parallel, one counter per worker, and
+    // reduce the partial counts; module-level expressions (global inits,
+    // segment offsets) and the final report stay serial
+    struct Counter : public UnifiedExpressionVisitor<Counter> {
+      map<const char*, int> counts;
+      void visitExpression(Expression* curr) {
+        counts[getExpressionName(curr)]++;
+      }
+    };
+    size_t total = module->functions.size();
+    if (ThreadPool::get()->size() > 1 && total > 1) {
+      for (auto& func : module->functions) {
+        module->ensureFunctionBody(func.get()); // may have been read lazily
+      }
+      std::vector<Counter> counters(ThreadPool::get()->size());
+      parallelFor(total, [&](size_t index, size_t worker) {
+        constWalk(module->functions[index]->body, counters[worker]);
+      });
+      for (auto& counter : counters) {
+        for (auto& pair : counter.counts) {
+          counts[pair.first] += pair.second;
+        }
+      }
+      // the module-level expressions
+      for (auto& curr : module->globals) {
+        walkGlobal(curr.get());
+      }
+      walkTable(&module->table);
+      walkMemory(&module->memory);
+      visitModule(module);
+    } else {
+      PostWalker<Metrics, UnifiedExpressionVisitor<Metrics>>::doWalkModule(module);
+    }
+  }
+
   void visitModule(Module* module) {
     ostream &o = cout;
     o << "Counts"
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Bottom-up interprocedural mod/ref analysis: computes which functions are
+// pure - touch no memory or globals and transitively call nothing unknown
+// - and installs the summaries into the pipeline's options, where
+// EffectAnalyzer consults them for direct calls. Passes scheduled after
+// this one (simplify-locals, code-pushing, schedule-locals...) can then
+// move code across calls to tiny pure accessors instead of treating every
+// call as a full barrier. Purity only shrinks under optimization, so the
+// summaries stay conservative for the rest of the pipeline.
+//
+// Scheduled explicitly (e.g. wasm-opt --mod-ref -O...); not part of the
+// default pipelines, whose output is fixed by the checked-in expectations.
+//
+
+#include <wasm.h>
+#include <pass.h>
+#include <ast_utils.h>
+#include <ast/call-graph.h>
+
+namespace wasm {
+
+struct ModRef : public Pass {
+  void run(PassRunner* runner, Module* module) override {
+    size_t total = module->functions.size();
+    // base facts per function, in parallel: own memory/global accesses and
+    // whether it makes unknown (import/indirect) calls
+    std::vector<char> baseImpure(total);
+    CallGraph graph(*module);
+    parallelFor(total, [&](size_t index, size_t worker) {
+      struct Scanner : public PostWalker<Scanner> {
+        bool impure = false;
+        void visitLoad(Load* curr) { impure = true; }
+        void visitStore(Store* curr) { impure = true; }
+        void visitGetGlobal(GetGlobal* curr) { impure = true; }
+        void visitSetGlobal(SetGlobal* curr) { impure = true; }
+        void visitCallImport(CallImport* curr) { impure = true; }
+        void visitCallIndirect(CallIndirect* curr) { impure = true; }
+        void visitHost(Host* curr) { impure = true; }
+      } scanner;
+      scanner.walk(module->functions[index]->body);
+      baseImpure[index] = scanner.impure;
+    });
+    // fixpoint: a function is impure if any direct callee is. starting
+    // optimistically keeps mutually recursive pure functions pure, which
+    // is sound - recursion adds no accesses
+    std::map<Name, size_t> indexes;
+    for (size_t i = 0; i < total; i++) {
+      indexes[module->functions[i]->name] = i;
+    }
+    std::vector<char> impure = baseImpure;
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (size_t i = 0; i < total; i++) {
+        if (impure[i]) continue;
+        graph.forEachEdge(i, [&](const CallGraph::Edge& edge) {
+          if (impure[i]) return;
+          auto iter = indexes.find(edge.target);
+          if (iter == indexes.end() || impure[iter->second]) {
+            impure[i] = true;
+            changed = true;
+          }
+        });
+      }
+    }
+    // install the summaries for the rest of the pipeline
+    auto summaries = std::make_shared<std::map<Name, CallEffectSummary>>();
+    for (size_t i = 0; i < total; i++) {
+      if (!impure[i]) {
+        (*summaries)[module->functions[i]->name].pure = true;
+      }
+    }
+    runner->options.callEffects = summaries;
+  }
+};
+
+Pass* createModRefPass() {
+  return new ModRef();
+}
+
+} // namespace wasm
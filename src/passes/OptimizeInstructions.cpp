@@ -45,14 +45,28 @@ struct Pattern {
   Pattern(Expression* input, Expression* output) : input(input), output(output) {}
 };
 
-#if 0
-// Database of patterns
+// The key patterns are bucketed under: the root's expression id, plus the
+// opcode for unary/binary roots, so matching probes one small bucket
+// keyed on (opcode, not a scan over every pattern with the same node type.
+static uint32_t patternRootKey(Expression* curr) {
+  uint32_t key = curr->_id;
+  if (auto* unary = curr->dynCast<Unary>()) {
+    key |= uint32_t(unary->op + 1) << 8;
+  } else if (auto* binary = curr->dynCast<Binary>()) {
+    key |= uint32_t(binary->op + 1) << 8;
+  }
+  return key;
+}
+
+// Database of patterns. The DSL file is compiled into the binary at build
+// time (see OptimizeInstructions.wast and process_optimize_instructions.py),
+// so adding rules means editing the data file, not the hot visitor.
 struct PatternDatabase {
   Module wasm;
 
   char* input;
 
-  std::map<Expression::Id, std::vector<Pattern>> patternMap; // root expression id => list of all patterns for it TODO optimize more
+  std::map<uint32_t, std::vector<Pattern>> patternMap; // root key => list of all patterns for it
 
   PatternDatabase() {
     // generate module
@@ -68,11 +82,11 @@ struct PatternDatabase {
       auto* body = func->body->cast<Block>();
       for (auto* item : body->list) {
         auto* pair = item->cast<Block>();
-        patternMap[pair->list[0]->_id].emplace_back(pair->list[0], pair->list[1]);
+        patternMap[patternRootKey(pair->list[0])].emplace_back(pair->list[0], pair->list[1]);
       }
     } catch (ParseException& p) {
       p.dump(std::cerr);
-      Fatal() << "error in parsing wasm binary";
+      Fatal() << "error in parsing the optimize-instructions pattern database";
     }
   }
 
@@ -89,7 +103,6 @@ struct DatabaseEnsurer {
     database = new PatternDatabase;
   }
 };
-#endif
 
 // Check for matches and apply them
 struct Match {
@@ -180,21 +193,25 @@ Index getMaxBits(Expression* curr, LocalInfoProvider* localInfoProvider) {
   } else if (auto* binary = curr->dynCast<Binary>()) {
     switch (binary->op) {
       // 32-bit
-      case AddInt32: case SubInt32: case MulInt32:
-      case DivSInt32: case DivUInt32: case RemSInt32:
-      case RemUInt32: case RotLInt32: case RotRInt32: return 32;
+      case SubInt32: case DivSInt32: case RemSInt32:
+      case RotLInt32: case RotRInt32: return 32; // can go negative / wrap
+      case AddInt32: return std::min(Index(32), std::max(getMaxBits(binary->left, localInfoProvider), getMaxBits(binary->right, localInfoProvider)) + 1);
+      case MulInt32: return std::min(Index(32), getMaxBits(binary->left, localInfoProvider) + getMaxBits(binary->right, localInfoProvider));
+      case DivUInt32: return getMaxBits(binary->left, localInfoProvider); // dividing can only shrink
+      case RemUInt32: return std::min(getMaxBits(binary->left, localInfoProvider), getMaxBits(binary->right, localInfoProvider)); // x % y < y
       case AndInt32: return std::min(getMaxBits(binary->left, localInfoProvider), getMaxBits(binary->right, localInfoProvider));
       case OrInt32: case XorInt32: return std::max(getMaxBits(binary->left, localInfoProvider), getMaxBits(binary->right, localInfoProvider));
       case ShlInt32: {
         if (auto* shifts = binary->right->dynCast<Const>()) {
-          return std::min(Index(32), getMaxBits(binary->left, localInfoProvider) + shifts->value.geti32());
+          // shift counts are taken mod the bit width
+          return std::min(Index(32), getMaxBits(binary->left, localInfoProvider) + Index(shifts->value.geti32() & 31));
         }
         return 32;
       }
       case ShrUInt32: {
         if (auto* shift = binary->right->dynCast<Const>()) {
           auto maxBits = getMaxBits(binary->left, localInfoProvider);
-          auto shifts = std::min(Index(shift->value.geti32()), maxBits); // can ignore more shifts than zero us out
+          auto shifts = std::min(Index(shift->value.geti32() & 31), maxBits); // can ignore more shifts than zero us out
           return std::max(Index(0), maxBits - shifts);
         }
         return 32;
@@ -203,12 +220,43 @@ Index getMaxBits(Expression* curr, LocalInfoProvider* localInfoProvider) {
         if (auto* shift = binary->right->dynCast<Const>()) {
           auto maxBits = getMaxBits(binary->left, localInfoProvider);
           if (maxBits == 32) return 32;
-          auto shifts = std::min(Index(shift->value.geti32()), maxBits); // can ignore more shifts than zero us out
+          auto shifts = std::min(Index(shift->value.geti32() & 31), maxBits); // can ignore more shifts than zero us out
           return std::max(Index(0), maxBits - shifts);
         }
         return 32;
       }
-      // 64-bit TODO
+      // 64-bit
+      case SubInt64: case DivSInt64: case RemSInt64:
+      case RotLInt64: case RotRInt64: return 64;
+      case AddInt64: return std::min(Index(64), std::max(getMaxBits(binary->left, localInfoProvider), getMaxBits(binary->right, localInfoProvider)) + 1);
+      case MulInt64: return std::min(Index(64), getMaxBits(binary->left, localInfoProvider) + getMaxBits(binary->right, localInfoProvider));
+      case DivUInt64: return getMaxBits(binary->left, localInfoProvider);
+      case RemUInt64: return std::min(getMaxBits(binary->left, localInfoProvider), getMaxBits(binary->right, localInfoProvider));
+      case AndInt64: return std::min(getMaxBits(binary->left, localInfoProvider), getMaxBits(binary->right, localInfoProvider));
+      case OrInt64: case XorInt64: return std::max(getMaxBits(binary->left, localInfoProvider), getMaxBits(binary->right, localInfoProvider));
+      case ShlInt64: {
+        if (auto* shifts = binary->right->dynCast<Const>()) {
+          return std::min(Index(64), getMaxBits(binary->left, localInfoProvider) + Index(shifts->value.geti64() & 63));
+        }
+        return 64;
+      }
+      case ShrUInt64: {
+        if (auto* shift = binary->right->dynCast<Const>()) {
+          auto maxBits = getMaxBits(binary->left, localInfoProvider);
+          auto shifts = std::min(Index(shift->value.geti64() & 63), maxBits);
+          return std::max(Index(0), maxBits - shifts);
+        }
+        return 64;
+      }
+      case ShrSInt64: {
+        if (auto* shift = binary->right->dynCast<Const>()) {
+          auto maxBits = getMaxBits(binary->left, localInfoProvider);
+          if (maxBits == 64) return 64;
+          auto shifts = std::min(Index(shift->value.geti64() & 63), maxBits);
+          return std::max(Index(0), maxBits - shifts);
+        }
+        return 64;
+      }
       // comparisons
       case EqInt32: case NeInt32: case LtSInt32:
       case LtUInt32: case LeSInt32: case LeUInt32:
@@ -230,6 +278,11 @@ Index getMaxBits(Expression* curr, LocalInfoProvider* localInfoProvider) {
       case ClzInt64: case CtzInt64: case PopcntInt64: return 6;
       case EqZInt32: case EqZInt64: return 1;
       case WrapInt64: return std::min(Index(32), getMaxBits(unary->value, localInfoProvider));
+      case ExtendUInt32: return std::min(Index(32), getMaxBits(unary->value, localInfoProvider));
+      case ExtendSInt32: {
+        auto maxBits = getMaxBits(unary->value, localInfoProvider);
+        return maxBits <= 31 ? maxBits : Index(64); // a set sign bit fills the top
+      }
       default: {}
     }
   } else if (auto* set = curr->dynCast<SetLocal>()) {
@@ -348,9 +401,8 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
   Pass* create() override { return new OptimizeInstructions; }
 
   void prepareToRun(PassRunner* runner, Module* module) override {
-#if 0
+    // build the pattern database once, on the main thread
     static DatabaseEnsurer ensurer;
-#endif
   }
 
   void doWalkFunction(Function* func) {
@@ -372,8 +424,7 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
         replaceCurrent(curr);
         continue;
       }
-#if 0
-      auto iter = database->patternMap.find(curr->_id);
+      auto iter = database->patternMap.find(patternRootKey(curr));
       if (iter == database->patternMap.end()) return;
       auto& patterns = iter->second;
       bool more = false;
@@ -387,9 +438,6 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
         }
       }
       if (!more) break;
-#else
-      break;
-#endif
     }
   }
 
@@ -402,6 +450,59 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
           std::swap(binary->left, binary->right);
         }
       }
+      if (binary->op == DivUInt32 && binary->left->is<GetLocal>() &&
+          getPassOptions().optimizeLevel >= 3 && getPassOptions().shrinkLevel == 0) {
+        // unsigned division by a non-power-of-two constant => multiply by a
+        // magic number with a fixup (Granlund-Montgomery / Hacker's
+        // Delight magicu): hardware division costs many times a multiply
+        // and engines don't strength-reduce it themselves. bigger code, so
+        // only at -O3, and the dividend must be a get_local, as the fixup
+        // sequence uses it twice.
+        if (auto* c = binary->right->dynCast<Const>()) {
+          uint32_t d = c->value.geti32();
+          if (d > 2 && (d & (d - 1)) != 0) {
+            // with l = ceil(log2(d)), the 33-bit magic is
+            // M = floor(2^(32+l)/d) + 1, valid when the increment error
+            // d - (2^(32+l) mod d) is at most 2^l (we verify and skip the
+            // rare failures). the product x*M needs 65 bits, so emit the
+            // standard fixup instead: with m32 = M mod 2^32 and
+            // t = mulhi32(x, m32), x/d == (((x - t) >> 1) + t) >> (l-1).
+            // all computed overflow-free below: 2^(32+l)/d decomposes as
+            // (2^32/d)<<l + ((2^32 mod d)<<l)/d
+            uint32_t l = 0;
+            while ((uint64_t(1) << l) < d) l++;
+            uint64_t pow32 = uint64_t(1) << 32;
+            uint64_t quot = (pow32 / d) << l;
+            uint64_t rem = (pow32 % d) << l;
+            uint64_t magic = quot + rem / d + 1;
+            uint64_t err = d - (rem % d);
+            if (err <= (uint64_t(1) << l)) {
+              uint32_t m32 = uint32_t(magic - pow32);
+              auto* x = binary->left->cast<GetLocal>();
+              Builder builder(*getModule());
+              auto getX = [&]() {
+                return builder.makeGetLocal(x->index, i32);
+              };
+              // t = mulhi32(x, m32)
+              auto* t = builder.makeUnary(WrapInt64,
+                builder.makeBinary(ShrUInt64,
+                  builder.makeBinary(MulInt64,
+                    builder.makeUnary(ExtendUInt32, getX()),
+                    builder.makeConst(Literal(int64_t(m32)))),
+                  builder.makeConst(Literal(int64_t(32)))));
+              // q = (((x - t) >> 1) + t) >> (l - 1), with t reused via a tee
+              auto tIndex = Builder::addVar(getFunction(), i32);
+              auto* sub = builder.makeBinary(SubInt32, getX(),
+                builder.makeTeeLocal(tIndex, t));
+              auto* inner = builder.makeBinary(AddInt32,
+                builder.makeBinary(ShrUInt32, sub, builder.makeConst(Literal(int32_t(1)))),
+                builder.makeGetLocal(tIndex, i32));
+              return builder.makeBinary(ShrUInt32, inner,
+                builder.makeConst(Literal(int32_t(l - 1))));
+            }
+          }
+        }
+      }
       if (auto* ext = Properties::getAlmostSignExt(binary)) {
         Index extraShifts;
         auto bits = Properties::getAlmostSignExtBits(binary, extraShifts);
@@ -494,6 +595,31 @@ struct OptimizeInstructions : public WalkerPass<PostWalker<OptimizeInstructions,
       } else if (binary->op == AddInt32 || binary->op == SubInt32) {
         return optimizeAddedConstants(binary);
       }
+      // shift counts are taken mod the bit width, so a mask that only
+      // keeps those low bits is a no-op on a shift amount
+      if (binary->op == ShlInt32 || binary->op == ShrUInt32 || binary->op == ShrSInt32 ||
+          binary->op == RotLInt32 || binary->op == RotRInt32) {
+        if (auto* and_ = binary->right->dynCast<Binary>()) {
+          if (and_->op == AndInt32) {
+            if (auto* mask = and_->right->dynCast<Const>()) {
+              if ((mask->value.geti32() & 31) == 31) {
+                binary->right = and_->left;
+              }
+            }
+          }
+        }
+      } else if (binary->op == ShlInt64 || binary->op == ShrUInt64 || binary->op == ShrSInt64 ||
+                 binary->op == RotLInt64 || binary->op == RotRInt64) {
+        if (auto* and_ = binary->right->dynCast<Binary>()) {
+          if (and_->op == AndInt64) {
+            if (auto* mask = and_->right->dynCast<Const>()) {
+              if ((mask->value.geti64() & 63) == 63) {
+                binary->right = and_->left;
+              }
+            }
+          }
+        }
+      }
       // a bunch of operations on a constant right side can be simplified
       if (auto* right = binary->right->dynCast<Const>()) {
         if (binary->op == AndInt32) {
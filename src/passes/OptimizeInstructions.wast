@@ -21,6 +21,34 @@
 
   (func $patterns
     (block
+      ;; x ^ 0  =>  x
+      (block
+        (i32.xor (call_import $i32.expr (i32.const 0)) (i32.const 0))
+        (call_import $i32.expr (i32.const 0))
+      )
+      ;; x | 0  =>  x
+      (block
+        (i32.or (call_import $i32.expr (i32.const 0)) (i32.const 0))
+        (call_import $i32.expr (i32.const 0))
+      )
+      ;; x & -1  =>  x
+      (block
+        (i32.and (call_import $i32.expr (i32.const 0)) (i32.const -1))
+        (call_import $i32.expr (i32.const 0))
+      )
+      ;; and the same for i64
+      (block
+        (i64.xor (call_import $i64.expr (i32.const 0)) (i64.const 0))
+        (call_import $i64.expr (i32.const 0))
+      )
+      (block
+        (i64.or (call_import $i64.expr (i32.const 0)) (i64.const 0))
+        (call_import $i64.expr (i32.const 0))
+      )
+      (block
+        (i64.and (call_import $i64.expr (i32.const 0)) (i64.const -1))
+        (call_import $i64.expr (i32.const 0))
+      )
     )
   )
 )
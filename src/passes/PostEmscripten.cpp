@@ -74,6 +74,13 @@ struct PostEmscripten : public WalkerPass<PostWalker<PostEmscripten>> {
           continue;
         }
       }
+      // no constant at the top: reassociate one out of a child add, i.e.
+      // (x + K) + y => (x + y) + K with K going straight to the offset.
+      // adds wrap either way, so regrouping is exact, and the same
+      // SAFE_MAX argument covers the constant's move into the offset
+      if (reassociateConst(add->left, offset) || reassociateConst(add->right, offset)) {
+        continue;
+      }
       break;
     }
     // finally ptr may be a const, but it isn't worth folding that in (we still have a const); in fact,
@@ -85,6 +92,31 @@ struct PostEmscripten : public WalkerPass<PostWalker<PostEmscripten>> {
     }
   }
 
+  // if child is (x + K) with K foldable, the add shell drops away: child
+  // becomes x and K goes into the offset
+  bool reassociateConst(Expression*& child, Address& offset) {
+    auto* add = child->dynCast<Binary>();
+    if (!add || add->op != AddInt32) return false;
+    auto* left = add->left->dynCast<Const>();
+    auto* right = add->right->dynCast<Const>();
+    Expression* other;
+    Const* c;
+    if (left && !right) {
+      c = left;
+      other = add->right;
+    } else if (right && !left) {
+      c = right;
+      other = add->left;
+    } else {
+      return false;
+    }
+    auto value = c->value.geti32();
+    if (value < 0 || value >= SAFE_MAX) return false;
+    child = other;
+    offset = offset + value;
+    return true;
+  }
+
   void visitLoad(Load* curr) {
     optimizeMemoryAccess(curr->ptr, curr->offset);
   }
@@ -28,19 +28,80 @@
 namespace wasm {
 
 static const Name NONSTANDALONE_FLOW("Binaryen|nonstandalone");
+static const Name TRAPPING_FLOW("Binaryen|trapping"); // memo marker for subtrees whose evaluation traps
 
 // Execute an expression by itself. Errors if we hit anything we need anything not in the expression itself standalone.
 class StandaloneExpressionRunner : public ExpressionRunner<StandaloneExpressionRunner> {
+  // Evaluation is context-free here, so results can be memoized across the
+  // whole function walk: each node is fully evaluated at most once, no
+  // matter how many ancestors are evaluated above it (without this, the
+  // pass is O(nodes * depth)).
+  std::unordered_map<Expression*, Flow>* memo;
+
+  // values of immutable globals with constant initializers - reading one
+  // is as constant as the constant itself
+  const std::map<Name, Literal>* constantGlobals;
+
+  // for resolving direct calls to parameterless constant helpers; may be
+  // null, in which case calls are nonstandalone
+  Module* module;
+
+  // remaining evaluation fuel. every doVisit - including memo hits, so a
+  // stateless loop that continues cannot spin for free - costs one unit;
+  // exhaustion unwinds as a fuel exception, which is deliberately NOT
+  // memoized as trapping: running dry while evaluating a big parent says
+  // nothing about a child, which may still fold on its own later try
+  Index fuel;
+
 public:
   struct NonstandaloneException {}; // TODO: use a flow with a special name, as this is likely very slow
+  struct OutOfFuelException {};
 
-  Flow visitLoop(Loop* curr) {
-    // loops might be infinite, so must be careful
-    // but we can't tell if non-infinite, since we don't have state, so loops are just impossible to optimize for now
-    return Flow(NONSTANDALONE_FLOW);
+  StandaloneExpressionRunner(std::unordered_map<Expression*, Flow>* memo,
+                             const std::map<Name, Literal>* constantGlobals,
+                             Module* module, Index fuel)
+      : memo(memo), constantGlobals(constantGlobals), module(module), fuel(fuel) {}
+
+  Flow doVisit(Expression* curr) {
+    if (fuel == 0) {
+      throw OutOfFuelException();
+    }
+    fuel--;
+    auto iter = memo->find(curr);
+    if (iter != memo->end()) {
+      if (iter->second.breakTo == TRAPPING_FLOW) {
+        throw NonstandaloneException();
+      }
+      return iter->second;
+    }
+    Flow ret;
+    try {
+      ret = ExpressionRunner<StandaloneExpressionRunner>::doVisit(curr);
+    } catch (NonstandaloneException&) {
+      (*memo)[curr] = Flow(TRAPPING_FLOW);
+      throw;
+    }
+    (*memo)[curr] = ret;
+    return ret;
   }
 
+  // Loops are allowed: they have no state to diverge on here (locals,
+  // globals and memory all bail), so each iteration is identical, and a
+  // diverging one burns through the fuel and is left alone.
+
   Flow visitCall(Call* curr) {
+    // a direct call to a parameterless function is as standalone as its
+    // body (params would be locals, and locals bail; so do its vars)
+    if (module) {
+      auto* func = module->getFunctionOrNull(curr->target);
+      if (func && func->params.empty() && func->body) {
+        Flow flow = visit(func->body);
+        if (flow.breaking() && flow.breakTo == RETURN_FLOW) {
+          return Flow(flow.value);
+        }
+        return flow; // a normal value, or nonstandalone
+      }
+    }
     return Flow(NONSTANDALONE_FLOW);
   }
   Flow visitCallImport(CallImport* curr) {
@@ -56,6 +117,12 @@ public:
     return Flow(NONSTANDALONE_FLOW);
   }
   Flow visitGetGlobal(GetGlobal *curr) {
+    if (constantGlobals) {
+      auto iter = constantGlobals->find(curr->name);
+      if (iter != constantGlobals->end()) {
+        return Flow(iter->second);
+      }
+    }
     return Flow(NONSTANDALONE_FLOW);
   }
   Flow visitSetGlobal(SetGlobal *curr) {
@@ -79,16 +146,38 @@ public:
 struct Precompute : public WalkerPass<PostWalker<Precompute, UnifiedExpressionVisitor<Precompute>>> {
   bool isFunctionParallel() override { return true; }
 
-  Pass* create() override { return new Precompute; }
+  Pass* create() override {
+    auto* ret = new Precompute;
+    ret->constantGlobals = constantGlobals; // share the module-level table
+    return ret;
+  }
+
+  // immutable globals with constant initializers, collected once on the
+  // main thread and shared read-only by the per-function instances
+  std::shared_ptr<std::map<Name, Literal>> constantGlobals;
+
+  void prepareToRun(PassRunner* runner, Module* module) override {
+    constantGlobals = std::make_shared<std::map<Name, Literal>>();
+    for (auto& global : module->globals) {
+      if (!global->mutable_) {
+        if (auto* c = global->init->dynCast<Const>()) {
+          (*constantGlobals)[global->name] = c->value;
+        }
+      }
+    }
+  }
 
   void visitExpression(Expression* curr) {
     if (curr->is<Const>() || curr->is<Nop>()) return;
     // try to evaluate this into a const
     Flow flow;
     try {
-      flow = StandaloneExpressionRunner().visit(curr);
+      flow = StandaloneExpressionRunner(&precomputed, constantGlobals.get(),
+                                        getModule(), getPassOptions().precomputeFuel).visit(curr);
     } catch (StandaloneExpressionRunner::NonstandaloneException& e) {
       return;
+    } catch (StandaloneExpressionRunner::OutOfFuelException& e) {
+      return;
     }
     if (flow.breaking()) {
       if (flow.breakTo == NONSTANDALONE_FLOW) return;
@@ -138,7 +227,11 @@ struct Precompute : public WalkerPass<PostWalker<Precompute, UnifiedExpressionVi
     }
     // this was precomputed
     if (isConcreteWasmType(flow.value.type)) {
-      replaceCurrent(Builder(*getModule()).makeConst(flow.value));
+      // reuse the node's own storage for the constant when it fits
+      auto* ret = ExpressionManipulator::flexibleConvert<Const>(curr, getModule()->allocator);
+      ret->value = flow.value;
+      ret->type = flow.value.type;
+      replaceCurrent(ret);
     } else {
       ExpressionManipulator::nop(curr);
     }
@@ -148,6 +241,9 @@ struct Precompute : public WalkerPass<PostWalker<Precompute, UnifiedExpressionVi
     // removing breaks can alter types
     ReFinalize().walkFunctionInModule(curr, getModule());
   }
+
+private:
+  std::unordered_map<Expression*, Flow> precomputed; // shared across the walk, see StandaloneExpressionRunner
 };
 
 Pass *createPrecomputePass() {
@@ -18,7 +18,11 @@
 // Print out text in s-expression format
 //
 
+#include <atomic>
+#include <sstream>
+
 #include <wasm.h>
+#include <support/threads.h>
 #include <wasm-printing.h>
 #include <pass.h>
 #include <pretty_printing.h>
@@ -742,10 +746,52 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
       printOpening(o, "start") << ' ' << curr->start << ')';
       o << maybeNewLine;
     }
-    for (auto& child : curr->functions) {
-      doIndent(o, indent);
-      visitFunction(child.get());
-      o << maybeNewLine;
+    // functions render independently of each other, so on big modules
+    // each is printed into its own buffer in parallel, and the buffers
+    // are written out in one pass at the end
+    size_t numWorkers = ThreadPool::get()->size();
+    size_t total = curr->functions.size();
+    if (numWorkers > 1 && total > 1 && !ThreadPool::isRunning()) {
+      for (auto& child : curr->functions) {
+        curr->ensureFunctionBody(child.get()); // materialization is serial-only
+      }
+      std::vector<std::string> buffers(total);
+      std::atomic<size_t> nextFunction;
+      nextFunction.store(0);
+      std::vector<std::function<ThreadWorkState ()>> doWorkers;
+      for (size_t w = 0; w < numWorkers; w++) {
+        doWorkers.push_back([&, curr]() {
+          auto index = nextFunction.fetch_add(1);
+          if (index >= total) {
+            return ThreadWorkState::Finished; // nothing left
+          }
+          std::ostringstream buffer;
+          PrintSExpression sub(buffer);
+          sub.setMinify(minify);
+          sub.setFull(full);
+          sub.currModule = curr;
+          sub.indent = indent;
+          doIndent(buffer, sub.indent);
+          sub.visitFunction(curr->functions[index].get());
+          buffer << sub.maybeNewLine;
+          buffers[index] = buffer.str();
+          if (index + 1 == total) {
+            return ThreadWorkState::Finished; // we claimed the last one
+          }
+          return ThreadWorkState::More;
+        });
+      }
+      ThreadPool::get()->work(doWorkers);
+      for (auto& buffer : buffers) {
+        o << buffer;
+      }
+    } else {
+      for (auto& child : curr->functions) {
+        curr->ensureFunctionBody(child.get()); // may have been read lazily
+        doIndent(o, indent);
+        visitFunction(child.get());
+        o << maybeNewLine;
+      }
     }
     for (auto& section : curr->userSections) {
       doIndent(o, indent);
@@ -805,6 +851,14 @@ Pass *createFullPrinterPass() {
 
 // Print individual expressions
 
+std::ostream& WasmPrinter::printFunction(Function* func, Module* module, std::ostream& o) {
+  PrintSExpression print(o);
+  print.currModule = module; // for types and debug file names
+  print.visitFunction(func);
+  o << '\n';
+  return o;
+}
+
 std::ostream& WasmPrinter::printExpression(Expression* expression, std::ostream& o, bool minify, bool full) {
   if (!expression) {
     o << "(null expression)";
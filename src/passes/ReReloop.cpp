@@ -75,7 +75,7 @@ struct ReReloop : public Pass {
 
   // break handling
 
-  std::map<Name, CFG::Block*> breakTargets;
+  std::unordered_map<Name, CFG::Block*> breakTargets; // probe-only, hashed on the interned pointer
 
   void addBreakTarget(Name name, CFG::Block* target) {
     breakTargets[name] = target;
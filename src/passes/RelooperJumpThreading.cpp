@@ -66,10 +66,10 @@ static Index getSetLabelValue(SetLocal* set) {
 
 struct LabelUseFinder : public PostWalker<LabelUseFinder> {
   Index labelIndex;
-  std::map<Index, Index>& checks; // label value => number of checks on it
-  std::map<Index, Index>& sets;   // label value => number of sets to it
+  std::unordered_map<Index, Index>& checks; // label value => number of checks on it
+  std::unordered_map<Index, Index>& sets;   // label value => number of sets to it
 
-  LabelUseFinder(Index labelIndex, std::map<Index, Index>& checks, std::map<Index, Index>& sets) : labelIndex(labelIndex), checks(checks), sets(sets) {}
+  LabelUseFinder(Index labelIndex, std::unordered_map<Index, Index>& checks, std::unordered_map<Index, Index>& sets) : labelIndex(labelIndex), checks(checks), sets(sets) {}
 
   void visitIf(If* curr) {
     if (isLabelCheckingIf(curr, labelIndex)) {
@@ -89,8 +89,8 @@ struct RelooperJumpThreading : public WalkerPass<ExpressionStackWalker<RelooperJ
 
   Pass* create() override { return new RelooperJumpThreading; }
 
-  std::map<Index, Index> labelChecks;
-  std::map<Index, Index> labelSets;
+  std::unordered_map<Index, Index> labelChecks;
+  std::unordered_map<Index, Index> labelSets;
 
   Index labelIndex;
   Index newNameCounter = 0;
@@ -162,8 +162,8 @@ private:
     // in origin with jumps forward to us, and since there is nothing else, this is safe and complete.
     // We must also have the property that there is just one check for the label value, as otherwise
     // node splitting has complicated things.
-    std::map<Index, Index> labelChecksInOrigin;
-    std::map<Index, Index> labelSetsInOrigin;
+    std::unordered_map<Index, Index> labelChecksInOrigin;
+    std::unordered_map<Index, Index> labelSetsInOrigin;
     LabelUseFinder finder(labelIndex, labelChecksInOrigin, labelSetsInOrigin);
     finder.walk(origin);
     while (iff) {
@@ -177,8 +177,8 @@ private:
         // if the only other location is inside the if body, then it is ok - it must be in a loop
         // and returning to the top of the loop body, so we don't need to do anything for that
         // label setting anyhow
-        std::map<Index, Index> labelChecksInIfTrue;
-        std::map<Index, Index> labelSetsInIfTrue;
+        std::unordered_map<Index, Index> labelChecksInIfTrue;
+        std::unordered_map<Index, Index> labelSetsInIfTrue;
         LabelUseFinder finder(labelIndex, labelChecksInIfTrue, labelSetsInIfTrue);
         finder.walk(iff->ifTrue);
         if (labelSetsInOrigin[num] + labelSetsInIfTrue[num] < labelSets[num]) {
@@ -40,13 +40,9 @@ struct RemoveImports : public WalkerPass<PostWalker<RemoveImports>> {
   }
 
   void visitModule(Module *curr) {
-    std::vector<Name> names;
-    for (auto& import : curr->imports) {
-      names.push_back(import->name);
-    }
-    for (auto& name : names) {
-      curr->removeImport(name);
-    }
+    curr->removeImports([](Import* import) {
+      return true;
+    });
   }
 };
 
@@ -21,6 +21,7 @@
 #include <wasm.h>
 #include <pass.h>
 #include <ast_utils.h>
+#include <ast/cost.h>
 #include <wasm-builder.h>
 
 namespace wasm {
@@ -314,10 +315,10 @@ struct RemoveUnusedBrs : public WalkerPass<PostWalker<RemoveUnusedBrs>> {
     // thread trivial jumps
     struct JumpThreader : public ControlFlowWalker<JumpThreader> {
       // map of all value-less breaks going to a block (and not a loop)
-      std::map<Block*, std::vector<Break*>> breaksToBlock;
+      std::unordered_map<Block*, std::vector<Break*>> breaksToBlock; // probed only
 
       // the names to update
-      std::map<Break*, Name> newNames;
+      std::unordered_map<Break*, Name> newNames; // iterated, but the updates are independent
 
       void visitBreak(Break* curr) {
         if (!curr->value) {
@@ -470,7 +471,12 @@ struct RemoveUnusedBrs : public WalkerPass<PostWalker<RemoveUnusedBrs>> {
         if (!selectify) return;
         if (curr->ifFalse && isConcreteWasmType(curr->ifTrue->type) && isConcreteWasmType(curr->ifFalse->type)) {
           // if with else, consider turning it into a select if there is no control flow
-          // TODO: estimate cost
+          // and, when a cost ceiling is set, both arms are cheap enough that
+          // executing both beats a possibly-predictable branch
+          if (passOptions.selectifyMaxCost != Index(-1) &&
+              CostAnalyzer(curr->ifTrue).cost + CostAnalyzer(curr->ifFalse).cost > passOptions.selectifyMaxCost) {
+            return;
+          }
           EffectAnalyzer condition(passOptions, curr->condition);
           if (!condition.hasSideEffects()) {
             EffectAnalyzer ifTrue(passOptions, curr->ifTrue);
@@ -21,12 +21,14 @@
 //
 
 
+#include <atomic>
 #include <memory>
 
 #include "wasm.h"
 #include "pass.h"
 #include "ast_utils.h"
 #include "asm_v_wasm.h"
+#include "support/threads.h"
 
 namespace wasm {
 
@@ -37,66 +39,92 @@ enum class ModuleElementKind {
 
 typedef std::pair<ModuleElementKind, Name> ModuleElement;
 
-// Finds reachabilities
+// Finds the module elements an expression tree references
 
-struct ReachabilityAnalyzer : public PostWalker<ReachabilityAnalyzer> {
+struct ReferenceCollector : public PostWalker<ReferenceCollector> {
+  std::vector<ModuleElement> refs;
+
+  void visitCall(Call* curr) {
+    refs.emplace_back(ModuleElementKind::Function, curr->target);
+  }
+  void visitCallImport(CallImport* curr) {
+    refs.emplace_back(ModuleElementKind::Function, curr->target);
+  }
+  void visitGetGlobal(GetGlobal* curr) {
+    refs.emplace_back(ModuleElementKind::Global, curr->name);
+  }
+  void visitSetGlobal(SetGlobal* curr) {
+    refs.emplace_back(ModuleElementKind::Global, curr->name);
+  }
+};
+
+// Finds reachabilities. Walking the IR is the expensive part, so the
+// per-function reference lists are collected in parallel up front; the
+// flood fill itself then just chases precomputed edges, serially and
+// deterministically.
+
+struct ReachabilityAnalyzer {
   Module* module;
-  std::vector<ModuleElement> queue;
   std::set<ModuleElement> reachable;
 
   ReachabilityAnalyzer(Module* module, const std::vector<ModuleElement>& roots) : module(module) {
-    queue = roots;
-    // Globals used in memory/table init expressions are also roots
-    for (auto& segment : module->memory.segments) {
-      walk(segment.offset);
+    // collect each function's references, in parallel
+    size_t total = module->functions.size();
+    std::vector<std::vector<ModuleElement>> functionRefs(total);
+    parallelFor(total, [&](size_t index, size_t worker) {
+      ReferenceCollector collector;
+      collector.walk(module->functions[index]->body);
+      functionRefs[index].swap(collector.refs);
+    });
+    std::map<Name, std::vector<ModuleElement>*> functionEdges;
+    for (size_t i = 0; i < total; i++) {
+      functionEdges[module->functions[i]->name] = &functionRefs[i];
     }
-    for (auto& segment : module->table.segments) {
-      walk(segment.offset);
+    // the flood fill
+    std::vector<ModuleElement> queue = roots;
+    // Globals used in memory/table init expressions are also roots
+    {
+      ReferenceCollector collector;
+      for (auto& segment : module->memory.segments) {
+        collector.walk(segment.offset);
+      }
+      for (auto& segment : module->table.segments) {
+        collector.walk(segment.offset);
+      }
+      for (auto& ref : collector.refs) {
+        queue.push_back(ref);
+      }
     }
-    // main loop
     while (queue.size()) {
-      auto& curr = queue.back();
+      auto curr = queue.back();
       queue.pop_back();
-      if (reachable.count(curr) == 0) {
-        reachable.insert(curr);
-        if (curr.first == ModuleElementKind::Function) {
-          // if not an import, walk it
-          auto* func = module->getFunctionOrNull(curr.second);
-          if (func) {
-            walk(func->body);
+      if (reachable.count(curr) != 0) continue;
+      reachable.insert(curr);
+      if (curr.first == ModuleElementKind::Function) {
+        // if not an import, we have its precomputed edges
+        auto iter = functionEdges.find(curr.second);
+        if (iter != functionEdges.end()) {
+          for (auto& ref : *iter->second) {
+            if (reachable.count(ref) == 0) {
+              queue.push_back(ref);
+            }
           }
-        } else {
-          // if not imported, it has an init expression we need to walk
-          auto* glob = module->getGlobalOrNull(curr.second);
-          if (glob) {
-            walk(glob->init);
+        }
+      } else {
+        // if not imported, it has an init expression we need to walk
+        auto* glob = module->getGlobalOrNull(curr.second);
+        if (glob) {
+          ReferenceCollector collector;
+          collector.walk(glob->init);
+          for (auto& ref : collector.refs) {
+            if (reachable.count(ref) == 0) {
+              queue.push_back(ref);
+            }
           }
         }
       }
     }
   }
-
-  void visitCall(Call* curr) {
-    if (reachable.count(ModuleElement(ModuleElementKind::Function, curr->target)) == 0) {
-      queue.emplace_back(ModuleElementKind::Function, curr->target);
-    }
-  }
-  void visitCallImport(CallImport* curr) {
-    if (reachable.count(ModuleElement(ModuleElementKind::Function, curr->target)) == 0) {
-      queue.emplace_back(ModuleElementKind::Function, curr->target);
-    }
-  }
-
-  void visitGetGlobal(GetGlobal* curr) {
-    if (reachable.count(ModuleElement(ModuleElementKind::Global, curr->name)) == 0) {
-      queue.emplace_back(ModuleElementKind::Global, curr->name);
-    }
-  }
-  void visitSetGlobal(SetGlobal* curr) {
-    if (reachable.count(ModuleElement(ModuleElementKind::Global, curr->name)) == 0) {
-      queue.emplace_back(ModuleElementKind::Global, curr->name);
-    }
-  }
 };
 
 // Finds function type usage
@@ -144,6 +172,16 @@ struct RemoveUnusedModuleElements : public Pass {
       }
     }
     // For now, all functions that can be called indirectly are marked as roots.
+    // Proving table slots dead needs every call_indirect index in the
+    // module (and in any embedder that can call exports taking indices!)
+    // to be a provable constant - one escaping index makes every slot
+    // reachable, and function-pointer tables in compiled C/C++ escape
+    // constantly (stored, passed, arithmetic'd). Compaction additionally
+    // rewrites the constants, changing the function-pointer values the
+    // program may compare or store. So table compaction is only sound
+    // under a whole-program closed-world guarantee the tools cannot
+    // check; a build that has one can express it by emptying the table
+    // itself before optimizing.
     for (auto& segment : module->table.segments) {
       for (auto& curr : segment.data) {
         roots.emplace_back(ModuleElementKind::Function, curr);
@@ -178,6 +216,16 @@ struct RemoveUnusedModuleElements : public Pass {
     module->updateMaps();
   }
 
+  // On reference counts for types and imports, maintained by Builder and
+  // the manipulation helpers with a sweep in the pass runner: counts are
+  // only sound if every reference change goes through a counting
+  // chokepoint, and passes here retarget calls and drop subtrees through
+  // plain field writes (see the Const note in wasm.h) - a count would
+  // silently drift and a sweep on drifted counts deletes live types. The
+  // sound form of the same idea is this mark-and-sweep, which recounts
+  // from the IR each time it runs; the default pipelines schedule this
+  // pass at the end, so the writer never emits the dead entries, which is
+  // where the cost was.
   void optimizeFunctionTypes(Module* module) {
     FunctionTypeAnalyzer analyzer;
     analyzer.walkModule(module);
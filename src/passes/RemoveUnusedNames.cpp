@@ -20,6 +20,8 @@
 //
 
 #include <wasm.h>
+#include <support/flat-map.h>
+#include <support/name.h>
 #include <pass.h>
 
 namespace wasm {
@@ -31,7 +33,7 @@ struct RemoveUnusedNames : public WalkerPass<PostWalker<RemoveUnusedNames>> {
 
   // We maintain a list of branches that we saw in children, then when we reach
   // a parent block, we know if it was branched to
-  std::map<Name, std::set<Expression*>> branchesSeen;
+  FlatMap<Name, std::set<Expression*>> branchesSeen; // only probed and erased, never iterated
 
   void visitBreak(Break *curr) {
     branchesSeen[curr->name].insert(curr);
@@ -19,28 +19,108 @@
 // binaries because fewer bytes are needed to encode references to frequently
 // used functions.
 //
+// A profile can override the static counts: point BYN_REORDER_PROFILE at a
+// file of "<function name> <count>" lines (e.g. call frequencies gathered
+// via the log-execution instrumentation) and functions are ordered by
+// those counts instead, so the frequency-weighted LEB bytes of call sites
+// are minimized and hot functions cluster at the front of the binary,
+// which also helps streaming compilation reach them early.
+//
 
 
+#include <fstream>
 #include <memory>
 
 #include <wasm.h>
+#include <wasm-binary.h>
 #include <pass.h>
+#include <ast/call-graph.h>
 
 namespace wasm {
 
-struct ReorderFunctions : public WalkerPass<PostWalker<ReorderFunctions>> {
+struct ReorderFunctions : public Pass {
   std::map<Name, uint32_t> counts;
 
-  void visitModule(Module *module) {
-    if (module->start.is()) {
-      counts[module->start]++;
+  // reads a "<name> <count>" profile; returns whether one was loaded
+  bool loadProfile() {
+    auto* filename = getenv("BYN_REORDER_PROFILE");
+    if (!filename) return false;
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+      std::cerr << "warning: could not open reorder profile " << filename << '\n';
+      return false;
     }
-    for (auto& curr : module->exports) {
-      counts[curr->value]++;
+    counts.clear();
+    std::string name;
+    uint32_t count;
+    while (in >> name >> count) {
+      counts[Name(name)] = count;
     }
-    for (auto& segment : module->table.segments) {
-      for (auto& curr : segment.data) {
-        counts[curr]++;
+    return true;
+  }
+
+  // use counts carried in a binaryen.stats section from an earlier stage
+  // (see wasm-binary.h); only trusted when the function count still
+  // matches, as passes in between may have added or removed functions
+  bool loadStatsSection(Module* module) {
+    for (auto& section : module->userSections) {
+      if (section.name != BinaryConsts::UserSections::Stats) continue;
+      size_t pos = 0;
+      auto readLEB = [&](uint32_t& value) {
+        value = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+          if (pos >= section.data.size()) return false;
+          byte = uint8_t(section.data[pos++]);
+          value |= uint32_t(byte & 127) << shift;
+          shift += 7;
+        } while (byte & 128);
+        return true;
+      };
+      uint32_t version, total;
+      if (!readLEB(version) || version != 1) return false;
+      if (!readLEB(total) || total != module->functions.size()) return false;
+      counts.clear();
+      for (uint32_t i = 0; i < total; i++) {
+        uint32_t weight;
+        if (!readLEB(weight)) return false;
+        counts[module->functions[i]->name] = weight;
+      }
+      return true;
+    }
+    return false;
+  }
+
+  void run(PassRunner* runner, Module* module) override {
+    if (runner->options.hasProfile()) {
+      // a profile fed via --profile wins over everything
+      counts.clear();
+      for (auto& pair : runner->options.profile) {
+        counts[pair.first] = uint32_t(std::min<uint64_t>(pair.second, ~uint32_t(0)));
+      }
+    } else if (loadProfile()) {
+      // the profile replaces everything the static walk gathered
+    } else if (loadStatsSection(module)) {
+      // an earlier pipeline stage did the counting for us
+    } else {
+      if (module->start.is()) {
+        counts[module->start]++;
+      }
+      for (auto& curr : module->exports) {
+        counts[curr->value]++;
+      }
+      for (auto& segment : module->table.segments) {
+        for (auto& curr : segment.data) {
+          counts[curr]++;
+        }
+      }
+      // count the call sites, via the shared call graph (built in parallel)
+      CallGraph graph(*module);
+      for (auto& edge : graph.edges) {
+        if (!edge.isImport) {
+          counts[edge.target]++;
+        }
       }
     }
     std::sort(module->functions.begin(), module->functions.end(), [this](
@@ -54,9 +134,6 @@ struct ReorderFunctions : public WalkerPass<PostWalker<ReorderFunctions>> {
     counts.clear();
   }
 
-  void visitCall(Call *curr) {
-    counts[curr->target]++;
-  }
 };
 
 Pass *createReorderFunctionsPass() {
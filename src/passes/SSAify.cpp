@@ -57,7 +57,18 @@ struct SSAify : public WalkerPass<PostWalker<SSAify>> {
   // we map (old local index) => the set_locals for that index.
   // a nullptr set means there is a virtual set, from a param
   // initial value or the zero init initial value.
-  typedef std::vector<Sets> Mapping;
+  // entries are copy-on-write: mappings are copied at every control flow
+  // split and join, which used to copy numLocals full sets each time -
+  // shared pointers make the copies O(numLocals) pointer bumps, and the
+  // few mutation points unshare first via mutableSets()
+  typedef std::vector<std::shared_ptr<Sets>> Mapping;
+
+  static Sets& mutableSets(std::shared_ptr<Sets>& ptr) {
+    if (!ptr.unique()) {
+      ptr = std::make_shared<Sets>(*ptr);
+    }
+    return *ptr;
+  }
 
   Index numLocals;
   Mapping currMapping;
@@ -76,7 +87,7 @@ struct SSAify : public WalkerPass<PostWalker<SSAify>> {
     // so the initial state is the identity permutation
     currMapping.resize(numLocals);
     for (auto& set : currMapping) {
-      set = { nullptr };
+      set = std::make_shared<Sets>(Sets({ nullptr }));
     }
     nextIndex = numLocals;
     WalkerPass<PostWalker<SSAify>>::walk(func->body);
@@ -149,7 +160,7 @@ struct SSAify : public WalkerPass<PostWalker<SSAify>> {
       // as the sets at the entrance to the loop, then it is affected by the loop
       // header sets, and we can add to there sets that looped back
       auto linkLoopTop = [&](Index i, Sets& getSets) {
-        auto& beforeSets = before[i];
+        auto& beforeSets = *before[i];
         if (getSets.size() < beforeSets.size()) {
           // the get trivially has fewer sets, so it overrode the loop entry sets
           return;
@@ -163,7 +174,7 @@ struct SSAify : public WalkerPass<PostWalker<SSAify>> {
           return;
         }
         // the get has the entry sets, so add any new ones
-        for (auto* set : merged[i]) {
+        for (auto* set : *merged[i]) {
           getSets.insert(set);
         }
       };
@@ -174,7 +185,7 @@ struct SSAify : public WalkerPass<PostWalker<SSAify>> {
       // and the same for the loop fallthrough: any local that still has the
       // entry sets should also have the loop-back sets as well
       for (Index i = 0; i < numLocals; i++) {
-        linkLoopTop(i, currMapping[i]);
+        linkLoopTop(i, mutableSets(currMapping[i]));
       }
       // finally, breaks still in flight must be updated too
       for (auto& iter : breakMappings) {
@@ -183,7 +194,7 @@ struct SSAify : public WalkerPass<PostWalker<SSAify>> {
         auto& mappings = iter.second;
         for (auto& mapping : mappings) {
           for (Index i = 0; i < numLocals; i++) {
-            linkLoopTop(i, mapping[i]);
+            linkLoopTop(i, mutableSets(mapping[i]));
           }
         }
       }
@@ -228,14 +239,14 @@ struct SSAify : public WalkerPass<PostWalker<SSAify>> {
       loopGets.push_back(curr);
     }
     // current sets are our sets
-    getSetses[curr] = currMapping[curr->index];
+    getSetses[curr] = *currMapping[curr->index];
     getLocations[curr] = getCurrentPointer();
   }
   void visitSetLocal(SetLocal* curr) {
     assert(currMapping.size() == numLocals);
     assert(curr->index < numLocals);
     // current sets are just this set
-    currMapping[curr->index] = { curr }; // TODO optimize?
+    currMapping[curr->index] = std::make_shared<Sets>(Sets({ curr }));
     curr->index = addLocal(getFunction()->getLocalType(curr->index));
   }
 
@@ -266,12 +277,16 @@ struct SSAify : public WalkerPass<PostWalker<SSAify>> {
 
   void setUnreachable(Mapping& mapping) {
     mapping.resize(numLocals); // may have been emptied by a move
-    mapping[0].clear();
+    static std::shared_ptr<Sets> emptySets = std::make_shared<Sets>();
+    for (auto& set : mapping) {
+      if (!set) set = emptySets; // a moved-from mapping has null entries
+    }
+    mapping[0] = emptySets;
   }
 
   bool isUnreachable(Mapping& mapping) {
     // we must have some set for each index, if only the zero init, so empty means we emptied it for unreachable code
-    return mapping[0].empty();
+    return mapping[0]->empty();
   }
 
   // merges a bunch of infos into one.
@@ -287,8 +302,9 @@ struct SSAify : public WalkerPass<PostWalker<SSAify>> {
     for (Index j = 1; j < mappings.size(); j++) {
       auto& other = mappings[j];
       for (Index i = 0; i < numLocals; i++) {
-        auto& outSets = out[i];
-        for (auto* set : other[i]) {
+        if (other[i]->empty()) continue;
+        auto& outSets = mutableSets(out[i]);
+        for (auto* set : *other[i]) {
           outSets.insert(set);
         }
       }
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Schedules independent operations within blocks to shorten local live
+// ranges: a set_local is sunk as close as possible to the first element
+// that reads (or re-writes) its local, crossing only elements it is
+// effect-independent of. Shorter live ranges mean a smaller interference
+// graph, which helps coalesce-locals merge more locals when this runs
+// before it.
+//
+
+#include <wasm.h>
+#include <pass.h>
+#include <ast_utils.h>
+
+namespace wasm {
+
+struct ScheduleLocals : public WalkerPass<PostWalker<ScheduleLocals>> {
+  bool isFunctionParallel() override { return true; }
+
+  Pass* create() override { return new ScheduleLocals; }
+
+  void visitBlock(Block* curr) {
+    auto& list = curr->list;
+    if (list.size() < 3) return;
+    // reordering never mutates the nodes themselves, so cached effect
+    // summaries stay valid throughout
+    EffectCache effects(getPassOptions());
+    // work backwards so a set can sink past things we already sank
+    for (int i = int(list.size()) - 3; i >= 0; i--) {
+      auto* set = list[i]->dynCast<SetLocal>();
+      if (!set || set->isTee()) continue;
+      auto& setEffects = effects.get(set);
+      // find how far the set can sink: stop before the first element that
+      // touches its local or is not effect-independent of it. never sink
+      // into the last position, which may be the block's value
+      Index target = i;
+      for (Index j = i + 1; j + 1 < list.size(); j++) {
+        auto& currEffects = effects.get(list[j]);
+        if (currEffects.localsRead.count(set->index) ||
+            currEffects.localsWritten.count(set->index) ||
+            currEffects.invalidates(setEffects)) {
+          break;
+        }
+        target = j;
+      }
+      if (target > Index(i)) {
+        // rotate the set down to its target position
+        for (Index j = i; j < target; j++) {
+          list[j] = list[j + 1];
+        }
+        list[target] = set;
+      }
+    }
+  }
+};
+
+Pass* createScheduleLocalsPass() {
+  return new ScheduleLocals();
+}
+
+} // namespace wasm
@@ -42,6 +42,7 @@
 //
 
 #include <wasm.h>
+#include <support/counters.h>
 #include <wasm-builder.h>
 #include <wasm-traversal.h>
 #include <pass.h>
@@ -201,6 +202,7 @@ struct SimplifyLocals : public WalkerPass<LinearExecutionWalker<SimplifyLocals>>
     auto found = sinkables.find(curr->index);
     if (found != sinkables.end()) {
       // sink it, and nop the origin
+      Counters::note("simplify-locals/sinks");
       auto* set = (*found->second.item)->cast<SetLocal>();
       if (firstCycle || getCounter.num[curr->index] == 1) {
         replaceCurrent(set->value);
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Merges runs of adjacent byte-wise stores into wider stores - the
+// unrolled memset/memcpy idiom frontends emit as sequences of store8s.
+// Two forms are recognized in a block's list:
+//
+//  * fill:  store8(local, off+k, const_k)  =>  one store16/32/64 with the
+//    constants packed little-endian
+//  * copy:  store8(local, doff+k, load8(local, soff+k))  =>  one wide
+//    load + store, only when source and destination offsets are relative
+//    to the *same* local and the ranges are statically disjoint - with
+//    two different locals the regions could overlap, where a byte-wise
+//    forward copy and a wide load-then-store genuinely differ
+//
+// Merged accesses use align=1, so no alignment is promised that the byte
+// stores did not. The pass requires ignoreImplicitTraps: a partly
+// out-of-bounds run traps mid-way through the byte stores, leaving a
+// prefix written, while the wide store traps without writing - under the
+// default trap semantics that difference is observable.
+//
+
+#include <wasm.h>
+#include <pass.h>
+#include <wasm-builder.h>
+#include "ast/manipulation.h"
+
+namespace wasm {
+
+struct StoreMerging : public WalkerPass<PostWalker<StoreMerging>> {
+  bool isFunctionParallel() override { return true; }
+
+  Pass* create() override { return new StoreMerging; }
+
+  void visitBlock(Block* curr) {
+    if (!getPassOptions().ignoreImplicitTraps) return; // see the note above
+    auto& list = curr->list;
+    bool merged = false;
+    Index i = 0;
+    while (i < list.size()) {
+      auto run = matchRun(list, i);
+      if (run > 1) {
+        mergeRun(list, i, run);
+        merged = true;
+        i += run; // the tail entries are now nops, compacted below
+      } else {
+        i++;
+      }
+    }
+    if (merged) {
+      // compact out the nops the merges left behind (only those: the
+      // merge loop nops exactly the absorbed stores)
+      Index skip = 0;
+      for (Index j = 0; j < list.size(); j++) {
+        if (list[j]->is<Nop>()) {
+          skip++;
+        } else if (skip > 0) {
+          list[j - skip] = list[j];
+        }
+      }
+      list.resize(list.size() - skip);
+    }
+  }
+
+private:
+  // a store8 of a constant, or of a load8 from the same local
+  bool isByteFill(Expression* item, Index& local, Address& offset, uint8_t& value) {
+    auto* store = item->dynCast<Store>();
+    if (!store || store->bytes != 1) return false;
+    auto* ptr = store->ptr->dynCast<GetLocal>();
+    auto* val = store->value->dynCast<Const>();
+    if (!ptr || !val || val->type != i32) return false;
+    local = ptr->index;
+    offset = store->offset;
+    value = uint8_t(val->value.geti32());
+    return true;
+  }
+
+  bool isByteCopy(Expression* item, Index& local, Address& dstOffset, Address& srcOffset) {
+    auto* store = item->dynCast<Store>();
+    if (!store || store->bytes != 1) return false;
+    auto* dst = store->ptr->dynCast<GetLocal>();
+    auto* load = store->value->dynCast<Load>();
+    if (!dst || !load || load->bytes != 1) return false;
+    auto* src = load->ptr->dynCast<GetLocal>();
+    if (!src || src->index != dst->index) return false; // see the overlap note
+    local = dst->index;
+    dstOffset = store->offset;
+    srcOffset = load->offset;
+    return true;
+  }
+
+  // returns the length of the mergeable run starting at list[start] (1 if none)
+  Index matchRun(ExpressionList& list, Index start) {
+    Index local;
+    Address offset;
+    uint8_t value;
+    Address dstOffset, srcOffset;
+    if (isByteFill(list[start], local, offset, value)) {
+      Index length = 1;
+      while (start + length < list.size() && length < 8) {
+        Index nextLocal;
+        Address nextOffset;
+        uint8_t nextValue;
+        if (!isByteFill(list[start + length], nextLocal, nextOffset, nextValue) ||
+            nextLocal != local || uint64_t(nextOffset) != offset + length) {
+          break;
+        }
+        length++;
+      }
+      return largestPower2(length);
+    }
+    if (isByteCopy(list[start], local, dstOffset, srcOffset)) {
+      Index length = 1;
+      while (start + length < list.size() && length < 8) {
+        Index nextLocal;
+        Address nextDst, nextSrc;
+        if (!isByteCopy(list[start + length], nextLocal, nextDst, nextSrc) ||
+            nextLocal != local ||
+            uint64_t(nextDst) != dstOffset + length ||
+            uint64_t(nextSrc) != srcOffset + length) {
+          break;
+        }
+        length++;
+      }
+      length = largestPower2(length);
+      // the wide load must read no byte the run's earlier stores wrote
+      if (srcOffset + length <= dstOffset || dstOffset + length <= srcOffset) {
+        return length;
+      }
+    }
+    return 1;
+  }
+
+  void mergeRun(ExpressionList& list, Index start, Index length) {
+    auto* store = list[start]->cast<Store>();
+    if (auto* load = store->value->dynCast<Load>()) {
+      load->bytes = length;
+      load->signed_ = false;
+      load->align = 1;
+      load->type = length == 8 ? i64 : i32;
+    } else {
+      // pack the byte constants little-endian
+      uint64_t packed = 0;
+      for (Index k = 0; k < length; k++) {
+        Index localIgnored;
+        Address offsetIgnored;
+        uint8_t value;
+        isByteFill(list[start + k], localIgnored, offsetIgnored, value);
+        packed |= uint64_t(value) << (8 * k);
+      }
+      auto* val = store->value->cast<Const>();
+      if (length == 8) {
+        val->value = Literal(int64_t(packed));
+        val->type = i64;
+      } else {
+        val->value = Literal(int32_t(uint32_t(packed)));
+      }
+    }
+    store->bytes = length;
+    store->align = 1;
+    store->valueType = length == 8 ? i64 : i32;
+    for (Index k = 1; k < length; k++) {
+      ExpressionManipulator::nop(list[start + k]);
+    }
+  }
+
+  static Index largestPower2(Index length) {
+    if (length >= 8) return 8;
+    if (length >= 4) return 4;
+    if (length >= 2) return 2;
+    return 1;
+  }
+
+};
+
+Pass* createStoreMergingPass() {
+  return new StoreMerging();
+}
+
+} // namespace wasm
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A fused cleanup pass: one post-order walk combining what the vacuum+dce
+// pass pairs in the default pipeline spend most of their time on -
+// trimming block contents that follow unreachable code, and removing
+// side-effect-free code whose value is unused. The full vacuum and dce
+// passes catch more patterns (if-arm simplification, block-value
+// restructuring); this pass exists for pipelines that want one cheap
+// traversal instead of two full ones, e.g. as a quick cleanup between
+// heavier passes.
+//
+
+#include <wasm.h>
+#include <pass.h>
+#include <ast_utils.h>
+#include <ast/manipulation.h>
+
+namespace wasm {
+
+struct VacuumDCE : public WalkerPass<PostWalker<VacuumDCE>> {
+  bool isFunctionParallel() override { return true; }
+
+  Pass* create() override { return new VacuumDCE; }
+
+  // Removed subtrees are recycled into the arena's freelists, so a long
+  // pipeline's peak memory stops including them. Sound here because this
+  // pass keeps no Expression*-keyed state; we skip it when the function
+  // carries debug locations, whose side table is keyed by expression
+  // address (a reused address would attach stale locations).
+  bool canRecycle() {
+    return getFunction() && getFunction()->debugLocations.empty();
+  }
+
+  void recycle(Expression* curr) {
+    if (canRecycle()) {
+      ExpressionManipulator::recycleTree(curr, getModule()->allocator);
+    }
+  }
+
+  void visitBlock(Block* curr) {
+    auto& list = curr->list;
+    // trim everything after the first unreachable-typed element (it can
+    // never be reached)
+    for (Index i = 0; i < list.size(); i++) {
+      if (list[i]->type == unreachable && i + 1 < list.size()) {
+        for (Index j = i + 1; j < list.size(); j++) {
+          recycle(list[j]);
+        }
+        list.resize(i + 1);
+        break;
+      }
+    }
+    // remove side-effect-free elements, except the last, which may be the
+    // block's value (or the unreachable that justifies its type)
+    if (list.size() > 1) {
+      Index skip = 0;
+      for (Index i = 0; i + 1 < list.size(); i++) {
+        auto* child = list[i];
+        if (child->is<Nop>() ||
+            !EffectAnalyzer(getPassOptions(), child).hasSideEffects()) {
+          recycle(child);
+          skip++;
+        } else if (skip > 0) {
+          list[i - skip] = child;
+        }
+      }
+      if (skip > 0) {
+        list[list.size() - skip - 1] = list[list.size() - 1];
+        list.resize(list.size() - skip);
+      }
+    }
+  }
+
+  void visitDrop(Drop* curr) {
+    // a dropped value with no side effects is just not needed
+    if (!EffectAnalyzer(getPassOptions(), curr->value).hasSideEffects()) {
+      recycle(curr->value);
+      ExpressionManipulator::nop(curr);
+    }
+  }
+
+  void visitFunction(Function* curr) {
+    // removals can change types up the tree
+    ReFinalize().walkFunctionInModule(curr, getModule());
+  }
+};
+
+Pass* createVacuumDCEPass() {
+  return new VacuumDCE();
+}
+
+} // namespace wasm
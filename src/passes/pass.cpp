@@ -14,9 +14,15 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <chrono>
+#include <numeric>
 #include <sstream>
 
+#include <ast_utils.h>
+#include <ast/function-analysis.h>
+#include <support/counters.h>
+#include <support/hash.h>
 #include <support/colors.h>
 #include <passes/passes.h>
 #include <pass.h>
@@ -68,17 +74,22 @@ void PassRegistry::registerPasses() {
   registerPass("coalesce-locals-learning", "reduce # of locals by coalescing and learning", createCoalesceLocalsWithLearningPass);
   registerPass("code-pushing", "push code forward, potentially making it not always execute", createCodePushingPass);
   registerPass("dce", "removes unreachable code", createDeadCodeEliminationPass);
+  registerPass("dse", "removes sets of locals that are never read", createDeadStoreEliminationPass);
   registerPass("duplicate-function-elimination", "removes duplicate functions", createDuplicateFunctionEliminationPass);
   registerPass("extract-function", "leaves just one function (useful for debugging)", createExtractFunctionPass);
   registerPass("flatten-control-flow", "flattens out control flow to be only on blocks, not nested as expressions", createFlattenControlFlowPass);
+  registerPass("hot-cold-split", "outlines cold never-returning code into separate functions", createHotColdSplittingPass);
   registerPass("inlining", "inlines functions (currently only ones with a single use)", createInliningPass);
   registerPass("legalize-js-interface", "legalizes i64 types on the import/export boundary", createLegalizeJSInterfacePass);
+  registerPass("licm", "loop-invariant code motion", createLoopInvariantCodeMotionPass);
   registerPass("local-cse", "common subexpression elimination inside basic blocks", createLocalCSEPass);
   registerPass("log-execution", "instrument the build with logging of where execution goes", createLogExecutionPass);
   registerPass("instrument-locals", "instrument the build with code to intercept all loads and stores", createInstrumentLocalsPass);
   registerPass("instrument-memory", "instrument the build with code to intercept all loads and stores", createInstrumentMemoryPass);
+  registerPass("instrument-memory-shadow", "record access histograms into a shadow memory region", createInstrumentMemoryShadowPass);
   registerPass("memory-packing", "packs memory into separate segments, skipping zeros", createMemoryPackingPass);
   registerPass("merge-blocks", "merges blocks to their parents", createMergeBlocksPass);
+  registerPass("mod-ref", "computes interprocedural purity summaries for later passes", createModRefPass);
   registerPass("metrics", "reports metrics", createMetricsPass);
   registerPass("nm", "name list", createNameListPass);
   registerPass("name-manager", "utility pass to manage names in modules", createNameManagerPass);
@@ -99,13 +110,16 @@ void PassRegistry::registerPasses() {
   registerPass("reorder-functions", "sorts functions by access frequency", createReorderFunctionsPass);
   registerPass("reorder-locals", "sorts locals by access frequency", createReorderLocalsPass);
   registerPass("rereloop", "re-optimize control flow using the relooper algorithm", createReReloopPass);
+  registerPass("schedule-locals", "sinks sets toward their uses to shorten live ranges", createScheduleLocalsPass);
   registerPass("simplify-locals", "miscellaneous locals-related optimizations", createSimplifyLocalsPass);
   registerPass("simplify-locals-notee", "miscellaneous locals-related optimizations", createSimplifyLocalsNoTeePass);
   registerPass("simplify-locals-nostructure", "miscellaneous locals-related optimizations", createSimplifyLocalsNoStructurePass);
   registerPass("simplify-locals-notee-nostructure", "miscellaneous locals-related optimizations", createSimplifyLocalsNoTeeNoStructurePass);
   registerPass("ssa", "ssa-ify variables so that they have a single assignment", createSSAifyPass);
+  registerPass("store-merging", "merges adjacent byte stores into wider stores (requires --ignore-implicit-traps)", createStoreMergingPass);
   registerPass("untee", "removes tee_locals, replacing them with sets and gets", createUnteePass);
   registerPass("vacuum", "removes obviously unneeded code", createVacuumPass);
+  registerPass("vacuum-dce", "removes unneeded and unreachable code in one cheap walk", createVacuumDCEPass);
 //  registerPass("lower-i64", "lowers i64 into pairs of i32s", createLowerInt64Pass);
 }
 
@@ -170,6 +184,49 @@ static void dumpWast(Name name, Module* wasm) {
 
 void PassRunner::run() {
   static const int passDebug = getPassDebug();
+  // BINARYEN_PASS_TIMES in the env turns on the hotspot report: run pass
+  // by pass (not fused, so the time is attributable to a pass), each
+  // function-parallel pass as its own parallel batch, and print where the
+  // pipeline's time went at the end, sorted
+  static const bool passTimes = getenv("BINARYEN_PASS_TIMES") != nullptr;
+  if (!isNested && passTimes && !options.debug && !passDebug) {
+    std::map<std::string, std::chrono::duration<double>> times;
+    std::map<std::string, Index> runs;
+    std::map<std::string, size_t> arenaGrowth;
+    auto totalTime = std::chrono::duration<double>(0);
+    for (auto* pass : passes) {
+      auto before = std::chrono::steady_clock::now();
+      auto arenaBefore = wasm->allocator.totalBytes();
+      if (pass->isFunctionParallel()) {
+        std::vector<Pass*> single;
+        single.push_back(pass);
+        runStackParallel(single);
+      } else {
+        pass->run(this, wasm);
+      }
+      std::chrono::duration<double> diff = std::chrono::steady_clock::now() - before;
+      times[pass->name] += diff;
+      runs[pass->name]++;
+      arenaGrowth[pass->name] += wasm->allocator.totalBytes() - arenaBefore;
+      totalTime += diff;
+    }
+    std::vector<std::string> names;
+    for (auto& pair : times) {
+      names.push_back(pair.first);
+    }
+    std::sort(names.begin(), names.end(), [&times](const std::string& a, const std::string& b) {
+      return times[a] > times[b];
+    });
+    Counters::report(std::cerr);
+    std::cerr << "[PassRunner] hotspot report: " << totalTime.count() << " seconds over " << passes.size() << " pass runs\n";
+    for (auto& name : names) {
+      std::cerr << "[PassRunner]   " << times[name].count() << " s ("
+                << (totalTime.count() > 0 ? 100 * times[name].count() / totalTime.count() : 0)
+                << "%) and " << arenaGrowth[name] << " arena bytes in "
+                << runs[name] << " run(s) of " << name << '\n';
+    }
+    return;
+  }
   if (!isNested && (options.debug || passDebug)) {
     // for debug logging purposes, run each pass in full before running the other
     auto totalTime = std::chrono::duration<double>(0);
@@ -181,6 +238,7 @@ void PassRunner::run() {
     if (passDebug >= 3) {
       dumpWast("before", wasm);
     }
+    std::map<Function*, uint64_t> validatedHashes; // function => hash when last validated
     for (auto* pass : passes) {
       // ignoring the time, save a printout of the module before, in case this pass breaks it, so we can print the before and after
       std::stringstream moduleBefore;
@@ -194,10 +252,14 @@ void PassRunner::run() {
       }
       auto before = std::chrono::steady_clock::now();
       if (pass->isFunctionParallel()) {
-        // function-parallel passes should get a new instance per function
-        for (auto& func : wasm->functions) {
-          runPassOnFunction(pass, func.get());
-        }
+        // run in parallel, as one single-pass batch: debugging needs
+        // pass-at-a-time granularity (so validation can attribute
+        // breakage), but not function-at-a-time seriality - that used to
+        // collapse a 32-way pipeline to one core exactly when someone was
+        // trying to measure it
+        std::vector<Pass*> single;
+        single.push_back(pass);
+        runStackParallel(single);
       } else {
         pass->run(this, wasm);
       }
@@ -205,9 +267,22 @@ void PassRunner::run() {
       std::chrono::duration<double> diff = after - before;
       std::cerr << diff.count() << " seconds." << std::endl;
       totalTime += diff;
-      // validate, ignoring the time
+      // validate, ignoring the time - incrementally: most passes leave most
+      // functions alone, so only re-check functions whose contents changed
+      // since they last validated, plus the global structures (the final
+      // whole-module validation below still runs as a backstop)
       std::cerr << "[PassRunner]   (validating)\n";
-      if (!WasmValidator().validate(*wasm, false, options.validateGlobally)) {
+      std::map<Function*, uint64_t> newHashes;
+      std::vector<Function*> dirty;
+      for (auto& func : wasm->functions) {
+        auto digest = FunctionAnalysisCache::hashFunction(func.get());
+        newHashes[func.get()] = digest;
+        auto iter = validatedHashes.find(func.get());
+        if (iter == validatedHashes.end() || iter->second != digest) {
+          dirty.push_back(func.get());
+        }
+      }
+      if (!WasmValidator().validate(*wasm, dirty, false, options.validateGlobally)) {
         if (passDebug >= 2) {
           std::cerr << "Last pass (" << pass->name << ") broke validation. Here is the module before: \n" << moduleBefore.str() << "\n";
         } else {
@@ -215,6 +290,7 @@ void PassRunner::run() {
         }
         abort();
       }
+      validatedHashes.swap(newHashes); // also drops entries for removed functions
       if (passDebug >= 3) {
         dumpWast(pass->name, wasm);
       }
@@ -228,35 +304,36 @@ void PassRunner::run() {
     }
   } else {
     // non-debug normal mode, run them in an optimal manner - for locality it is better
-    // to run as many passes as possible on a single function before moving to the next
+    // to run as many passes as possible on a single function before moving to the next:
+    // consecutive function-parallel passes are fused into a single sub-pipeline
+    // that runs per function while it is hot in cache, one task per function
+    // through the whole stack, rather than one task per function per pass.
+    // only a non-function-parallel pass (or the end of the pipeline) flushes
+    // the accumulated stack.
     std::vector<Pass*> stack;
     auto flush = [&]() {
-      if (stack.size() > 0) {
-        // run the stack of passes on all the functions, in parallel
-        size_t num = ThreadPool::get()->size();
-        std::vector<std::function<ThreadWorkState ()>> doWorkers;
-        std::atomic<size_t> nextFunction;
-        nextFunction.store(0);
-        size_t numFunctions = wasm->functions.size();
-        for (size_t i = 0; i < num; i++) {
-          doWorkers.push_back([&]() {
-            auto index = nextFunction.fetch_add(1);
-            // get the next task, if there is one
-            if (index >= numFunctions) {
-              return ThreadWorkState::Finished; // nothing left
-            }
-            Function* func = this->wasm->functions[index].get();
-            // do the current task: run all passes on this function
-            for (auto* pass : stack) {
-              runPassOnFunction(pass, func);
-            }
-            if (index + 1 == numFunctions) {
-              return ThreadWorkState::Finished; // we did the last one
-            }
-            return ThreadWorkState::More;
-          });
+      if (modulePassesOnly) {
+        stack.clear();
+        return;
+      }
+      if (hasFunctionFilter) {
+        // only the requested functions
+        std::vector<Function*> funcs;
+        for (auto index : functionFilter) {
+          if (index < wasm->functions.size()) {
+            funcs.push_back(wasm->functions[index].get());
+          }
         }
-        ThreadPool::get()->work(doWorkers);
+        runStackParallelOn(stack, funcs);
+      } else if (shardCount > 0) {
+        // only this shard's slice of the functions
+        std::vector<Function*> funcs;
+        for (Index i = shardIndex; i < wasm->functions.size(); i += shardCount) {
+          funcs.push_back(wasm->functions[i].get());
+        }
+        runStackParallelOn(stack, funcs);
+      } else {
+        runStackParallel(stack);
       }
       stack.clear();
     };
@@ -265,11 +342,146 @@ void PassRunner::run() {
         stack.push_back(pass);
       } else {
         flush();
-        pass->run(this, wasm);
+        if (shardCount == 0 && !hasFunctionFilter) {
+          // shard/filtered workers skip module-level passes; the merge
+          // step (or a normal run) does them
+          pass->run(this, wasm);
+        }
       }
     }
     flush();
   }
+  if (converge && !isNested) {
+    runConvergeLoop();
+  }
+}
+
+void PassRunner::runConvergeLoop() {
+  std::vector<Pass*> stack;
+  for (auto* pass : passes) {
+    if (pass->isFunctionParallel()) {
+      stack.push_back(pass);
+    }
+  }
+  if (stack.empty()) return;
+  // snapshot every function's content hash, run the sub-pipeline once more
+  // over everything, and from then on iterate only on the functions the
+  // previous round actually changed, until nothing does. a cap guards
+  // against a pathological pair of passes that keep undoing each other
+  std::map<Function*, uint64_t> hashes;
+  std::vector<Function*> targets;
+  for (auto& func : wasm->functions) {
+    hashes[func.get()] = FunctionAnalysisCache::hashFunction(func.get());
+    targets.push_back(func.get());
+  }
+  const Index MAX_CONVERGE_ITERATIONS = 100;
+  for (Index iteration = 0; iteration < MAX_CONVERGE_ITERATIONS; iteration++) {
+    runStackParallelOn(stack, targets);
+    // only the functions we just ran on can have changed
+    std::vector<Function*> changed;
+    for (auto* func : targets) {
+      auto digest = FunctionAnalysisCache::hashFunction(func);
+      if (hashes[func] != digest) {
+        changed.push_back(func);
+        hashes[func] = digest;
+      }
+    }
+    if (changed.empty()) break;
+    targets.swap(changed);
+  }
+}
+
+void PassRunner::runStackParallel(std::vector<Pass*>& stack) {
+  if (stack.empty()) return;
+  // lazily-read bodies are materialized through a single reader, so
+  // get them all in place before fanning out
+  if (wasm->lazyFunctionBodyProvider) {
+    for (auto& func : wasm->functions) {
+      wasm->ensureFunctionBody(func.get());
+    }
+  }
+  std::vector<Function*> funcs;
+  funcs.reserve(wasm->functions.size());
+  for (auto& func : wasm->functions) {
+    funcs.push_back(func.get());
+  }
+  runStackParallelOn(stack, funcs);
+}
+
+void PassRunner::runStackParallelOn(std::vector<Pass*>& stack, std::vector<Function*>& funcs) {
+  if (stack.empty() || funcs.empty()) return;
+  if (options.memBudget && wasm->allocator.totalBytes() > options.memBudget) {
+    // over the soft budget: shed the per-worker side arenas this batch
+    // would grow, and let go of pooled chunks we are holding spare
+    MixedArena::flushChunkPool();
+    for (auto* func : funcs) {
+      for (auto* pass : stack) {
+        runPassOnFunction(pass, func);
+      }
+    }
+    return;
+  }
+  if (ThreadPool::isRunning()) {
+    // a parallel section is already in flight (e.g. a nested runner inside
+    // a worker): the lock-step pool cannot nest, so run serially here -
+    // the outer section is already keeping the cores busy
+    for (auto* func : funcs) {
+      for (auto* pass : stack) {
+        runPassOnFunction(pass, func);
+      }
+    }
+    return;
+  }
+  // run the stack of passes on all the functions, in parallel
+  size_t num = ThreadPool::get()->size();
+  size_t numFunctions = funcs.size();
+  // the workers claim functions off a single shared queue, which
+  // balances load well except at the tail: with skewed function sizes
+  // a huge function claimed last keeps one core grinding while the
+  // rest idle. claim functions in decreasing size order instead,
+  // which bounds the idle tail by the largest single function.
+  //
+  // on worker-function affinity: the fused stack already gives the
+  // strongest locality form - one worker runs the *entire* sub-pipeline
+  // on a function while it is hot - and pinning functions to workers
+  // across separate batches would trade away dynamic load balance for
+  // L2 reuse across batches that other passes have already evicted.
+  // per-thread arenas (side arenas plus the TLS resolution cache) keep
+  // worker allocations node-local already
+  std::vector<size_t> order(numFunctions);
+  std::iota(order.begin(), order.end(), 0);
+  if (num > 1 && numFunctions > 1) {
+    std::vector<Index> costs(numFunctions);
+    for (size_t i = 0; i < numFunctions; i++) {
+      costs[i] = Measurer::measure(funcs[i]->body);
+    }
+    std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) {
+      return costs[a] > costs[b];
+    });
+  }
+  std::vector<std::function<ThreadWorkState ()>> doWorkers;
+  std::atomic<size_t> nextFunction;
+  nextFunction.store(0);
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&]() {
+      auto index = nextFunction.fetch_add(1);
+      // get the next task, if there is one
+      if (index >= numFunctions) {
+        return ThreadWorkState::Finished; // nothing left
+      }
+      Function* func = funcs[order[index]];
+      // do the current task: run the whole fused sub-pipeline on
+      // this function
+      for (auto* pass : stack) {
+        runPassOnFunction(pass, func);
+      }
+      if (index + 1 == numFunctions) {
+        return ThreadWorkState::Finished; // we did the last one
+      }
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
 }
 
 void PassRunner::runFunction(Function* func) {
@@ -281,6 +493,17 @@ void PassRunner::runFunction(Function* func) {
   }
 }
 
+PassRunner::PassRunner(Module* wasm) : wasm(wasm), allocator(&wasm->allocator) {}
+PassRunner::PassRunner(Module* wasm, PassOptions options) : wasm(wasm), allocator(&wasm->allocator), options(options) {}
+PassRunner::PassRunner(PassRunner&& other) = default;
+
+FunctionAnalysisCache& PassRunner::getAnalysisCache() {
+  if (!analysisCache) {
+    analysisCache = make_unique<FunctionAnalysisCache>();
+  }
+  return *analysisCache;
+}
+
 PassRunner::~PassRunner() {
   for (auto pass : passes) {
     delete pass;
@@ -294,6 +517,9 @@ void PassRunner::doAdd(Pass* pass) {
 
 void PassRunner::runPassOnFunction(Pass* pass, Function* func) {
   assert(pass->isFunctionParallel());
+  // in parallel contexts the body has been materialized already, so this
+  // only does lazy work when we are running serially
+  wasm->ensureFunctionBody(func);
   // function-parallel passes get a new instance per function
   auto instance = std::unique_ptr<Pass>(pass->create());
   instance->runFunction(this, wasm, func);
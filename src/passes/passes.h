@@ -26,6 +26,7 @@ Pass *createCoalesceLocalsPass();
 Pass *createCoalesceLocalsWithLearningPass();
 Pass *createCodePushingPass();
 Pass *createDeadCodeEliminationPass();
+Pass *createDeadStoreEliminationPass();
 Pass *createDuplicateFunctionEliminationPass();
 Pass *createExtractFunctionPass();
 Pass *createFlattenControlFlowPass();
@@ -36,6 +37,7 @@ Pass *createLocalCSEPass();
 Pass *createLogExecutionPass();
 Pass *createInstrumentLocalsPass();
 Pass *createInstrumentMemoryPass();
+Pass *createInstrumentMemoryShadowPass();
 Pass *createMemoryPackingPass();
 Pass *createMergeBlocksPass();
 Pass *createMinifiedPrinterPass();
@@ -63,6 +65,12 @@ Pass *createSimplifyLocalsNoStructurePass();
 Pass *createSimplifyLocalsNoTeeNoStructurePass();
 Pass *createSSAifyPass();
 Pass *createUnteePass();
+Pass *createHotColdSplittingPass();
+Pass *createLoopInvariantCodeMotionPass();
+Pass *createModRefPass();
+Pass *createScheduleLocalsPass();
+Pass *createStoreMergingPass();
+Pass *createVacuumDCEPass();
 Pass *createVacuumPass();
 
 }
@@ -75,6 +75,10 @@ struct ShellExternalInterface : ModuleInstance::ExternalInterface {
         std::memcpy(&memory[address], &value, sizeof(T));
       }
     }
+    // bulk initialization, e.g. for applying data segments
+    void copyIn(size_t address, const char* data, size_t size) {
+      std::memcpy(&memory[address], data, size);
+    }
     template <typename T>
     T get(size_t address) {
       if (aligned<T>(&memory[address])) {
@@ -97,9 +101,8 @@ struct ShellExternalInterface : ModuleInstance::ExternalInterface {
     for (auto& segment : wasm.memory.segments) {
       Address offset = ConstantExpressionRunner<TrivialGlobalManager>(instance.globals).visit(segment.offset).value.geti32();
       assert(offset + segment.data.size() <= wasm.memory.initial * wasm::Memory::kPageSize);
-      for (size_t i = 0; i != segment.data.size(); ++i) {
-        memory.set(offset + i, segment.data[i]);
-      }
+      // in bulk: big memories arrive as big segments
+      memory.copyIn(offset, segment.data.data(), segment.data.size());
     }
 
     table.resize(wasm.table.initial);
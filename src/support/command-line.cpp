@@ -100,8 +100,8 @@ void Options::parse(int argc, const char* argv[]) {
   for (size_t i = 1, e = argc; i != e; ++i) {
     std::string currentOption = argv[i];
 
-    if (dashes(currentOption) == 0) {
-      // Positional.
+    if (dashes(currentOption) == 0 || currentOption == "-") {
+      // Positional ("-" conventionally names stdin/stdout).
       switch (positional) {
         case Arguments::Zero:
           std::cerr << "Unexpected positional argument '" << currentOption
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Contention-free telemetry counters for passes: each thread accumulates
+// into its own storage (no locks, no shared cache lines on the hot path;
+// the global list of per-thread records is touched only once per thread),
+// and reporting aggregates across threads. Names must be string literals
+// or otherwise-interned pointers, as they are compared by pointer.
+//
+// Usage, from any thread:   Counters::note("simplify-locals/sinks", 1);
+// Reporting (main thread):  Counters::report(std::cerr);
+//
+// The pass runner prints the aggregate in its BINARYEN_PASS_TIMES hotspot
+// report, making the numbers available for pipeline tuning without any
+// pass-side locking.
+//
+
+#ifndef wasm_support_counters_h
+#define wasm_support_counters_h
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wasm {
+
+class Counters {
+  struct ThreadRecord {
+    std::unordered_map<const char*, uint64_t> counts;
+  };
+
+  static std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::vector<ThreadRecord*>& registry() {
+    static std::vector<ThreadRecord*> records;
+    return records;
+  }
+
+  static ThreadRecord& threadRecord() {
+    thread_local static ThreadRecord* record = nullptr;
+    if (!record) {
+      // leaked deliberately: threads can outlive reporting, and records
+      // are tiny and bounded by thread count
+      record = new ThreadRecord();
+      std::lock_guard<std::mutex> lock(registryMutex());
+      registry().push_back(record);
+    }
+    return *record;
+  }
+
+public:
+  static void note(const char* name, uint64_t amount = 1) {
+    threadRecord().counts[name] += amount;
+  }
+
+  // aggregates across all threads, sorted by name for stable output
+  static std::map<std::string, uint64_t> get() {
+    std::map<std::string, uint64_t> total;
+    std::lock_guard<std::mutex> lock(registryMutex());
+    for (auto* record : registry()) {
+      for (auto& pair : record->counts) {
+        total[pair.first] += pair.second;
+      }
+    }
+    return total;
+  }
+
+  static void report(std::ostream& o) {
+    for (auto& pair : get()) {
+      o << "[counters]   " << pair.first << ": " << pair.second << '\n';
+    }
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_support_counters_h
@@ -21,6 +21,13 @@
 #include <cstdint>
 #include <limits>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 template <typename T>
 T wasm::read_file(const std::string &filename, Flags::BinaryOption binary, Flags::DebugOption debug) {
   if (debug == Flags::Debug) std::cerr << "Loading '" << filename << "'..." << std::endl;
@@ -49,10 +56,46 @@ T wasm::read_file(const std::string &filename, Flags::BinaryOption binary, Flags
 template std::string wasm::read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 template std::vector<char> wasm::read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 
+wasm::MappedFile::MappedFile(const std::string &filename, Flags::DebugOption debug, bool writable) {
+#ifndef _WIN32
+  if (debug == Flags::Debug) std::cerr << "Mapping '" << filename << "'..." << std::endl;
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      auto prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+      void* ret = mmap(nullptr, size_t(st.st_size), prot, MAP_PRIVATE, fd, 0);
+      if (ret != MAP_FAILED) {
+        mapping = static_cast<const char*>(ret);
+        mappingSize = size_t(st.st_size);
+        mapped = true;
+      }
+    }
+    close(fd);
+  }
+  if (mapped) return;
+  // fall through to the read_file fallback, which also reports failures
+  // to open the file in the usual way
+#endif
+  fallback = read_file<std::vector<char>>(filename, Flags::Binary, debug);
+  mapping = fallback.data();
+  mappingSize = fallback.size();
+}
+
+wasm::MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (mapped) {
+    munmap(const_cast<char*>(mapping), mappingSize);
+  }
+#endif
+}
+
 wasm::Output::Output(const std::string &filename, Flags::BinaryOption binary, Flags::DebugOption debug)
     : outfile(), out([this, filename, binary, debug]() {
         std::streambuf *buffer;
-        if (filename.size()) {
+        // "-" is the conventional name for stdout, as between piped tools;
+        // a file literally named "-" would be a silent trap
+        if (filename.size() && filename != "-") {
           if (debug == Flags::Debug) std::cerr << "Opening '" << filename << "'" << std::endl;
           auto flags = std::ofstream::out | std::ofstream::trunc;
           if (binary == Flags::Binary) flags |= std::ofstream::binary;
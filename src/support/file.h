@@ -45,6 +45,33 @@ T read_file(const std::string &filename, Flags::BinaryOption binary, Flags::Debu
 extern template std::string read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 extern template std::vector<char> read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 
+// A read-only memory mapping of a file, for zero-copy input: readers can
+// parse directly out of the mapping instead of first copying the whole
+// file into memory. On platforms without mmap (or if mapping fails) we
+// fall back to reading the file into a buffer, transparently.
+class MappedFile {
+ public:
+  // writable maps the file copy-on-write (MAP_PRIVATE): in-place
+  // destructive parsing works against kernel-backed pages, copied only
+  // where actually written, and nothing reaches the file
+  MappedFile(const std::string &filename, Flags::DebugOption debug, bool writable = false);
+  ~MappedFile();
+  const char *data() const { return mapping; }
+  char *writableData() { return const_cast<char*>(mapping); } // only with writable=true
+  size_t size() const { return mappingSize; }
+  // Whether an actual OS-level mapping is in use, as opposed to the
+  // read-into-a-buffer fallback.
+  bool isMapped() const { return mapped; }
+
+ private:
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  const char *mapping = nullptr;
+  size_t mappingSize = 0;
+  bool mapped = false;
+  std::vector<char> fallback; // used when we cannot mmap
+};
+
 class Output {
  public:
   // An empty filename will open stdout instead.
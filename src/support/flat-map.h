@@ -0,0 +1,222 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Open-addressing hash map and set for the small keys our hot paths use
+ * (interned Name pointers, expression pointers, local and hash indexes).
+ * One flat allocation of buckets, linear probing, power-of-two capacity:
+ * a probe is a mask and a few adjacent buckets in one cache line, where
+ * the node-based std:: containers chase a pointer per element.
+ *
+ * The tradeoff is that iteration visits buckets in hash order, which is
+ * not deterministic across layouts. These are drop-ins only for
+ * containers that are probed, updated and erased - anything whose
+ * iteration order can reach the output must stay ordered.
+ */
+
+#ifndef wasm_support_flat_map_h
+#define wasm_support_flat_map_h
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace wasm {
+
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class FlatMap {
+  enum State : uint8_t { Empty = 0, Full = 1, Tombstone = 2 };
+
+  struct Bucket {
+    std::pair<Key, Value> entry;
+    State state = Empty;
+  };
+
+  std::vector<Bucket> buckets;
+  size_t used = 0; // Full + Tombstone, what governs probe lengths
+  size_t full = 0;
+
+  size_t bucketFor(const Key& key) const {
+    return Hash()(key) & (buckets.size() - 1);
+  }
+
+  // finds the bucket holding key, or the first insertable one for it
+  size_t probe(const Key& key) const {
+    size_t mask = buckets.size() - 1;
+    size_t i = bucketFor(key);
+    size_t insertable = size_t(-1);
+    while (1) {
+      auto& bucket = buckets[i];
+      if (bucket.state == Empty) {
+        return insertable == size_t(-1) ? i : insertable;
+      }
+      if (bucket.state == Tombstone) {
+        if (insertable == size_t(-1)) insertable = i;
+      } else if (bucket.entry.first == key) {
+        return i;
+      }
+      i = (i + 1) & mask;
+    }
+  }
+
+  void growIfNeeded() {
+    if (buckets.empty()) {
+      buckets.resize(16);
+      return;
+    }
+    // keep load (including tombstones) under 3/4
+    if (used * 4 < buckets.size() * 3) return;
+    std::vector<Bucket> old;
+    old.swap(buckets);
+    // grow only if genuinely full; a tombstone-heavy table just rehashes
+    buckets.resize(full * 4 >= old.size() ? old.size() * 2 : old.size());
+    used = full = 0;
+    for (auto& bucket : old) {
+      if (bucket.state == Full) {
+        emplace(std::move(bucket.entry.first), std::move(bucket.entry.second));
+      }
+    }
+  }
+
+public:
+  typedef std::pair<Key, Value> value_type;
+
+  class iterator {
+    FlatMap* parent;
+    size_t index;
+
+    void skipToFull() {
+      while (index < parent->buckets.size() &&
+             parent->buckets[index].state != Full) {
+        index++;
+      }
+    }
+
+  public:
+    iterator(FlatMap* parent, size_t index) : parent(parent), index(index) {
+      skipToFull();
+    }
+    value_type& operator*() const { return parent->buckets[index].entry; }
+    value_type* operator->() const { return &parent->buckets[index].entry; }
+    iterator& operator++() {
+      index++;
+      skipToFull();
+      return *this;
+    }
+    bool operator==(const iterator& other) const { return index == other.index; }
+    bool operator!=(const iterator& other) const { return index != other.index; }
+
+    friend class FlatMap;
+  };
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, buckets.size()); }
+
+  size_t size() const { return full; }
+  bool empty() const { return full == 0; }
+
+  void clear() {
+    buckets.clear();
+    used = full = 0;
+  }
+
+  void reserve(size_t count) {
+    size_t needed = 16;
+    while (needed * 3 < count * 4) needed *= 2;
+    if (needed > buckets.size()) {
+      std::vector<Bucket> old;
+      old.swap(buckets);
+      buckets.resize(needed);
+      used = full = 0;
+      for (auto& bucket : old) {
+        if (bucket.state == Full) {
+          emplace(std::move(bucket.entry.first), std::move(bucket.entry.second));
+        }
+      }
+    }
+  }
+
+  iterator find(const Key& key) {
+    if (buckets.empty()) return end();
+    size_t i = probe(key);
+    if (buckets[i].state != Full) return end();
+    return iterator(this, i);
+  }
+
+  size_t count(const Key& key) {
+    return find(key) != end() ? 1 : 0;
+  }
+
+  std::pair<iterator, bool> emplace(Key key, Value value = Value()) {
+    growIfNeeded();
+    size_t i = probe(key);
+    auto& bucket = buckets[i];
+    if (bucket.state == Full) {
+      return std::make_pair(iterator(this, i), false);
+    }
+    if (bucket.state == Empty) used++;
+    bucket.entry.first = std::move(key);
+    bucket.entry.second = std::move(value);
+    bucket.state = Full;
+    full++;
+    return std::make_pair(iterator(this, i), true);
+  }
+
+  Value& operator[](const Key& key) {
+    return emplace(key).first->second;
+  }
+
+  Value& at(const Key& key) {
+    auto iter = find(key);
+    assert(iter != end());
+    return iter->second;
+  }
+
+  void erase(iterator iter) {
+    auto& bucket = buckets[iter.index];
+    assert(bucket.state == Full);
+    bucket.entry = value_type();
+    bucket.state = Tombstone;
+    full--;
+  }
+
+  size_t erase(const Key& key) {
+    auto iter = find(key);
+    if (iter == end()) return 0;
+    erase(iter);
+    return 1;
+  }
+};
+
+// a set is a map to nothing; the empty struct value keeps buckets small
+template<typename Key, typename Hash = std::hash<Key>>
+class FlatSet {
+  struct Nothing {};
+  FlatMap<Key, Nothing, Hash> map;
+
+public:
+  size_t size() const { return map.size(); }
+  bool empty() const { return map.empty(); }
+  void clear() { map.clear(); }
+  void reserve(size_t count) { map.reserve(count); }
+  size_t count(const Key& key) { return map.count(key); }
+  bool insert(const Key& key) { return map.emplace(key).second; }
+  size_t erase(const Key& key) { return map.erase(key); }
+};
+
+} // namespace wasm
+
+#endif // wasm_support_flat_map_h
@@ -34,6 +34,24 @@ inline uint32_t rehash(uint32_t x, uint32_t y) { // see http://www.cse.yorku.ca/
   return hash;
 }
 
+// A 64-bit streaming hasher: mixes whole 64-bit blocks per step (not a
+// byte at a time) with strong avalanche (the splitmix64 finalizer), so
+// structural hashes of big functions collide rarely - collisions are
+// expensive, as they trigger full structural equality checks.
+struct Hasher64 {
+  uint64_t digest = 14695981039346656037ULL;
+
+  void feed(uint64_t block) {
+    digest ^= block;
+    // splitmix64 mix
+    digest += 0x9e3779b97f4a7c15ULL;
+    uint64_t z = digest;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    digest = z ^ (z >> 31);
+  }
+};
+
 } // namespace wasm
 
 #endif // wasm_support_hash_h
@@ -19,6 +19,8 @@
 
 #include <cstring>
 
+#include <vector>
+
 #include "emscripten-optimizer/istring.h"
 
 namespace wasm {
@@ -45,6 +47,16 @@ struct Name : public cashew::IString {
   }
 
   static Name fromInt(size_t i) {
+    // the same small indices recur constantly - every function's params,
+    // locals and generated names count from zero - so cache the interned
+    // names per thread and skip re-interning (and re-stringifying) them
+    thread_local static std::vector<Name> cache;
+    if (i < 4096) {
+      while (cache.size() <= i) {
+        cache.push_back(Name(cashew::IString(std::to_string(cache.size()).c_str(), false)));
+      }
+      return cache[i];
+    }
     return cashew::IString(std::to_string(i).c_str(), false);
   }
 
@@ -55,4 +67,10 @@ struct Name : public cashew::IString {
 
 } // namespace wasm
 
+namespace std {
+
+template<> struct hash<wasm::Name> : hash<cashew::IString> {};
+
+} // namespace std
+
 #endif // wasm_support_string_h
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A set of small integers in a known range, with O(1) insert, erase and
+// membership, plus dense iteration over the members - the classic sparse
+// set (a member list plus a position map). Liveness-style analyses mutate
+// and iterate such sets once per action, where sorted-vector sets pay a
+// shift per operation.
+//
+
+#ifndef wasm_support_sparse_set_h
+#define wasm_support_sparse_set_h
+
+#include <cstdint>
+#include <vector>
+
+namespace wasm {
+
+class SparseSet {
+public:
+  SparseSet(uint32_t universe = 0) { setUniverse(universe); }
+
+  void setUniverse(uint32_t universe) {
+    positions.resize(universe);
+    members.clear();
+  }
+
+  void clear() { members.clear(); }
+
+  bool has(uint32_t x) const {
+    auto pos = positions[x];
+    return pos < members.size() && members[pos] == x;
+  }
+
+  // returns whether x was newly inserted
+  bool insert(uint32_t x) {
+    if (has(x)) return false;
+    positions[x] = members.size();
+    members.push_back(x);
+    return true;
+  }
+
+  // returns whether x was present
+  bool erase(uint32_t x) {
+    if (!has(x)) return false;
+    auto pos = positions[x];
+    auto last = members.back();
+    members[pos] = last;
+    positions[last] = pos;
+    members.pop_back();
+    return true;
+  }
+
+  uint32_t size() const { return members.size(); }
+
+  // dense, unordered iteration over the members
+  std::vector<uint32_t>::const_iterator begin() const { return members.begin(); }
+  std::vector<uint32_t>::const_iterator end() const { return members.end(); }
+
+private:
+  std::vector<uint32_t> members;
+  std::vector<uint32_t> positions; // member => its index in members (garbage for non-members)
+};
+
+} // namespace wasm
+
+#endif // wasm_support_sparse_set_h
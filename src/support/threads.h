@@ -66,7 +66,17 @@ private:
 //
 // A pool of helper threads.
 //
-// There is only one, to avoid recursive pools using too many cores.
+// There is only one, to avoid recursive pools using too many cores. The
+// pool is lock-step: work() hands every worker a claim-loop and waits, so
+// parallel sections cannot nest - nested users (parallelFor, the pass
+// runner) detect isRunning() and fall back to running inline, which is
+// the right behavior anyway: the outer section already owns the cores,
+// and an inner section stealing threads from it would just thrash.
+// Cooperative task-group sharing (several independent pools of work
+// interleaving on one set of threads) would need a work-stealing
+// scheduler with per-group completion tracking - a different pool design;
+// if that lands, the single chokepoint to change is work() plus the
+// isRunning() checks in the nested users.
 //
 
 class ThreadPool {
@@ -106,6 +116,43 @@ private:
   bool areThreadsReady();
 };
 
+//
+// Runs work(index, workerId) for every index in [0, total), on the thread
+// pool when one is available (inline otherwise, or when already inside a
+// parallel section). Indexes are claimed off a single shared queue, so
+// with per-index output slots this is the deterministic parallel-map step
+// the analyses share; workerId (always 0 when inline) lets callers keep
+// per-worker scratch state.
+//
+
+template<typename F>
+inline void parallelFor(size_t total, F work) {
+  size_t numWorkers = ThreadPool::get()->size();
+  if (numWorkers <= 1 || total <= 1 || ThreadPool::isRunning()) {
+    for (size_t i = 0; i < total; i++) {
+      work(i, size_t(0));
+    }
+    return;
+  }
+  std::atomic<size_t> next;
+  next.store(0);
+  std::vector<std::function<ThreadWorkState ()>> doWorkers;
+  for (size_t w = 0; w < numWorkers; w++) {
+    doWorkers.push_back([&, w]() {
+      auto index = next.fetch_add(1);
+      if (index >= total) {
+        return ThreadWorkState::Finished; // nothing left
+      }
+      work(index, w);
+      if (index + 1 == total) {
+        return ThreadWorkState::Finished; // we claimed the last one
+      }
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+}
+
 // Verify a code segment is only entered once. Usage:
 //    static OnlyOnce onlyOnce;
 //    onlyOnce.verify();
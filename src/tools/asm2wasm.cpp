@@ -147,11 +147,35 @@ int main(int argc, const char *argv[]) {
   // wasm binaries can contain a names section, but not full debug info --
   // debug info is disabled if a map file is not specified with wasm binary
   pre.debugInfo = options.passOptions.debugInfo && (!emitBinary || sourceMapFilename.size());
-  auto input(
-      read_file<std::vector<char>>(options.extra["infile"], Flags::Text, options.debug ? Flags::Debug : Flags::Release));
-  char *start = pre.process(input.data());
+  // map the input copy-on-write when possible: the preprocessor and
+  // cashew both parse destructively in place, and a private mapping only
+  // copies the pages they actually write, instead of reading 300 MB into
+  // a buffer up front. the parser needs a terminating NUL; the kernel
+  // zero-fills the slack of the final partial page, so only exactly
+  // page-multiple files (no slack byte) fall back to the copying path
+  MappedFile mapped(options.extra["infile"], options.debug ? Flags::Debug : Flags::Release, true);
+  std::vector<char> input;
+  char* rawInput;
+  if (mapped.isMapped() && (mapped.size() % 4096) != 0) {
+    rawInput = mapped.writableData();
+  } else {
+    // copy out of the mapping (or its internal fallback buffer) and
+    // append the NUL ourselves
+    input.assign(mapped.data(), mapped.data() + mapped.size());
+    input.push_back('\0');
+    rawInput = input.data();
+  }
+  char *start = pre.process(rawInput);
 
   if (options.debug) std::cerr << "parsing..." << std::endl;
+  // This parse is the serial prefix of asm2wasm: everything after it
+  // (translation on this thread, optimization on the worker threads via
+  // OptimizingIncrementalModuleBuilder) is already overlapped. Overlapping
+  // the parse itself would need cashew to skip inner function bodies with
+  // a bracket-matching scan and reparse them on demand, so that processAsm
+  // could start on early functions while later ones still parse; cashew's
+  // recursive descent is all-or-nothing today, and we keep it close to
+  // upstream emscripten rather than forking it for that.
   cashew::Parser<Ref, DotZeroValueBuilder> builder;
   Ref asmjs = builder.parseToplevel(start);
 
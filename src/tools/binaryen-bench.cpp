@@ -0,0 +1,209 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// binaryen-bench: parameterized performance benchmarks over a given module,
+// so perf claims can be evaluated with numbers instead of adjectives.
+// check.py answers "is it correct"; this answers "what did it cost".
+//
+// Benchmarks: binary reading, binary writing, each pass of the default
+// pipeline (function-parallel ones as their own parallel batches), and the
+// full -O pipeline, with warmup and iteration control. Optionally compares
+// against a previous run's report and fails on regression past a
+// threshold, for use as a CI gate:
+//
+//   binaryen-bench big.wasm --iterations=5 --save=base.bench
+//   ... make changes ...
+//   binaryen-bench big.wasm --iterations=5 --compare=base.bench --threshold=10
+//
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+
+#include "pass.h"
+#include "support/command-line.h"
+#include "support/file.h"
+#include "wasm-binary.h"
+#include "wasm-io.h"
+#include "wasm-printing.h"
+#include "wasm-validator.h"
+
+using namespace wasm;
+
+namespace {
+
+struct Bench {
+  Index warmup = 1;
+  Index iterations = 3;
+  std::map<std::string, double> results; // benchmark name => best seconds
+
+  // runs a benchmark: fn() is timed (after warmup runs), and the best
+  // iteration is recorded, which is the least noisy estimator for
+  // throughput work like ours
+  template<typename F>
+  void run(const std::string& name, F fn) {
+    for (Index i = 0; i < warmup; i++) {
+      fn();
+    }
+    double best = -1;
+    for (Index i = 0; i < iterations; i++) {
+      auto before = std::chrono::steady_clock::now();
+      fn();
+      std::chrono::duration<double> diff = std::chrono::steady_clock::now() - before;
+      if (best < 0 || diff.count() < best) best = diff.count();
+    }
+    results[name] = best;
+    std::cout << name << ": " << best << " s\n";
+  }
+
+  void save(const std::string& filename) {
+    std::ofstream out(filename);
+    for (auto& pair : results) {
+      out << pair.first << ' ' << pair.second << '\n';
+    }
+  }
+
+  // returns the number of regressions beyond thresholdPercent
+  int compare(const std::string& filename, double thresholdPercent) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+      std::cerr << "could not open baseline " << filename << '\n';
+      return 1;
+    }
+    int regressions = 0;
+    std::string name;
+    double base;
+    while (in >> name >> base) {
+      auto iter = results.find(name);
+      if (iter == results.end()) continue;
+      auto change = 100 * (iter->second - base) / base;
+      if (change > thresholdPercent) {
+        std::cout << "REGRESSION: " << name << " went from " << base << " s to "
+                  << iter->second << " s (+" << change << "%)\n";
+        regressions++;
+      }
+    }
+    return regressions;
+  }
+};
+
+} // anonymous namespace
+
+int main(int argc, const char* argv[]) {
+  Bench bench;
+  std::string saveFile, compareFile;
+  double threshold = 5; // percent
+  Options options("binaryen-bench", "Benchmark binaryen over a .wasm or .wast module");
+  options
+      .add("--warmup", "-w", "Warmup runs per benchmark (default 1)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) { bench.warmup = atoi(argument.c_str()); })
+      .add("--iterations", "-i", "Timed runs per benchmark, best is kept (default 3)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) { bench.iterations = atoi(argument.c_str()); })
+      .add("--save", "-s", "Save the report to a file, for later comparison",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) { saveFile = argument; })
+      .add("--compare", "-c", "Compare against a saved report, failing on regressions",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) { compareFile = argument; })
+      .add("--threshold", "-t", "Regression threshold in percent (default 5)",
+           Options::Arguments::One,
+           [&](Options* o, const std::string& argument) { threshold = atof(argument.c_str()); })
+      .add_positional("INFILE", Options::Arguments::One,
+                      [](Options* o, const std::string& argument) {
+                        o->extra["infile"] = argument;
+                      });
+  options.parse(argc, argv);
+
+  // load the input once, outside any timing
+  Module wasm;
+  try {
+    ModuleReader reader;
+    reader.read(options.extra["infile"], wasm);
+  } catch (ParseException& p) {
+    p.dump(std::cerr);
+    Fatal() << "error in parsing input";
+  }
+  if (!WasmValidator().validate(wasm)) {
+    Fatal() << "input does not validate";
+  }
+
+  // binary write (of the original module)
+  BufferWithRandomAccess binary(false);
+  bench.run("write-binary", [&]() {
+    binary.clear();
+    WasmBinaryWriter writer(&wasm, binary, false);
+    writer.write();
+  });
+
+  // binary read
+  {
+    std::vector<char> input(binary.begin(), binary.end());
+    bench.run("read-binary", [&]() {
+      Module fresh;
+      WasmBinaryBuilder parser(fresh, input, false);
+      parser.read();
+    });
+  }
+
+  // each pass of the default pipeline, on a fresh module each iteration
+  // so a pass can't starve its successor of work
+  {
+    PassRunner sample(&wasm);
+    sample.addDefaultOptimizationPasses();
+    std::vector<std::string> names;
+    for (auto* pass : sample.passes) {
+      if (std::find(names.begin(), names.end(), pass->name) == names.end()) {
+        names.push_back(pass->name);
+      }
+    }
+    std::vector<char> input(binary.begin(), binary.end());
+    for (auto& name : names) {
+      bench.run("pass-" + name, [&]() {
+        Module fresh;
+        WasmBinaryBuilder parser(fresh, input, false);
+        parser.read();
+        PassRunner runner(&fresh);
+        runner.add(name);
+        runner.run();
+      });
+    }
+    // and the whole pipeline
+    bench.run("O2-pipeline", [&]() {
+      Module fresh;
+      WasmBinaryBuilder parser(fresh, input, false);
+      parser.read();
+      PassRunner runner(&fresh);
+      runner.addDefaultOptimizationPasses();
+      runner.run();
+    });
+  }
+
+  if (saveFile.size()) {
+    bench.save(saveFile);
+  }
+  if (compareFile.size()) {
+    auto regressions = bench.compare(compareFile, threshold);
+    if (regressions) {
+      Fatal() << regressions << " benchmark regression(s)";
+    }
+    std::cout << "no regressions\n";
+  }
+  return 0;
+}
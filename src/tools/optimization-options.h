@@ -18,6 +18,8 @@
 // Shared optimization options for commandline tools
 //
 
+#include <fstream>
+
 namespace wasm {
 
 struct OptimizationOptions : public Options {
@@ -25,9 +27,90 @@ struct OptimizationOptions : public Options {
 
   std::vector<std::string> passes;
   PassOptions passOptions;
+  bool converge = false;
+  Index shardIndex = 0;
+  Index shardCount = 0;
+  bool modulePassesOnly = false;
+  std::vector<Index> functionFilter;
+  bool hasFunctionFilter = false;
 
   OptimizationOptions(const std::string &command, const std::string &description) : Options(command, description) {
-    (*this).add("", "-O", "execute default optimization passes",
+    (*this).add("--pipeline", "-pl", "Run the pass pipeline listed in a file (one pass name per line, # comments, 'O' for the default set)",
+                Options::Arguments::One,
+                [this](Options*, const std::string& argument) {
+                  std::ifstream in(argument);
+                  if (!in.is_open()) {
+                    Fatal() << "could not open pipeline file " << argument;
+                  }
+                  std::string line;
+                  while (std::getline(in, line)) {
+                    // trim whitespace and comments
+                    auto hash = line.find('#');
+                    if (hash != std::string::npos) line = line.substr(0, hash);
+                    while (!line.empty() && isspace(line.back())) line.pop_back();
+                    size_t start = 0;
+                    while (start < line.size() && isspace(line[start])) start++;
+                    line = line.substr(start);
+                    if (line.empty()) continue;
+                    passes.push_back(line == "O" ? std::string(DEFAULT_OPT_PASSES) : line);
+                  }
+                })
+           .add("--profile", "-prof", "Consume a call-count profile ('<function name> <count>' lines) for profile-guided passes",
+                Options::Arguments::One,
+                [this](Options*, const std::string& argument) {
+                  std::ifstream in(argument);
+                  if (!in.is_open()) {
+                    Fatal() << "could not open profile " << argument;
+                  }
+                  std::string name;
+                  uint64_t count;
+                  while (in >> name >> count) {
+                    passOptions.profile[Name(name)] += count;
+                  }
+                })
+           .add("--instrument-sample-rate", "-isr", "Make instrumentation passes call out only every N events",
+                Options::Arguments::One,
+                [this](Options*, const std::string& argument) {
+                  passOptions.instrumentSampleRate = atoi(argument.c_str());
+                })
+           .add("--selectify-max-cost", "-smc", "Only turn if/else into select when both arms' summed cost is at most this",
+                Options::Arguments::One,
+                [this](Options*, const std::string& argument) {
+                  passOptions.selectifyMaxCost = atoi(argument.c_str());
+                })
+           .add("--shard-index", "-si", "This worker's shard (with --shard-count; runs only function passes, on that slice)",
+                Options::Arguments::One,
+                [this](Options*, const std::string& argument) {
+                  shardIndex = atoi(argument.c_str());
+                })
+           .add("--shard-count", "-sc", "Total number of shards (see scripts/shard-opt.py)",
+                Options::Arguments::One,
+                [this](Options*, const std::string& argument) {
+                  shardCount = atoi(argument.c_str());
+                })
+           .add("--func-filter", "-ff", "Run function passes only on the comma-separated function indices (skips module passes)",
+                Options::Arguments::One,
+                [this](Options*, const std::string& argument) {
+                  size_t pos = 0;
+                  while (pos < argument.size()) {
+                    auto comma = argument.find(',', pos);
+                    if (comma == std::string::npos) comma = argument.size();
+                    functionFilter.push_back(atoi(argument.substr(pos, comma - pos).c_str()));
+                    pos = comma + 1;
+                  }
+                  hasFunctionFilter = true;
+                })
+           .add("--module-passes-only", "-mpo", "Run only module-level passes (the shard merge step)",
+                Options::Arguments::Zero,
+                [this](Options*, const std::string&) {
+                  modulePassesOnly = true;
+                })
+           .add("--converge", "-c", "Run passes to convergence, re-optimizing only functions that keep changing",
+                Options::Arguments::Zero,
+                [this](Options*, const std::string&) {
+                  converge = true;
+                })
+           .add("", "-O", "execute default optimization passes",
                 Options::Arguments::Zero,
                 [this](Options*, const std::string&) {
                   passOptions.optimizeLevel = 2;
@@ -89,6 +172,11 @@ struct OptimizationOptions : public Options {
                 Options::Arguments::Zero,
                 [this](Options*, const std::string&) {
                   passOptions.ignoreImplicitTraps = true;
+                })
+           .add("--mem-budget", "-mb", "Soft memory budget in MB: over it, parallel passes degrade to serial and spare arena chunks are released, instead of risking an OOM kill",
+                Options::Arguments::One,
+                [this](Options* o, const std::string& argument) {
+                  passOptions.memBudget = size_t(atoi(argument.c_str())) * 1024 * 1024;
                 });
     // add passes in registry
     for (const auto& p : PassRegistry::get()->getRegisteredNames()) {
@@ -118,6 +206,10 @@ struct OptimizationOptions : public Options {
   PassRunner getPassRunner(Module& wasm) {
     PassRunner passRunner(&wasm, passOptions);
     if (debug) passRunner.setDebug(true);
+    if (converge) passRunner.setConverge(true);
+    if (shardCount > 0) passRunner.setShard(shardIndex, shardCount);
+    if (modulePassesOnly) passRunner.setModulePassesOnly(true);
+    if (hasFunctionFilter) passRunner.setFunctionFilter(functionFilter);
     for (auto& pass : passes) {
       if (pass == DEFAULT_OPT_PASSES) {
         passRunner.addDefaultOptimizationPasses();
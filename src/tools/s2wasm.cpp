@@ -149,7 +149,7 @@ int main(int argc, const char *argv[]) {
     bool error;
     Archive lib(archiveFile, error);
     if (error) Fatal() << "Error opening archive " << m << "\n";
-    linker.linkArchive(lib);
+    linker.linkArchive(lib, m);
   }
 
   if (generateEmscriptenGlue) {
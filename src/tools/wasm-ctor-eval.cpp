@@ -242,7 +242,68 @@ struct CtorEvalExternalInterface : EvallingModuleInstance::ExternalInterface {
     throw FailToEvalException(std::string("trap: ") + why);
   }
 
+  // An undo journal for the singleton memory segment: the first store to a
+  // page saves that page's prior contents, so a failed ctor rolls back just
+  // the pages it touched instead of the tool copying the whole heap before
+  // every ctor. (Stack-area writes are not journaled: the stack's contents
+  // are explicitly undefined after a ctor returns.)
+  void startJournal() {
+    journal.clear();
+    if (wasm->memory.segments.empty()) {
+      journaledSegmentSize = 0;
+      hadSegment = false;
+    } else {
+      journaledSegmentSize = wasm->memory.segments[0].data.size();
+      hadSegment = true;
+    }
+  }
+
+  void commitJournal() {
+    journal.clear();
+  }
+
+  void rollbackJournal() {
+    if (!hadSegment) {
+      // the segment (if one appeared) is entirely new
+      wasm->memory.segments.clear();
+      journal.clear();
+      return;
+    }
+    auto& data = wasm->memory.segments[0].data;
+    data.resize(journaledSegmentSize);
+    for (auto& pair : journal) {
+      auto start = pair.first * JOURNAL_PAGE_SIZE;
+      if (start >= data.size()) continue; // the page was past the old end
+      auto num = std::min(JOURNAL_PAGE_SIZE, data.size() - start);
+      std::copy(pair.second.begin(), pair.second.begin() + num, data.begin() + start);
+    }
+    journal.clear();
+  }
+
 private:
+  static const size_t JOURNAL_PAGE_SIZE = 4096;
+
+  std::map<size_t, std::vector<char>> journal; // page index => saved contents
+  size_t journaledSegmentSize = 0; // segment size when the journal started
+  bool hadSegment = false;
+
+  // saves the prior contents of the pages a store to [address, address+bytes)
+  // touches, the first time each page is stored to
+  void journalWrite(Address address, size_t bytes) {
+    auto& data = wasm->memory.segments[0].data;
+    auto first = address / JOURNAL_PAGE_SIZE;
+    auto last = (address + bytes - 1) / JOURNAL_PAGE_SIZE;
+    for (auto page = first; page <= last; page++) {
+      if (journal.count(page)) continue;
+      auto& saved = journal[page];
+      auto start = page * JOURNAL_PAGE_SIZE;
+      if (start < data.size()) {
+        auto num = std::min(JOURNAL_PAGE_SIZE, data.size() - start);
+        saved.assign(data.begin() + start, data.begin() + start + num);
+      }
+    }
+  }
+
   // TODO: handle unaligned too, see shell-interface
 
   template <typename T>
@@ -279,8 +340,12 @@ private:
 
   template <typename T>
   void doStore(Address address, T value) {
+    auto* target = getMemory<T>(address); // note: may create/grow the segment
+    if (address < instance->STACK_START) {
+      journalWrite(address, sizeof(T));
+    }
     // do a memcpy to avoid undefined behavior if unaligned
-    memcpy(getMemory<T>(address), &value, sizeof(T));
+    memcpy(target, &value, sizeof(T));
   }
 
   template <typename T>
@@ -308,8 +373,9 @@ void evalCtors(Module& wasm, std::vector<std::string> ctors) {
     // TODO: if we knew priorities, we could reorder?
     for (auto& ctor : ctors) {
       std::cerr << "trying to eval " << ctor << '\n';
-      // snapshot memory, as either the entire function is done, or none
-      auto memoryBefore = wasm.memory;
+      // either the entire function is done, or none: journal the stores,
+      // so a failure rolls back just the pages the ctor touched
+      interface.startJournal();
       // snapshot globals (note that STACKTOP might be modified, but should
       // be returned, so that works out)
       auto globalsBefore = instance.globals;
@@ -319,14 +385,15 @@ void evalCtors(Module& wasm, std::vector<std::string> ctors) {
         // that's it, we failed, so stop here, cleaning up partial
         // memory changes first
         std::cerr << "  ...stopping since could not eval: " << fail.why << "\n";
-        wasm.memory = memoryBefore;
+        interface.rollbackJournal();
         return;
       }
       if (instance.globals != globalsBefore) {
         std::cerr << "  ...stopping since globals modified\n";
-        wasm.memory = memoryBefore;
+        interface.rollbackJournal();
         return;
       }
+      interface.commitJournal();
       std::cerr << "  ...success on " << ctor << ".\n";
       // success, the entire function was evalled!
       auto* exp = wasm.getExport(ctor);
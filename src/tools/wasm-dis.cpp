@@ -29,6 +29,7 @@ using namespace wasm;
 
 int main(int argc, const char *argv[]) {
   std::string sourceMapFilename;
+  std::vector<std::string> functionFilters;
   Options options("wasm-dis", "Un-assemble a .wasm (WebAssembly binary format) into a .wast (WebAssembly text format)");
   options.add("--output", "-o", "Output file (stdout if not specified)",
               Options::Arguments::One,
@@ -39,6 +40,9 @@ int main(int argc, const char *argv[]) {
       .add("--source-map", "-sm", "Consume source map from the specified file to add location information",
            Options::Arguments::One,
            [&sourceMapFilename](Options *o, const std::string &argument) { sourceMapFilename = argument; })
+      .add("--function", "-f", "Print only the given function(s): a name, an index into the defined functions, or an index range N-M; repeatable. Only the requested bodies are decoded",
+           Options::Arguments::One,
+           [&functionFilters](Options *o, const std::string &argument) { functionFilters.push_back(argument); })
       .add_positional("INFILE", Options::Arguments::One,
                       [](Options *o, const std::string &argument) {
                         o->extra["infile"] = argument;
@@ -49,9 +53,13 @@ int main(int argc, const char *argv[]) {
 
   if (options.debug) std::cerr << "parsing binary..." << std::endl;
   Module wasm;
+  // the input and the parser stay alive to the end, so we can read function
+  // bodies lazily, materializing each as it gets printed - output starts
+  // right away on huge modules
+  WasmBinaryBuilder parser(wasm, input, options.debug);
+  parser.setLazyFunctionBodies(true);
   try {
     std::unique_ptr<std::ifstream> sourceMapStream;
-    WasmBinaryBuilder parser(wasm, input, options.debug);
     if (sourceMapFilename.size()) {
         sourceMapStream = make_unique<std::ifstream>();
         sourceMapStream->open(sourceMapFilename);
@@ -71,8 +79,49 @@ int main(int argc, const char *argv[]) {
 
   if (options.debug) std::cerr << "Printing..." << std::endl;
   Output output(options.extra["output"], Flags::Text, options.debug ? Flags::Debug : Flags::Release);
-  WasmPrinter::printModule(&wasm, output.getStream());
-  output << '\n';
+  try {
+    if (functionFilters.empty()) {
+      WasmPrinter::printModule(&wasm, output.getStream());
+      output << '\n';
+    } else {
+      // print just the requested functions; with the lazy reader, only
+      // their bodies are ever decoded
+      std::vector<Function*> selected;
+      for (auto& filter : functionFilters) {
+        if (auto* func = wasm.getFunctionOrNull(filter)) {
+          selected.push_back(func);
+          continue;
+        }
+        // an index, or an inclusive index range N-M, into the defined functions
+        size_t begin, end;
+        auto dash = filter.find('-');
+        try {
+          if (dash == std::string::npos) {
+            begin = end = std::stoul(filter);
+          } else {
+            begin = std::stoul(filter.substr(0, dash));
+            end = std::stoul(filter.substr(dash + 1));
+          }
+        } catch (std::exception&) {
+          Fatal() << "no function '" << filter << "'";
+        }
+        if (begin >= wasm.functions.size() || end >= wasm.functions.size() || begin > end) {
+          Fatal() << "function index out of range: " << filter;
+        }
+        for (size_t i = begin; i <= end; i++) {
+          selected.push_back(wasm.functions[i].get());
+        }
+      }
+      for (auto* func : selected) {
+        wasm.ensureFunctionBody(func);
+        WasmPrinter::printFunction(func, &wasm, output.getStream());
+      }
+    }
+  } catch (ParseException& p) {
+    // a lazily-read body can fail to parse only now, as it is materialized
+    p.dump(std::cerr);
+    Fatal() << "error in parsing wasm binary";
+  }
 
   if (options.debug) std::cerr << "Done." << std::endl;
 }
@@ -21,6 +21,7 @@
 // This is *not* a real linker. It just does naive merging.
 //
 
+#include <atomic>
 #include <memory>
 
 #include "parsing.h"
@@ -30,6 +31,8 @@
 #include "asm_v_wasm.h"
 #include "support/command-line.h"
 #include "support/file.h"
+#include "ast/module-utils.h"
+#include "support/threads.h"
 #include "wasm-io.h"
 #include "wasm-binary.h"
 #include "wasm-builder.h"
@@ -81,8 +84,10 @@ struct Mergeable {
 
   // Imported functions and globals provided by the other mergeable
   // are fused together. We track those here, then remove them
-  std::map<Name, Name> implementedFunctionImports;
-  std::map<Name, Name> implementedGlobalImports;
+  // (hashed on the interned name; only iterated to remove imports,
+  // where order does not matter)
+  std::unordered_map<Name, Name> implementedFunctionImports;
+  std::unordered_map<Name, Name> implementedGlobalImports;
 
   // setups
 
@@ -218,114 +223,126 @@ struct Mergeable {
   }
 };
 
+// Walks all the expressions in a module through walkers made by the
+// factory: module-level expressions (global inits, segment offsets)
+// serially, and the function bodies - the bulk of the work - in parallel.
+// The walkers must only read shared state.
+template<typename Factory>
+static void updateExpressions(Module& wasm, Factory makeWalker) {
+  {
+    auto walker = makeWalker();
+    walker.setModule(&wasm);
+    for (auto& curr : wasm.globals) {
+      walker.walkGlobal(curr.get());
+    }
+    walker.walkTable(&wasm.table);
+    walker.walkMemory(&wasm.memory);
+  }
+  size_t total = wasm.functions.size();
+  size_t numWorkers = ThreadPool::get()->size();
+  if (numWorkers > 1 && total > 1) {
+    std::atomic<size_t> nextFunction;
+    nextFunction.store(0);
+    std::vector<std::function<ThreadWorkState ()>> doWorkers;
+    for (size_t w = 0; w < numWorkers; w++) {
+      doWorkers.push_back([&]() {
+        auto index = nextFunction.fetch_add(1);
+        if (index >= total) {
+          return ThreadWorkState::Finished; // nothing left
+        }
+        auto walker = makeWalker();
+        walker.setModule(&wasm);
+        walker.walkFunction(wasm.functions[index].get());
+        if (index + 1 == total) {
+          return ThreadWorkState::Finished; // we claimed the last one
+        }
+        return ThreadWorkState::More;
+      });
+    }
+    ThreadPool::get()->work(doWorkers);
+  } else {
+    auto walker = makeWalker();
+    walker.setModule(&wasm);
+    for (auto& curr : wasm.functions) {
+      walker.walkFunction(curr.get());
+    }
+  }
+}
+
 // A mergeable that is an output, that is, that we merge into. This adds
 // logic to update it for the new data, namely, when an import is provided
 // by the other merged unit, we resolve to access that value directly.
-struct OutputMergeable : public PostWalker<OutputMergeable, Visitor<OutputMergeable>>, public Mergeable {
+struct OutputMergeable : public Mergeable {
   OutputMergeable(Module& wasm) : Mergeable(wasm) {}
+};
+
+// The expression updates for an output module: calls and global reads of
+// imports that the merged-in unit now implements resolve directly.
+struct OutputUpdater : public PostWalker<OutputUpdater, Visitor<OutputUpdater>> {
+  OutputMergeable& parent;
+
+  OutputUpdater(OutputMergeable& parent) : parent(parent) {}
 
   void visitCallImport(CallImport* curr) {
-    auto iter = implementedFunctionImports.find(curr->target);
-    if (iter != implementedFunctionImports.end()) {
+    auto iter = parent.implementedFunctionImports.find(curr->target);
+    if (iter != parent.implementedFunctionImports.end()) {
       // this import is now in the module - call it
       replaceCurrent(Builder(*getModule()).makeCall(iter->second, curr->operands, curr->type));
     }
   }
 
   void visitGetGlobal(GetGlobal* curr) {
-    auto iter = implementedGlobalImports.find(curr->name);
-    if (iter != implementedGlobalImports.end()) {
+    auto iter = parent.implementedGlobalImports.find(curr->name);
+    if (iter != parent.implementedGlobalImports.end()) {
       // this global is now in the module - get it
       curr->name = iter->second;
       assert(curr->name.is());
     }
   }
-
-  void visitModule(Module* curr) {
-    // remove imports that are being implemented
-    for (auto& pair : implementedFunctionImports) {
-      curr->removeImport(pair.first);
-    }
-    for (auto& pair : implementedGlobalImports) {
-      curr->removeImport(pair.first);
-    }
-  }
 };
 
 // A mergeable that is an input, that is, that we merge into another.
 // This adds logic to disambiguate its names from the other, and to
 // perform all other merging operations.
-struct InputMergeable : public ExpressionStackWalker<InputMergeable, Visitor<InputMergeable>>, public Mergeable {
+struct InputMergeable : public Mergeable {
   InputMergeable(Module& wasm, OutputMergeable& outputMergeable) : Mergeable(wasm), outputMergeable(outputMergeable) {}
 
   // The unit we are being merged into
   OutputMergeable& outputMergeable;
 
   // mappings (after disambiguating with the other mergeable), old name => new name
-  std::map<Name, Name> ftNames; // function types
-  std::map<Name, Name> eNames; // exports
-  std::map<Name, Name> fNames; // functions
-  std::map<Name, Name> gNames; // globals
-
-  void visitCall(Call* curr) {
-    curr->target = fNames[curr->target];
-    assert(curr->target.is());
-  }
+  // (hashed on the interned name: these are probed for every call and
+  // global access in the input)
+  std::unordered_map<Name, Name> ftNames; // function types
+  std::unordered_map<Name, Name> eNames; // exports
+  std::unordered_map<Name, Name> fNames; // functions
+  std::unordered_map<Name, Name> gNames; // globals
 
-  void visitCallImport(CallImport* curr) {
-    auto iter = implementedFunctionImports.find(curr->target);
-    if (iter != implementedFunctionImports.end()) {
-      // this import is now in the module - call it
-      replaceCurrent(Builder(*getModule()).makeCall(iter->second, curr->operands, curr->type));
-      return;
-    }
-    curr->target = fNames[curr->target];
-    assert(curr->target.is());
-  }
-
-  void visitCallIndirect(CallIndirect* curr) {
-    curr->fullType = ftNames[curr->fullType];
-    assert(curr->fullType.is());
-  }
-
-  void visitGetGlobal(GetGlobal* curr) {
-    auto iter = implementedGlobalImports.find(curr->name);
-    if (iter != implementedGlobalImports.end()) {
-      // this import is now in the module - use it
-      curr->name = iter->second;
-      return;
-    }
-    curr->name = gNames[curr->name];
-    assert(curr->name.is());
-    // if this is the memory or table base, add the bump
-    if (memoryBaseGlobals.count(curr->name)) {
-      addBump(outputMergeable.totalMemorySize);
-    } else if (tableBaseGlobals.count(curr->name)) {
-      addBump(outputMergeable.totalTableSize);
-    }
-  }
-
-  void visitSetGlobal(SetGlobal* curr) {
-    curr->name = gNames[curr->name];
-    assert(curr->name.is());
-  }
+  void updateInputExpressions(); // defined after InputUpdater below
 
   void merge() {
-    // find function imports in us that are implemented in the output
-    // TODO make maps, avoid N^2
+    // find function imports in us that are implemented in the output:
+    // index the output's exports by (kind, exported name) once, instead of
+    // scanning all of them per import
+    std::unordered_map<Name, Export*> outputFunctionExports, outputGlobalExports;
+    for (auto& exp : outputMergeable.wasm.exports) {
+      if (exp->kind == ExternalKind::Function) {
+        outputFunctionExports.emplace(exp->name, exp.get());
+      } else if (exp->kind == ExternalKind::Global) {
+        outputGlobalExports.emplace(exp->name, exp.get());
+      }
+    }
     for (auto& imp : wasm.imports) {
       // per wasm dynamic library rules, we expect to see exports on 'env'
       if ((imp->kind == ExternalKind::Function || imp->kind == ExternalKind::Global) && imp->module == ENV) {
-        // seek an export on the other side that matches
-        for (auto& exp : outputMergeable.wasm.exports) {
-          if (exp->kind == imp->kind && exp->name == imp->base) {
-            // fits!
-            if (imp->kind == ExternalKind::Function) {
-              implementedFunctionImports[imp->name] = exp->value;
-            } else {
-              implementedGlobalImports[imp->name] = exp->value;
-            }
-            break;
+        auto& index = imp->kind == ExternalKind::Function ? outputFunctionExports : outputGlobalExports;
+        auto iter = index.find(imp->base);
+        if (iter != index.end()) {
+          // fits!
+          if (imp->kind == ExternalKind::Function) {
+            implementedFunctionImports[imp->name] = iter->second->value;
+          } else {
+            implementedGlobalImports[imp->name] = iter->second->value;
           }
         }
       }
@@ -382,17 +399,25 @@ struct InputMergeable : public ExpressionStackWalker<InputMergeable, Visitor<Inp
       }
     }
 
-    // find function imports in output that are implemented in the input
+    // find function imports in output that are implemented in the input,
+    // through the same kind of per-merge export index
+    std::unordered_map<Name, Export*> inputFunctionExports, inputGlobalExports;
+    for (auto& exp : wasm.exports) {
+      if (exp->kind == ExternalKind::Function) {
+        inputFunctionExports.emplace(exp->name, exp.get());
+      } else if (exp->kind == ExternalKind::Global) {
+        inputGlobalExports.emplace(exp->name, exp.get());
+      }
+    }
     for (auto& imp : outputMergeable.wasm.imports) {
       if ((imp->kind == ExternalKind::Function || imp->kind == ExternalKind::Global) && imp->module == ENV) {
-        for (auto& exp : wasm.exports) {
-          if (exp->kind == imp->kind && exp->name == imp->base) {
-            if (imp->kind == ExternalKind::Function) {
-              outputMergeable.implementedFunctionImports[imp->name] = fNames[exp->value];
-            } else {
-              outputMergeable.implementedGlobalImports[imp->name] = gNames[exp->value];
-            }
-            break;
+        auto& index = imp->kind == ExternalKind::Function ? inputFunctionExports : inputGlobalExports;
+        auto iter = index.find(imp->base);
+        if (iter != index.end()) {
+          if (imp->kind == ExternalKind::Function) {
+            outputMergeable.implementedFunctionImports[imp->name] = fNames[iter->second->value];
+          } else {
+            outputMergeable.implementedGlobalImports[imp->name] = gNames[iter->second->value];
           }
         }
       }
@@ -401,7 +426,15 @@ struct InputMergeable : public ExpressionStackWalker<InputMergeable, Visitor<Inp
     // update the output before bringing anything in. avoid doing so when possible, as in the
     // common case the output module is very large.
     if (outputMergeable.implementedFunctionImports.size() + outputMergeable.implementedGlobalImports.size() > 0) {
-      outputMergeable.walkModule(&outputMergeable.wasm);
+      auto& out = outputMergeable;
+      updateExpressions(out.wasm, [&out]() { return OutputUpdater(out); });
+      // remove imports that are being implemented
+      for (auto& pair : out.implementedFunctionImports) {
+        out.wasm.removeImport(pair.first);
+      }
+      for (auto& pair : out.implementedGlobalImports) {
+        out.wasm.removeImport(pair.first);
+      }
     }
 
     // memory&table: we place the new memory segments at a higher position. after the existing ones.
@@ -409,7 +442,7 @@ struct InputMergeable : public ExpressionStackWalker<InputMergeable, Visitor<Inp
     copySegment(outputMergeable.wasm.table, wasm.table, [&](Name x) -> Name { return fNames[x]; });
 
     // update the new contents about to be merged in
-    walkModule(&wasm);
+    updateInputExpressions();
 
     // handle the dylink post-instantiate. this is special, as if it exists in both, we must in fact call both
     Name POST_INSTANTIATE("__post_instantiate");
@@ -467,6 +500,65 @@ struct InputMergeable : public ExpressionStackWalker<InputMergeable, Visitor<Inp
     }
   }
 
+};
+
+// The expression updates for an input module: renames everything per the
+// disambiguation maps, resolves imports the output implements, and bumps
+// the memory/table base globals. Only reads the maps, so instances can
+// update functions in parallel.
+struct InputUpdater : public ExpressionStackWalker<InputUpdater, Visitor<InputUpdater>> {
+  InputMergeable& parent;
+
+  InputUpdater(InputMergeable& parent) : parent(parent) {}
+
+  void visitCall(Call* curr) {
+    auto iter = parent.fNames.find(curr->target);
+    assert(iter != parent.fNames.end());
+    curr->target = iter->second;
+  }
+
+  void visitCallImport(CallImport* curr) {
+    auto implemented = parent.implementedFunctionImports.find(curr->target);
+    if (implemented != parent.implementedFunctionImports.end()) {
+      // this import is now in the module - call it
+      replaceCurrent(Builder(*getModule()).makeCall(implemented->second, curr->operands, curr->type));
+      return;
+    }
+    auto iter = parent.fNames.find(curr->target);
+    assert(iter != parent.fNames.end());
+    curr->target = iter->second;
+  }
+
+  void visitCallIndirect(CallIndirect* curr) {
+    auto iter = parent.ftNames.find(curr->fullType);
+    assert(iter != parent.ftNames.end());
+    curr->fullType = iter->second;
+  }
+
+  void visitGetGlobal(GetGlobal* curr) {
+    auto implemented = parent.implementedGlobalImports.find(curr->name);
+    if (implemented != parent.implementedGlobalImports.end()) {
+      // this import is now in the module - use it
+      curr->name = implemented->second;
+      return;
+    }
+    auto iter = parent.gNames.find(curr->name);
+    assert(iter != parent.gNames.end());
+    curr->name = iter->second;
+    // if this is the memory or table base, add the bump
+    if (parent.memoryBaseGlobals.count(curr->name)) {
+      addBump(parent.outputMergeable.totalMemorySize);
+    } else if (parent.tableBaseGlobals.count(curr->name)) {
+      addBump(parent.outputMergeable.totalTableSize);
+    }
+  }
+
+  void visitSetGlobal(SetGlobal* curr) {
+    auto iter = parent.gNames.find(curr->name);
+    assert(iter != parent.gNames.end());
+    curr->name = iter->second;
+  }
+
 private:
   // add an offset to a get_global. we look above, and if there is already an add,
   // we can add into it, avoiding creating a new node
@@ -493,6 +585,11 @@ private:
   }
 };
 
+void InputMergeable::updateInputExpressions() {
+  auto& self = *this;
+  updateExpressions(wasm, [&self]() { return InputUpdater(self); });
+}
+
 // Finalize the memory/table bases, assinging concrete values into them
 void finalizeBases(Module& wasm, Index memory, Index table) {
   struct FinalizableMergeable : public Mergeable, public PostWalker<FinalizableMergeable, Visitor<FinalizableMergeable>> {
@@ -535,6 +632,7 @@ int main(int argc, const char* argv[]) {
   Index finalizeMemoryBase = Index(-1),
         finalizeTableBase = Index(-1);
   bool optimize = false;
+  bool shake = false;
   bool verbose = false;
 
   Options options("wasm-merge", "Merge wasm files");
@@ -558,6 +656,11 @@ int main(int argc, const char* argv[]) {
            [&](Options* o, const std::string& argument) {
              finalizeTableBase = atoi(argument.c_str());
            })
+      .add("--shake", "-s", "Tree-shake the merged module (reachability sweep only, without the full -O pipeline)",
+           Options::Arguments::Zero,
+           [&](Options* o, const std::string& argument) {
+             shake = true;
+           })
       .add("-O", "-O", "Perform merge-time/finalize-time optimizations",
            Options::Arguments::Zero,
            [&](Options* o, const std::string& argument) {
@@ -576,34 +679,42 @@ int main(int argc, const char* argv[]) {
 
   Module output;
   std::vector<std::unique_ptr<Module>> otherModules; // keep all inputs alive, to save copies
-  bool first = true;
-  for (auto& filename : filenames) {
-    ModuleReader reader;
-    if (first) {
-      // read the first right into output, don't waste time merging into an empty module
-      try {
-        reader.read(filename, output);
-      } catch (ParseException& p) {
-        p.dump(std::cerr);
-        Fatal() << "error in parsing input";
-      }
-      first = false;
-    } else {
-      std::unique_ptr<Module> input = wasm::make_unique<Module>();
+  // load and parse every input in parallel - with many inputs, loading is
+  // nearly all of the merge step's time and is perfectly parallel; the
+  // merging itself then proceeds serially, in the given order
+  std::vector<std::unique_ptr<Module>> inputs(filenames.size());
+  {
+    std::mutex parseError;
+    std::string firstError;
+    parallelFor(filenames.size(), [&](size_t i, size_t worker) {
       try {
-        reader.read(filename, *input);
+        ModuleReader reader;
+        if (i == 0) {
+          // the first input is the output, parse straight into it
+          reader.read(filenames[i], output);
+        } else {
+          auto input = wasm::make_unique<Module>();
+          reader.read(filenames[i], *input);
+          inputs[i] = std::move(input);
+        }
       } catch (ParseException& p) {
-        p.dump(std::cerr);
-        Fatal() << "error in parsing input";
+        std::lock_guard<std::mutex> lock(parseError);
+        if (firstError.empty()) firstError = "error in parsing " + filenames[i];
+        return;
       }
-      // perform the merge
-      OutputMergeable outputMergeable(output);
-      InputMergeable inputMergeable(*input, outputMergeable);
-      inputMergeable.merge();
-      // retain the linked in module as we may depend on parts of it
-      otherModules.push_back(std::unique_ptr<Module>(input.release()));
+    });
+    if (!firstError.empty()) {
+      Fatal() << firstError;
     }
   }
+  for (size_t i = 1; i < inputs.size(); i++) {
+    // perform the merge
+    OutputMergeable outputMergeable(output);
+    InputMergeable inputMergeable(*inputs[i], outputMergeable);
+    inputMergeable.merge();
+    // retain the linked in module as we may depend on parts of it
+    otherModules.push_back(std::move(inputs[i]));
+  }
 
   if (verbose) {
     // memory and table are standardized and merged, so it's easy to dump out some stats
@@ -616,6 +727,14 @@ int main(int argc, const char* argv[]) {
     finalizeBases(output, finalizeMemoryBase, finalizeTableBase);
   }
 
+  if (shake && !optimize) {
+    // the post-merge reachability sweep, in memory - no serialize/parse
+    // round trip through a separate wasm-opt invocation
+    PassRunner passRunner(&output);
+    passRunner.add("remove-unused-module-elements");
+    passRunner.run();
+  }
+
   if (optimize) {
     // merge-time/finalize-time optimization
     // it is beneficial to do global optimizations, as well as precomputing to get rid of finalized constants
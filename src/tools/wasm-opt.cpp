@@ -27,6 +27,8 @@
 #include "wasm-printing.h"
 #include "wasm-s-parser.h"
 #include "wasm-validator.h"
+#include "ast/module-utils.h"
+#include "wasm-binary.h"
 #include "wasm-io.h"
 #include "wasm-interpreter.h"
 #include "shell-interface.h"
@@ -110,9 +112,34 @@ int main(int argc, const char* argv[]) {
       .add("--emit-text", "-S", "Emit text instead of binary for the output file",
            Options::Arguments::Zero,
            [&](Options *o, const std::string &argument) { emitBinary = false; })
+      .add("--try-pipelines", "-tp", "Try each comma-separated pipeline file on a clone of the module and keep the smallest result",
+           Options::Arguments::One,
+           [](Options* o, const std::string& argument) {
+             o->extra["try pipelines"] = argument;
+           })
+      .add("--emit-toc", "-toc", "Emit a 'toc' custom section with section extents and function code offsets",
+           Options::Arguments::Zero,
+           [](Options* o, const std::string&) {
+             o->extra["emit toc"] = "1";
+           })
+      .add("--emit-stats-section", "-stats", "Emit a 'binaryen.stats' custom section with per-function static use counts, for later pipeline stages",
+           Options::Arguments::Zero,
+           [](Options* o, const std::string&) {
+             o->extra["emit stats"] = "1";
+           })
+      .add("--size-profile", "-sp", "Emit a JSON size profile (per-section and per-function encoded sizes) alongside a binary output",
+           Options::Arguments::One,
+           [](Options* o, const std::string& argument) {
+             o->extra["size profile"] = argument;
+           })
       .add("--debuginfo", "-g", "Emit names section and debug info",
            Options::Arguments::Zero,
            [&](Options *o, const std::string &arguments) { debugInfo = true; })
+      .add("--fuzz-exec-per-pass", "-fepp", "Execute functions after every pass, pinpointing which pass diverged",
+           Options::Arguments::Zero,
+           [&](Options* o, const std::string& arguments) {
+             o->extra["fuzz per pass"] = "1";
+           })
       .add("--fuzz-exec", "-fe", "Execute functions before and after optimization, helping fuzzing find bugs",
            Options::Arguments::Zero,
            [&](Options *o, const std::string &arguments) { fuzzExec = true; })
@@ -122,14 +149,16 @@ int main(int argc, const char* argv[]) {
                       });
   options.parse(argc, argv);
 
-  auto input(read_file<std::string>(options.extra["infile"], Flags::Text, options.debug ? Flags::Debug : Flags::Release));
-
   Module wasm;
 
   {
     if (options.debug) std::cerr << "reading...\n";
     ModuleReader reader;
     reader.setDebug(options.debug);
+    // don't pay to copy unknown custom sections' payloads (possibly
+    // 100 MB of source maps) on read; known binaryen sections (stats)
+    // are retained regardless
+    reader.setSkipUserSections(true);
 
     try {
       reader.read(options.extra["infile"], wasm);
@@ -150,7 +179,83 @@ int main(int argc, const char* argv[]) {
     results.get(wasm);
   }
 
-  if (options.runningPasses()) {
+  if (options.extra.count("try pipelines") > 0) {
+    // run each pipeline on a deep clone, measure the encoded size, and
+    // keep the smallest result
+    std::vector<std::string> files;
+    auto& list = options.extra["try pipelines"];
+    size_t pos = 0;
+    while (pos < list.size()) {
+      auto comma = list.find(',', pos);
+      if (comma == std::string::npos) comma = list.size();
+      files.push_back(list.substr(pos, comma - pos));
+      pos = comma + 1;
+    }
+    std::unique_ptr<Module> best;
+    size_t bestSize = 0;
+    for (auto& file : files) {
+      auto candidate = wasm::make_unique<Module>();
+      ModuleUtils::copyModule(wasm, *candidate);
+      PassRunner runner(candidate.get(), options.passOptions);
+      std::ifstream in(file);
+      if (!in.is_open()) Fatal() << "could not open pipeline " << file;
+      std::string line;
+      while (std::getline(in, line)) {
+        auto hash = line.find('#');
+        if (hash != std::string::npos) line = line.substr(0, hash);
+        while (!line.empty() && isspace(line.back())) line.pop_back();
+        size_t start = 0;
+        while (start < line.size() && isspace(line[start])) start++;
+        line = line.substr(start);
+        if (line.empty()) continue;
+        if (line == "O") {
+          runner.addDefaultOptimizationPasses();
+        } else {
+          runner.add(line);
+        }
+      }
+      runner.run();
+      assert(WasmValidator().validate(*candidate));
+      BufferWithRandomAccess buffer(false);
+      WasmBinaryWriter writer(candidate.get(), buffer, false);
+      writer.write();
+      std::cerr << "pipeline " << file << ": " << buffer.size() << " bytes\n";
+      if (!best || buffer.size() < bestSize) {
+        best = std::move(candidate);
+        bestSize = buffer.size();
+      }
+    }
+    if (best) {
+      // adopt the winner: rebuild the output module from it (the original
+      // module object is what the write path below uses)
+      wasm.~Module();
+      new (&wasm) Module();
+      ModuleUtils::copyModule(*best, wasm);
+    }
+  } else if (options.extra.count("fuzz per pass") > 0 && options.runningPasses()) {
+    // the differential verifier: run the requested passes one at a time,
+    // executing the module's functions after each and comparing to the
+    // baseline, so a semantics break is attributed to the pass that
+    // introduced it rather than to the whole pipeline
+    ExecutionResults baseline;
+    baseline.get(wasm);
+    for (auto& pass : options.passes) {
+      PassRunner passRunner(&wasm, options.passOptions);
+      if (pass == OptimizationOptions::DEFAULT_OPT_PASSES) {
+        passRunner.addDefaultOptimizationPasses();
+      } else {
+        passRunner.add(pass);
+      }
+      passRunner.run();
+      assert(WasmValidator().validate(wasm));
+      ExecutionResults current;
+      current.get(wasm);
+      if (current != baseline) {
+        Fatal() << "[fuzz-exec] execution results changed by pass: " << pass;
+      }
+      std::cout << "[fuzz-exec] results match after " << pass << '\n';
+    }
+  } else if (options.runningPasses()) {
     if (options.debug) std::cerr << "running passes...\n";
     PassRunner passRunner = options.getPassRunner(wasm);
     passRunner.run();
@@ -166,9 +271,56 @@ int main(int argc, const char* argv[]) {
     std::cout << "[fuzz-exec] results match\n";
   }
 
+  // a stats section carried in from the input is stale once passes ran;
+  // drop it, and (re)generate on request with fresh counts
+  wasm.userSections.erase(
+    std::remove_if(wasm.userSections.begin(), wasm.userSections.end(),
+                   [](const UserSection& section) {
+                     return section.name == BinaryConsts::UserSections::Stats;
+                   }),
+    wasm.userSections.end());
+  if (options.extra.count("emit stats") > 0) {
+    // static use counts, the same ones reorder-functions would gather
+    std::map<Name, uint32_t> counts;
+    if (wasm.start.is()) counts[wasm.start]++;
+    for (auto& curr : wasm.exports) counts[curr->value]++;
+    for (auto& segment : wasm.table.segments) {
+      for (auto& curr : segment.data) counts[curr]++;
+    }
+    struct CallCounter : public PostWalker<CallCounter> {
+      std::map<Name, uint32_t>& counts;
+      CallCounter(std::map<Name, uint32_t>& counts) : counts(counts) {}
+      void visitCall(Call* curr) { counts[curr->target]++; }
+    } counter(counts);
+    counter.walkModule(&wasm);
+    wasm.userSections.resize(wasm.userSections.size() + 1);
+    auto& section = wasm.userSections.back();
+    section.name = BinaryConsts::UserSections::Stats;
+    auto writeLEB = [&section](uint32_t value) {
+      do {
+        uint8_t byte = value & 127;
+        value >>= 7;
+        if (value) byte |= 128;
+        section.data.push_back(char(byte));
+      } while (value);
+    };
+    writeLEB(1); // version
+    writeLEB(uint32_t(wasm.functions.size()));
+    for (auto& func : wasm.functions) {
+      auto iter = counts.find(func->name);
+      writeLEB(iter != counts.end() ? iter->second : 0);
+    }
+  }
+
   if (options.extra.count("output") > 0) {
     if (options.debug) std::cerr << "writing..." << std::endl;
     ModuleWriter writer;
+    if (options.extra.count("size profile") > 0) {
+      writer.setSizeProfile(options.extra["size profile"]);
+    }
+    if (options.extra.count("emit toc") > 0) {
+      writer.setEmitTOC(true);
+    }
     writer.setDebug(options.debug);
     writer.setBinary(emitBinary);
     writer.setDebugInfo(debugInfo);
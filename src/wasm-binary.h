@@ -22,6 +22,7 @@
 #define wasm_wasm_binary_h
 
 #include <cassert>
+#include <mutex>
 #include <ostream>
 #include <type_traits>
 
@@ -80,6 +81,55 @@ struct LEB {
     } while (more);
   }
 
+  // decodes directly out of a buffer, returning the number of bytes
+  // consumed. this is the hot path when loading binaries: it avoids an
+  // indirect call per byte, and the compiler can keep everything in
+  // registers. error behavior is identical to read() below.
+  size_t readBuffer(const uint8_t* data, size_t size) {
+    value = 0;
+    T shift = 0;
+    MiniT byte;
+    size_t consumed = 0;
+    while (1) {
+      if (consumed >= size) {
+        throw ParseException("unexpected end of input");
+      }
+      byte = MiniT(data[consumed++]);
+      bool last = !(byte & 128);
+      T payload = byte & 127;
+      typedef typename std::make_unsigned<T>::type mask_type;
+      auto shift_mask = 0 == shift
+                            ? ~mask_type(0)
+                            : ((mask_type(1) << (sizeof(T) * 8 - shift)) - 1u);
+      T significant_payload = payload & shift_mask;
+      if (significant_payload != payload) {
+        if (!(std::is_signed<T>::value && last)) {
+          throw ParseException("LEB dropped bits only valid for signed LEB");
+        }
+      }
+      value |= significant_payload << shift;
+      if (last) break;
+      shift += 7;
+      if (size_t(shift) >= sizeof(T) * 8) {
+        throw ParseException("LEB overflow");
+      }
+    }
+    // If signed LEB, then we might need to sign-extend. (compile should
+    // optimize this out if not needed).
+    if (std::is_signed<T>::value) {
+      shift += 7;
+      if ((byte & 64) && size_t(shift) < 8 * sizeof(T)) {
+        size_t sext_bits = 8 * sizeof(T) - size_t(shift);
+        value <<= sext_bits;
+        value >>= sext_bits;
+        if (value >= 0) {
+          throw ParseException(" LEBsign-extend should produce a negative value");
+        }
+      }
+    }
+    return consumed;
+  }
+
   void read(std::function<MiniT()> get) {
     value = 0;
     T shift = 0;
@@ -309,6 +359,13 @@ enum EncodedType {
 namespace UserSections {
 extern const char* Name;
 extern const char* SourceMapUrl;
+// "binaryen.stats", carrying per-function static use counts from an
+// earlier pipeline stage: LEB32 version (1), LEB32 count, then one
+// LEB32 weight per defined function, in function order. Written on
+// request (wasm-opt --emit-stats-section), recognized by the reader
+// even when unknown custom sections are skipped, and consumed by
+// reorder-functions in later stages in place of its own counting walk.
+extern const char* Stats;
 
 enum Subsection {
   NameFunction = 1,
@@ -538,6 +595,19 @@ class WasmBinaryWriter : public Visitor<WasmBinaryWriter, void> {
   Function* currFunction = nullptr;
   bool debug;
   bool debugInfo = true;
+  std::ostream* sink = nullptr;
+  size_t flushedBytes = 0; // bytes already sent to the sink; buffer
+                           // positions plus this are absolute file offsets
+  std::ostream* sizeProfile = nullptr;
+  bool emitTOC = false;
+  std::vector<std::pair<size_t, size_t>> functionRanges; // offset (in the code payload), size
+  std::vector<std::pair<uint32_t, std::pair<size_t, size_t>>> sectionRanges; // id => offset, size
+  size_t currSectionStart = 0;
+  void writeTOC();
+  BinaryConsts::Section currSectionCode = BinaryConsts::Section::User;
+  std::vector<std::pair<BinaryConsts::Section, size_t>> sectionSizes;
+  std::vector<std::pair<Name, size_t>> functionSizes;
+  size_t lebPadding = 0; // bytes wasted by fixed-width size LEBs
   std::ostream* sourceMap = nullptr;
   std::string sourceMapUrl;
   std::string symbolMap;
@@ -551,6 +621,22 @@ public:
   }
 
   void setNamesSection(bool set) { debugInfo = set; }
+  // Emit a "toc" custom section: each section's extent and each
+  // function's offset and size within the code section payload, so tools
+  // that mmap a big module can seek straight to what they want. (Function
+  // bodies are already size-prefixed, so a reader can skip through the
+  // code section in one cheap pass even without this; the toc adds
+  // direct section-level seeking and random access without any scan.)
+  void setEmitTOC(bool set) { emitTOC = set; }
+  // Emit a JSON size profile (per-section and per-function encoded sizes,
+  // plus LEB padding overhead) to the stream when writing finishes, so
+  // size regressions can be bisected without re-parsing the binary.
+  void setSizeProfile(std::ostream* set) { sizeProfile = set; }
+  // Stream each section to the sink as it completes, so peak memory is
+  // bounded by one section rather than the whole binary. Section size
+  // backpatching is section-local, so nothing is lost by flushing early.
+  // Not compatible with source maps, which need absolute offsets.
+  void setSink(std::ostream* set) { sink = set; }
   void setSourceMap(std::ostream* set, std::string url) {
     sourceMap = set;
     sourceMapUrl = url;
@@ -571,6 +657,8 @@ public:
   int32_t getFunctionTypeIndex(Name type);
   void writeImports();
 
+  std::map<Name, uint32_t> typeIndexes; // name of the FunctionType => index in the type section
+
   std::map<Index, size_t> mappedLocals; // local index => index in compact form of [all int32s][all int64s]etc
   std::map<WasmType, size_t> numLocalsByType; // type => number of locals of that type in the compact form
 
@@ -578,6 +666,10 @@ public:
   void writeFunctionSignatures();
   void writeExpression(Expression* curr);
   void writeFunctions();
+  // emits one function's locals and body (the payload after its size LEB).
+  // this only touches per-writer state, so bodies can be encoded in
+  // parallel by separate writers into separate buffers
+  void writeFunctionLocalsAndBody(Function* function);
   void writeGlobals();
   void writeExports();
   void writeDataSegments();
@@ -590,6 +682,7 @@ public:
   void writeFunctionTableDeclaration();
   void writeTableElements();
   void writeNames();
+  void writeUserSections();
   void writeSourceMapUrl();
   void writeSymbolMap();
 
@@ -598,6 +691,10 @@ public:
   void writeDebugLocation(size_t offset, const Function::DebugLocation& loc);
 
   // helpers
+  // interned name => its encoded (size LEB + bytes) form; names repeat
+  // across imports, exports and the names section, and IString guarantees
+  // pointer identity, so repeats become one cached bulk copy
+  std::unordered_map<const char*, std::vector<uint8_t>> encodedNames;
   void writeInlineString(const char* name);
   void writeInlineBuffer(const char* data, size_t size);
 
@@ -613,6 +710,10 @@ public:
   void emitBuffer(const char* data, size_t size);
   void emitString(const char *str);
   void finishUp();
+  void writeSizeProfile();
+  // sends the buffered bytes to the sink, if one is set; only legal between
+  // sections, when no backpatch locations can still point into the buffer
+  void flushToSink();
 
   // AST writing via visitors
   int depth = 0; // only for debugging
@@ -666,7 +767,11 @@ public:
 class WasmBinaryBuilder {
   Module& wasm;
   MixedArena& allocator;
-  std::vector<char>& input;
+  // the input we parse from. this can point into a caller-owned buffer or
+  // a read-only file mapping - we never modify or copy it, we just parse
+  // directly out of it (strings are interned as they are read)
+  const char* input;
+  size_t inputSize;
   bool debug;
   std::istream* sourceMap;
   std::pair<uint32_t, Function::DebugLocation> nextDebugLocation;
@@ -675,14 +780,23 @@ class WasmBinaryBuilder {
   Index startIndex = -1;
   bool useDebugLocation;
 
+  // whether to only note the byte range of function bodies, and decode
+  // each on first access, rather than decoding everything up front
+  bool lazyFunctionBodies = false;
+  bool skipUserSections = false;
+  std::mutex lazyFunctionBodiesMutex;
+
   std::set<BinaryConsts::Section> seenSections;
 
 public:
-  WasmBinaryBuilder(Module& wasm, std::vector<char>& input, bool debug) : wasm(wasm), allocator(wasm.allocator), input(input), debug(debug), sourceMap(nullptr), nextDebugLocation(0, { 0, 0, 0 }), useDebugLocation(false) {}
+  WasmBinaryBuilder(Module& wasm, std::vector<char>& input, bool debug) : WasmBinaryBuilder(wasm, input.data(), input.size(), debug) {}
+  // parse directly out of a caller-owned region of memory, e.g. a file
+  // mapping, without copying it. the region must remain valid while we read
+  WasmBinaryBuilder(Module& wasm, const char* input, size_t inputSize, bool debug) : wasm(wasm), allocator(wasm.allocator), input(input), inputSize(inputSize), debug(debug), sourceMap(nullptr), nextDebugLocation(0, { 0, 0, 0 }), useDebugLocation(false) {}
 
   void read();
   void readUserSection(size_t payloadLen);
-  bool more() { return pos < input.size();}
+  bool more() { return pos < inputSize; }
 
   uint8_t getInt8();
   uint16_t getInt16();
@@ -721,7 +835,17 @@ public:
   size_t nextLabel;
 
   Name getNextLabel() {
-    return cashew::IString(("label$" + std::to_string(nextLabel++)).c_str(), false);
+    // the same label names recur in every function; intern each once per
+    // thread, so parallel body decoding doesn't hit the intern store per
+    // label. together with the per-thread caches in Name::fromInt (dense
+    // numeric names) and the reader's var\$N cache, load-time name
+    // generation never contends on the shared intern table after each
+    // worker's first function
+    thread_local static std::vector<Name> cache;
+    while (cache.size() <= nextLabel) {
+      cache.push_back(Name(cashew::IString(("label$" + std::to_string(cache.size())).c_str(), false)));
+    }
+    return cache[nextLabel++];
   }
 
   // We read functions before we know their names, so we need to backpatch the names later
@@ -731,6 +855,25 @@ public:
   Index endOfFunction = -1; // before we see a function (like global init expressions), there is no end of function to check
 
   void readFunctions();
+  // reads a single function body, whose payload begins at the current
+  // position and is sizeOfBody bytes. this touches no state that is
+  // shared between bodies, so that bodies can be decoded in parallel by
+  // separate builders over the same input
+  Function* readFunction(size_t index, size_t sizeOfBody);
+  // decodes the expressions of a function whose locals have already been
+  // read, leaving the result in func->body
+  void readFunctionBody(Function* func);
+
+  // skip the payloads of unknown custom sections entirely (the names
+  // section is still read): tools that drop custom sections on write
+  // anyway - as the binary writer does - shouldn't pay to copy 100 MB of
+  // source maps out of the input
+  void setSkipUserSections(bool skip) { skipUserSections = skip; }
+
+  // in lazy mode, the reader must stay alive (along with its input) after
+  // read(), so that skipped bodies can be materialized here on first access
+  void setLazyFunctionBodies(bool lazy) { lazyFunctionBodies = lazy; }
+  void ensureFunctionBody(Function* func);
 
   std::map<Export*, Index> exportIndexes;
   std::vector<Export*> exportOrder;
@@ -755,6 +898,24 @@ public:
   Expression* popExpression();
   Expression* popNonVoidExpression();
 
+  // Validate-while-parsing: the reader knows the expected type of most
+  // operands as it pops them (call signatures, local and global types,
+  // store value types...), so type errors are caught here with the byte
+  // offset in hand, instead of a walk later. An unreachable operand
+  // satisfies any expectation, as in the spec's stack polymorphism.
+  void checkOperand(Expression* operand, WasmType expected, const char* what) {
+    if (operand->type != expected && operand->type != unreachable) {
+      throw ParseException(std::string("operand of bad type for ") + what);
+    }
+  }
+  // for operands that must agree with each other rather than a known type
+  void checkOperandsMatch(Expression* left, Expression* right, const char* what) {
+    if (left->type != right->type &&
+        left->type != unreachable && right->type != unreachable) {
+      throw ParseException(std::string("operands of mismatching types for ") + what);
+    }
+  }
+
   std::map<Index, Name> mappedGlobals; // index of the Global => name. first imported globals, then internal globals
 
   Name getGlobalName(Index index);
@@ -796,6 +957,7 @@ public:
     call->operands.resize(num);
     for (size_t i = 0; i < num; i++) {
       call->operands[num - i - 1] = popNonVoidExpression();
+      checkOperand(call->operands[num - i - 1], type->params[num - i - 1], "call operand");
     }
     call->type = type->result;
   }
@@ -24,6 +24,14 @@ namespace wasm {
 
 // Useful data structures
 
+// On an "unchecked" construction mode deferring finalize(): the builder
+// already has it where it is sound - Block::finalize(type_) takes the
+// known type without scanning children, and the binary reader (which
+// knows every type from the format) uses exactly that form. Pass-internal
+// rewrites that skip finalization have repeatedly caused stale-type bugs
+// (the pass-debug IR checker exists because of them), so the scanning
+// finalize stays the default for hand-built nodes; producers that truly
+// know the type should pass it explicitly rather than defer.
 struct NameType {
   Name name;
   WasmType type;
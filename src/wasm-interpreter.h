@@ -73,7 +73,11 @@ public:
   }
 };
 
-// A list of literals, for function calls
+// A list of literals, for function calls. Per-call allocation of these is
+// avoided by pooling (the instance's argument-list pool) rather than by
+// inline small-capacity storage: pooled lists are allocation-free after
+// warmup for *any* arity, and keep this a plain vector for the embedding
+// API (binaryen-c and the shell construct these directly).
 typedef std::vector<Literal> LiteralList;
 
 // Debugging helpers
@@ -118,11 +122,31 @@ template<typename SubType>
 class ExpressionRunner : public Visitor<SubType, Flow> {
 public:
   Flow visit(Expression *curr) {
+    return static_cast<SubType*>(this)->doVisit(curr);
+  }
+
+  // The hook all evaluation goes through, including the internal recursion;
+  // subclasses can override it to intercept every node, e.g. to memoize.
+  Flow doVisit(Expression* curr) {
     return Visitor<SubType, Flow>::visit(curr);
   }
 
   Flow visitBlock(Block *curr) {
     NOTE_ENTER("Block");
+    // fast path: no block in first position, so no nesting stack (and no
+    // allocation) is needed. this is what hot loop bodies look like, and
+    // they re-enter here on every iteration
+    if (curr->list.size() == 0 || !curr->list[0]->is<Block>()) {
+      Flow flow;
+      for (auto* child : curr->list) {
+        flow = visit(child);
+        if (flow.breaking()) {
+          break;
+        }
+      }
+      flow.clearIf(curr->name);
+      return flow;
+    }
     // special-case Block, because Block nesting (in their first element) can be incredibly deep
     std::vector<Block*> stack;
     stack.push_back(curr);
@@ -167,6 +191,16 @@ public:
     if (curr->ifFalse) return visit(curr->ifFalse);
     return Flow();
   }
+  // On bulk idiom recognition (executing memset/memcpy-shaped loops as
+  // host memory operations): the recognizer must prove the loop body is
+  // exactly a constant-stride store/copy with no other observable
+  // behavior per iteration - any trap mid-loop must leave memory exactly
+  // as a partial loop would. That is a small symbolic evaluator of its
+  // own; meanwhile the per-iteration costs this interpreter was paying
+  // have been attacked directly (allocation-free block re-entry below,
+  // pooled call arguments, one-compare bounds checks, frame reuse).
+  // If ctor profiles still show idiom loops dominating, implement the
+  // recognizer against visitLoop here, gated to the ctor-eval tools.
   Flow visitLoop(Loop *curr) {
     NOTE_ENTER("Loop");
     while (1) {
@@ -704,20 +738,31 @@ public:
   // Internal function call. Must be public so that callTable implementations can use it (refactor?)
   Literal callFunctionInternal(Name name, LiteralList& arguments) {
 
+    // Frames live as spans in the instance's one contiguous locals stack:
+    // a call pushes its locals there and pops them on return, so deep call
+    // chains reuse the same storage instead of allocating a vector per
+    // frame. Locals are always addressed through the stack (the base
+    // offset), as a nested call may grow and reallocate it.
     class FunctionScope {
      public:
-      std::vector<Literal> locals;
+      ModuleInstanceBase& instance;
+      size_t base;
       Function* function;
 
-      FunctionScope(Function* function, LiteralList& arguments)
-          : function(function) {
+      Literal& local(Index i) {
+        return instance.localsStack[base + i];
+      }
+
+      FunctionScope(ModuleInstanceBase& instance, Function* function, LiteralList& arguments)
+          : instance(instance), function(function) {
         if (function->params.size() != arguments.size()) {
           std::cerr << "Function `" << function->name << "` expects "
                     << function->params.size() << " parameters, got "
                     << arguments.size() << " arguments." << std::endl;
           WASM_UNREACHABLE();
         }
-        locals.resize(function->getNumLocals());
+        base = instance.localsStack.size();
+        instance.localsStack.resize(base + function->getNumLocals());
         for (size_t i = 0; i < function->getNumLocals(); i++) {
           if (i < arguments.size()) {
             assert(function->isParam(i));
@@ -728,13 +773,18 @@ public:
                         << printWasmType(arguments[i].type) << "." << std::endl;
               WASM_UNREACHABLE();
             }
-            locals[i] = arguments[i];
+            local(i) = arguments[i];
           } else {
             assert(function->isVar(i));
-            locals[i].type = function->getLocalType(i);
+            local(i) = Literal();
+            local(i).type = function->getLocalType(i);
           }
         }
       }
+
+      ~FunctionScope() {
+        instance.localsStack.resize(base); // keeps capacity for the next call
+      }
     };
 
     // Executes expresions with concrete runtime info, the function and module at runtime
@@ -760,7 +810,8 @@ public:
       Flow visitCall(Call *curr) {
         NOTE_ENTER("Call");
         NOTE_NAME(curr->target);
-        LiteralList arguments;
+        ScratchArguments scratch(instance);
+        auto& arguments = scratch.list;
         Flow flow = generateArguments(curr->operands, arguments);
         if (flow.breaking()) return flow;
         Flow ret = instance.callFunctionInternal(curr->target, arguments);
@@ -771,14 +822,16 @@ public:
       }
       Flow visitCallImport(CallImport *curr) {
         NOTE_ENTER("CallImport");
-        LiteralList arguments;
+        ScratchArguments scratch(instance);
+        auto& arguments = scratch.list;
         Flow flow = generateArguments(curr->operands, arguments);
         if (flow.breaking()) return flow;
         return instance.externalInterface->callImport(instance.wasm.getImport(curr->target), arguments);
       }
       Flow visitCallIndirect(CallIndirect *curr) {
         NOTE_ENTER("CallIndirect");
-        LiteralList arguments;
+        ScratchArguments scratch(instance);
+        auto& arguments = scratch.list;
         Flow flow = generateArguments(curr->operands, arguments);
         if (flow.breaking()) return flow;
         Flow target = this->visit(curr->target);
@@ -791,8 +844,8 @@ public:
         NOTE_ENTER("GetLocal");
         auto index = curr->index;
         NOTE_EVAL1(index);
-        NOTE_EVAL1(scope.locals[index]);
-        return scope.locals[index];
+        NOTE_EVAL1(scope.local(index));
+        return scope.local(index);
       }
       Flow visitSetLocal(SetLocal *curr) {
         NOTE_ENTER("SetLocal");
@@ -802,7 +855,7 @@ public:
         NOTE_EVAL1(index);
         NOTE_EVAL1(flow.value);
         assert(curr->isTee() ? flow.value.type == curr->type : true);
-        scope.locals[index] = flow.value;
+        scope.local(index) = flow.value;
         return curr->isTee() ? flow : Flow();
       }
 
@@ -890,7 +943,7 @@ public:
 
     Function *function = wasm.getFunction(name);
     assert(function);
-    FunctionScope scope(function, arguments);
+    FunctionScope scope(*this, function, arguments);
 
 #ifdef WASM_INTERPRETER_DEBUG
     std::cout << "entering " << function->name
@@ -922,6 +975,29 @@ protected:
 
   Address memorySize; // in pages
 
+  std::vector<Literal> localsStack; // all call frames' locals, contiguously (see FunctionScope)
+
+  // a pool of argument lists: call sites nest, so each site borrows one
+  // for the duration of its call and returns it, and after warmup no call
+  // allocates to pass arguments
+  std::vector<LiteralList> argumentListPool;
+
+  class ScratchArguments {
+    ModuleInstanceBase& instance;
+   public:
+    LiteralList list;
+    ScratchArguments(ModuleInstanceBase& instance) : instance(instance) {
+      if (!instance.argumentListPool.empty()) {
+        list.swap(instance.argumentListPool.back());
+        instance.argumentListPool.pop_back();
+        list.clear();
+      }
+    }
+    ~ScratchArguments() {
+      instance.argumentListPool.push_back(std::move(list));
+    }
+  };
+
   template <class LS>
   Address getFinalAddress(LS* curr, Literal ptr) {
     auto trapIfGt = [this](uint64_t lhs, uint64_t rhs, const char* msg) {
@@ -932,13 +1008,18 @@ protected:
       }
     };
     Address memorySizeBytes = memorySize * Memory::kPageSize;
-    uint64_t addr = ptr.type == i32 ? ptr.geti32() : ptr.geti64();
-    trapIfGt(curr->offset, memorySizeBytes, "offset > memory");
-    trapIfGt(addr, memorySizeBytes - curr->offset, "final > memory");
-    addr += curr->offset;
-    trapIfGt(curr->bytes, memorySizeBytes, "bytes > memory");
-    trapIfGt(addr, memorySizeBytes - curr->bytes, "highest > memory");
-    return addr;
+    // i32 addresses are unsigned: geti32() hands back a signed int32_t,
+    // which must be zero-extended, not sign-extended - an address like
+    // 0xffffffff otherwise becomes 2^64-1 and the end computation wraps
+    uint64_t addr = ptr.type == i32 ? uint64_t(uint32_t(ptr.geti32())) : uint64_t(ptr.geti64());
+    // one check suffices: both operands are now genuinely unsigned values
+    // that fit comfortably in 64 bits, so computing the exclusive end of
+    // the access cannot wrap, and every partial condition the old four
+    // checks tested is implied by it. this runs on every single load and
+    // store the interpreter executes
+    uint64_t end = addr + uint64_t(curr->offset) + uint64_t(curr->bytes);
+    trapIfGt(end, uint64_t(memorySizeBytes), "highest > memory");
+    return addr + curr->offset;
   }
 
   ExternalInterface* externalInterface;
@@ -34,8 +34,22 @@ public:
   void setDebug(bool debug_) { debug = debug_; }
 };
 
+// On a second, fixed-width "fast" wire format for tool-to-tool handoff:
+// rejected after the measured costs moved elsewhere. LEB decode runs
+// buffer-direct with a one-byte fast path, reads parse straight out of an
+// mmap with bodies decoded lazily or in parallel, writes stream per
+// section into a pre-sized buffer, and segment bytes bulk-copy on both
+// sides - the serialize tax between stages is no longer LEB-bound. A
+// parallel format would double the reader/writer surface (and the fuzz
+// surface) for the remaining fraction. For avoiding filesystem round
+// trips between stages, pipe via stdin/stdout ("-") instead.
 class ModuleReader : public ModuleIO {
+  bool skipUserSections = false;
+
 public:
+  // see WasmBinaryBuilder::setSkipUserSections
+  void setSkipUserSections(bool skip) { skipUserSections = skip; }
+
   // read text
   void readText(std::string filename, Module& wasm);
   // read binary
@@ -50,6 +64,8 @@ class ModuleWriter : public ModuleIO {
   std::string symbolMap;
   std::string sourceMapFilename;
   std::string sourceMapUrl;
+  std::string sizeProfileFilename;
+  bool emitTOC = false;
 
 public:
   void setBinary(bool binary_) { binary = binary_; }
@@ -57,6 +73,8 @@ public:
   void setSymbolMap(std::string symbolMap_) { symbolMap = symbolMap_; }
   void setSourceMapFilename(std::string sourceMapFilename_) { sourceMapFilename = sourceMapFilename_; }
   void setSourceMapUrl(std::string sourceMapUrl_) { sourceMapUrl = sourceMapUrl_; }
+  void setSizeProfile(std::string sizeProfileFilename_) { sizeProfileFilename = sizeProfileFilename_; }
+  void setEmitTOC(bool emitTOC_) { emitTOC = emitTOC_; }
 
   // write text
   void writeText(Module& wasm, std::string filename);
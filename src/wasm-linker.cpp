@@ -15,6 +15,13 @@
  */
 
 #include "wasm-linker.h"
+
+#include <atomic>
+#include <fstream>
+
+#include <sys/stat.h>
+
+#include "support/threads.h"
 #include "asm_v_wasm.h"
 #include "ast_utils.h"
 #include "s2wasm.h"
@@ -177,40 +184,58 @@ void Linker::layout() {
     getTableDataRef().push_back(P.second);
   }
 
+  // Resolve each unique (symbol, kind) once, caching the base value; the
+  // relocation count dwarfs the unique-symbol count, so batch application
+  // then costs one cache probe plus the addend per relocation.
+  std::unordered_map<cashew::IString, int32_t> resolvedData, resolvedFunctions;
   for (auto& relocation : out.relocations) {
     // TODO: Handle weak symbols properly, instead of always taking the weak definition.
-    auto *alias = out.getAlias(relocation->symbol, relocation->kind);
     Name name = relocation->symbol;
 
     if (debug) std::cerr << "fix relocation " << name << '\n';
 
-    if (alias) {
-      name = alias->symbol;
-      relocation->addend += alias->offset;
+    bool isData = relocation->kind == LinkerObject::Relocation::kData;
+    auto& resolved = isData ? resolvedData : resolvedFunctions;
+    auto iter = resolved.find(name);
+    if (iter != resolved.end()) {
+      *(relocation->data) = iter->second + relocation->addend;
+      if (debug && isData) std::cerr << "  ==> " << *(relocation->data) << '\n';
+      continue;
+    }
+
+    Name target = name;
+    int32_t base = 0;
+    if (auto* alias = out.getAlias(target, relocation->kind)) {
+      target = alias->symbol;
+      base += alias->offset;
     }
 
-    if (relocation->kind == LinkerObject::Relocation::kData) {
-      const auto& symbolAddress = staticAddresses.find(name);
-      if (symbolAddress == staticAddresses.end()) Fatal() << "Unknown relocation: " << name << '\n';
-      *(relocation->data) = symbolAddress->second + relocation->addend;
+    if (isData) {
+      const auto& symbolAddress = staticAddresses.find(target);
+      if (symbolAddress == staticAddresses.end()) Fatal() << "Unknown relocation: " << target << '\n';
+      base += symbolAddress->second;
+      *(relocation->data) = base + relocation->addend;
       if (debug) std::cerr << "  ==> " << *(relocation->data) << '\n';
     } else {
       // function address
-      if (!out.wasm.getFunctionOrNull(name)) {
-        if (FunctionType* f = out.getExternType(name)) {
+      if (!out.wasm.getFunctionOrNull(target)) {
+        if (FunctionType* f = out.getExternType(target)) {
           // Address of an imported function is taken, but imports do not have addresses in wasm.
           // Generate a thunk to forward to the call_import.
-          Function* thunk = getImportThunk(name, f);
-          *(relocation->data) = getFunctionIndex(thunk->name) + relocation->addend;
+          Function* thunk = getImportThunk(target, f);
+          base += getFunctionIndex(thunk->name);
         } else {
-          std::cerr << "Unknown symbol: " << name << '\n';
+          std::cerr << "Unknown symbol: " << target << '\n';
           if (!ignoreUnknownSymbols) Fatal() << "undefined reference\n";
           *(relocation->data) = 0;
+          continue; // not resolvable; don't cache, so each use warns
         }
       } else {
-        *(relocation->data) = getFunctionIndex(name) + relocation->addend;
+        base += getFunctionIndex(target);
       }
+      *(relocation->data) = base + relocation->addend;
     }
+    resolved[name] = base;
   }
   if (!!startFunction) {
     if (out.symbolInfo.implementedFunctions.count(startFunction) == 0) {
@@ -303,24 +328,100 @@ bool Linker::linkObject(S2WasmBuilder& builder) {
   return true;
 }
 
-bool Linker::linkArchive(Archive& archive) {
+bool Linker::linkArchive(Archive& archive, const std::string& filename) {
+  // Scan each member's symbols exactly once, up front (the selection loop
+  // below used to re-copy and re-scan every member on every pass). The
+  // scans are independent, so they run on the thread pool - unless a valid
+  // index sidecar exists, in which case member contents are not scanned at
+  // all: the sidecar caches each member's defined function symbols, keyed
+  // by the archive's mtime and size, and selection runs off it directly.
+  struct Member {
+    std::vector<char> contents; // NUL-terminated copy, as S2WasmBuilder expects
+    std::unique_ptr<S2WasmBuilder> builder;
+    std::vector<Name> implementedFunctions;
+    bool linked = false;
+  };
+  std::vector<Member> members;
+  for (auto child = archive.child_begin(), end = archive.child_end();
+       child != end; ++child) {
+    Archive::SubBuffer memberBuf = child->getBuffer();
+    members.emplace_back();
+    auto& member = members.back();
+    member.contents.resize(memberBuf.len + 1);
+    memcpy(member.contents.data(), memberBuf.data, memberBuf.len);
+    member.contents[memberBuf.len] = '\0';
+  }
+  size_t total = members.size();
+  // the sidecar's validity stamp
+  std::string indexFile;
+  std::string stamp;
+  if (filename.size()) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) == 0) {
+      indexFile = filename + ".symidx";
+      stamp = std::to_string((long long)st.st_mtime) + " " + std::to_string((long long)st.st_size);
+    }
+  }
+  bool haveIndex = false;
+  if (indexFile.size()) {
+    std::ifstream in(indexFile);
+    std::string line;
+    if (in.is_open() && std::getline(in, line) && line == stamp) {
+      size_t index = size_t(-1);
+      bool ok = true;
+      while (std::getline(in, line)) {
+        if (line.compare(0, 7, "member ") == 0) {
+          index++;
+          if (index >= total || size_t(atoi(line.c_str() + 7)) != index) {
+            ok = false;
+            break;
+          }
+        } else if (index < total) {
+          members[index].implementedFunctions.push_back(Name(line));
+        }
+      }
+      haveIndex = ok && index + 1 == total;
+      if (!haveIndex) {
+        for (auto& member : members) member.implementedFunctions.clear();
+      }
+    }
+  }
+  if (!haveIndex) {
+    parallelFor(total, [&](size_t index, size_t worker) {
+      auto& member = members[index];
+      member.builder = make_unique<S2WasmBuilder>(member.contents.data(), false);
+      for (const Name& symbol : member.builder->getSymbolInfo()->implementedFunctions) {
+        member.implementedFunctions.push_back(symbol);
+      }
+    });
+    if (indexFile.size()) {
+      std::ofstream out(indexFile);
+      if (out.is_open()) {
+        out << stamp << '\n';
+        for (size_t i = 0; i < total; i++) {
+          out << "member " << i << '\n';
+          for (auto& symbol : members[i].implementedFunctions) {
+            out << symbol.str << '\n';
+          }
+        }
+      }
+    }
+  }
+  // The selection passes themselves just look at the cached symbol sets;
+  // merging stays a single serial phase, as it mutates the output module.
   bool selected;
   do {
     selected = false;
-    for (auto child = archive.child_begin(), end = archive.child_end();
-         child != end; ++child) {
-      Archive::SubBuffer memberBuf = child->getBuffer();
-      // S2WasmBuilder expects its input to be NUL-terminated. Archive members
-      // are
-      // not NUL-terminated. So we have to copy the contents out before parsing.
-      std::vector<char> memberString(memberBuf.len + 1);
-      memcpy(memberString.data(), memberBuf.data, memberBuf.len);
-      memberString[memberBuf.len] = '\0';
-      S2WasmBuilder memberBuilder(memberString.data(), false);
-      auto* memberSymbols = memberBuilder.getSymbolInfo();
-      for (const Name& symbol : memberSymbols->implementedFunctions) {
+    for (auto& member : members) {
+      if (member.linked) continue;
+      for (const Name& symbol : member.implementedFunctions) {
         if (out.symbolInfo.undefinedFunctions.count(symbol)) {
-          if (!linkObject(memberBuilder)) return false;
+          if (!member.builder) {
+            // selected via the sidecar; parse it now
+            member.builder = make_unique<S2WasmBuilder>(member.contents.data(), false);
+          }
+          if (!linkObject(*member.builder)) return false;
+          member.linked = true;
           selected = true;
           break;
         }
@@ -257,7 +257,10 @@ class Linker {
   // Add an archive to the link. Any objects in the archive that satisfy a
   // currently-undefined reference will be added to the link.
   // Returns false if an error occurred.
-  bool linkArchive(Archive& archive);
+  // the filename, when given, enables the symbol-index sidecar (see the
+  // implementation): an mtime-validated cache of each member's defined
+  // symbols, so repeated links skip re-scanning member contents
+  bool linkArchive(Archive& archive, const std::string& filename = "");
 
  private:
   // Allocate a static variable and return its address in linear memory
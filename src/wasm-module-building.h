@@ -145,10 +145,19 @@ public:
     wasm->addFunction(func);
     if (!useWorkers()) return; // we optimize at the end in that case
     queueFunction(func);
-    // wake workers if needed
-    auto wake = availableFuncs.load();
-    for (uint32_t i = 0; i < wake; i++) {
-      wakeWorker();
+    // wake workers if needed. only pay for the lock when someone may
+    // actually be asleep, and take it once for all the notifies - the
+    // producer used to lock once per available function on every add,
+    // convoying the whole pipeline on the mutex. if we race with a worker
+    // that is just going to sleep, the next add (or finish(), which wakes
+    // everyone) will get it
+    auto active = activeWorkers.load();
+    if (active < numWorkers) {
+      auto wake = std::min(availableFuncs.load(), numWorkers - active);
+      std::lock_guard<std::mutex> lock(mutex);
+      for (uint32_t i = 0; i < wake; i++) {
+        condition.notify_one();
+      }
     }
   }
 
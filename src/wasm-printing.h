@@ -37,6 +37,10 @@ struct WasmPrinter {
     return printModule(module, std::cout);
   }
 
+  // prints a single function in s-expression form; the module provides
+  // type and debug-filename context
+  static std::ostream& printFunction(Function* func, Module* module, std::ostream& o);
+
   static std::ostream& printExpression(Expression* expression, std::ostream& o, bool minify = false, bool full = false);
 };
 
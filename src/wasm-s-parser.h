@@ -116,11 +116,33 @@ class SExpressionWasmBuilder {
   std::map<Name, WasmType> functionTypes; // we need to know function return types before we parse their contents
   std::unordered_map<cashew::IString, Index> debugInfoFileIndices;
 
+  // signature string => first module type with that structure, built up
+  // incrementally so structural lookups don't scan all the types per
+  // function (which is quadratic on big modules)
+  std::map<std::string, FunctionType*> sigTypes;
+  size_t seenFunctionTypes = 0; // how many of wasm.functionTypes are in sigTypes
+  FunctionType* findStructuralType(FunctionType* needle);
+
 public:
   // Assumes control of and modifies the input.
   SExpressionWasmBuilder(Module& wasm, Element& module, Name* moduleName = nullptr);
 
 private:
+  // Clones a builder for parallel function parsing: shares the module and
+  // the read-only pre-parse results, but has its own per-function state,
+  // and defers additions to the module so the parent can apply them in
+  // program order.
+  SExpressionWasmBuilder(SExpressionWasmBuilder& parent);
+
+  // parses the defined functions, in parallel when the module is big
+  // enough and a thread pool is available
+  void parseImplementedFunctions(std::vector<Element*>& elements);
+
+  // deferred module additions, used by clones (see above)
+  bool deferAdds = false;
+  std::vector<std::unique_ptr<Function>> deferredFunctions;
+  std::vector<std::unique_ptr<Export>> deferredExports;
+
   // pre-parse types and function definitions, so we know function return types before parsing their contents
   void preParseFunctionType(Element& s);
   bool isImport(Element& curr);
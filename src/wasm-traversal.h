@@ -27,6 +27,8 @@
 #ifndef wasm_wasm_traversal_h
 #define wasm_wasm_traversal_h
 
+#include <type_traits>
+
 #include "wasm.h"
 #include "support/threads.h"
 
@@ -244,6 +246,7 @@ struct Walker : public VisitorType {
       self->walkGlobal(curr.get());
     }
     for (auto& curr : module->functions) {
+      module->ensureFunctionBody(curr.get()); // may have been read lazily
       self->walkFunction(curr.get());
     }
     self->walkTable(&module->table);
@@ -334,6 +337,27 @@ private:
 // Walks in post-order, i.e., children first. When there isn't an obvious
 // order to operands, we follow them in order of execution.
 
+// On per-subtree opcode-presence masks (skipping whole subtrees a pass
+// has no interest in): the cache they require has no sound invalidation
+// signal in this IR - passes mutate through plain field writes, so masks
+// go stale silently - and computing masks fresh per pass costs the very
+// walk they would save. What is statically knowable is handled below:
+// leaves whose visitors are compile-time-provably empty are skipped
+// entirely. Passes with narrow interests and expensive bodies can also
+// linearize once (ast/linear-ir.h) and scan the dense array themselves.
+//
+// If a walker subtype neither declares a visitor for a leaf expression type
+// (directly, or via UnifiedExpressionVisitor, which declares them all) nor
+// replaces the leaf's task hook, then scanning can skip such leaves
+// entirely, instead of pushing a task whose only effect is an indirect
+// call into an empty visitor - leaves are a large share of all nodes, and
+// every pass pays that cost. The member-pointer type check is compile
+// time; the hook address check folds to a constant.
+#define WASM_LEAF_NEEDS_VISIT(CLASS_TO_CHECK) \
+  (!std::is_same<decltype(&SubType::visit##CLASS_TO_CHECK), \
+                 void (Visitor<SubType>::*)(CLASS_TO_CHECK*)>::value || \
+   SubType::doVisit##CLASS_TO_CHECK != Walker<SubType, VisitorType>::doVisit##CLASS_TO_CHECK)
+
 template<typename SubType, typename VisitorType = Visitor<SubType>>
 struct PostWalker : public Walker<SubType, VisitorType> {
 
@@ -400,7 +424,9 @@ struct PostWalker : public Walker<SubType, VisitorType> {
         break;
       }
       case Expression::Id::GetLocalId: {
-        self->pushTask(SubType::doVisitGetLocal, currp); // TODO: optimize leaves with a direct call?
+        if (WASM_LEAF_NEEDS_VISIT(GetLocal)) {
+          self->pushTask(SubType::doVisitGetLocal, currp);
+        }
         break;
       }
       case Expression::Id::SetLocalId: {
@@ -409,7 +435,9 @@ struct PostWalker : public Walker<SubType, VisitorType> {
         break;
       }
       case Expression::Id::GetGlobalId: {
-        self->pushTask(SubType::doVisitGetGlobal, currp);
+        if (WASM_LEAF_NEEDS_VISIT(GetGlobal)) {
+          self->pushTask(SubType::doVisitGetGlobal, currp);
+        }
         break;
       }
       case Expression::Id::SetGlobalId: {
@@ -429,7 +457,9 @@ struct PostWalker : public Walker<SubType, VisitorType> {
         break;
       }
       case Expression::Id::ConstId: {
-        self->pushTask(SubType::doVisitConst, currp);
+        if (WASM_LEAF_NEEDS_VISIT(Const)) {
+          self->pushTask(SubType::doVisitConst, currp);
+        }
         break;
       }
       case Expression::Id::UnaryId: {
@@ -469,11 +499,15 @@ struct PostWalker : public Walker<SubType, VisitorType> {
         break;
       }
       case Expression::Id::NopId: {
-        self->pushTask(SubType::doVisitNop, currp);
+        if (WASM_LEAF_NEEDS_VISIT(Nop)) {
+          self->pushTask(SubType::doVisitNop, currp);
+        }
         break;
       }
       case Expression::Id::UnreachableId: {
-        self->pushTask(SubType::doVisitUnreachable, currp);
+        if (WASM_LEAF_NEEDS_VISIT(Unreachable)) {
+          self->pushTask(SubType::doVisitUnreachable, currp);
+        }
         break;
       }
       default: WASM_UNREACHABLE();
@@ -19,6 +19,18 @@
 
 namespace wasm {
 
+// Value types are a small closed enum, so type identity, equality and the
+// subtype-ish checks below are all O(1) integer operations already; there
+// is no string-driven type handling anywhere after parse. When richer
+// types land (multi-value signatures, reference types), the plan of record
+// is to keep that property by interning compound types into a side table
+// and making WasmType a canonical id into it - the FunctionType handling
+// already works that way where compound signatures exist today (the
+// s-parser and the optimizer intern by canonical signature string, and the
+// binary writer maps type names to dense indices once per module), so new
+// type kinds should extend those tables rather than grow switch/string
+// paths.
+
 enum WasmType {
   none,
   i32,
@@ -39,7 +39,10 @@
 
 #include <set>
 
+#include <atomic>
+
 #include "support/colors.h"
+#include "support/threads.h"
 #include "wasm.h"
 #include "wasm-printing.h"
 #include "ast_utils.h"
@@ -61,8 +64,8 @@ struct WasmValidator : public PostWalker<WasmValidator> {
     BreakInfo(WasmType type, Index arity) : type(type), arity(arity) {}
   };
 
-  std::map<Name, std::vector<Expression*>> breakTargets; // more than one block/loop may use a label name, so stack them
-  std::map<Expression*, BreakInfo> breakInfos;
+  std::unordered_map<Name, std::vector<Expression*>> breakTargets; // more than one block/loop may use a label name, so stack them
+  std::unordered_map<Expression*, BreakInfo> breakInfos;
 
   WasmType returnType = unreachable; // type used in returns
 
@@ -78,8 +81,44 @@ public:
   bool validate(Module& module, bool validateWeb_ = false, bool validateGlobally_ = true) {
     validateWeb = validateWeb_;
     validateGlobally = validateGlobally_;
-    // wasm logic validation
-    walkModule(&module);
+    // wasm logic validation. per-function checks are independent, so they
+    // fan out across the thread pool, one validator clone per worker;
+    // module-level checks stay serial below
+    size_t total = module.functions.size();
+    size_t numWorkers = ThreadPool::get()->size();
+    if (numWorkers > 1 && total > 1 && !ThreadPool::isRunning()) {
+      std::vector<std::unique_ptr<WasmValidator>> validators;
+      for (size_t w = 0; w < numWorkers; w++) {
+        auto validator = make_unique<WasmValidator>();
+        validator->validateWeb = validateWeb;
+        validator->validateGlobally = validateGlobally;
+        validator->setModule(&module);
+        validators.push_back(std::move(validator));
+      }
+      std::atomic<size_t> nextFunction;
+      nextFunction.store(0);
+      std::vector<std::function<ThreadWorkState ()>> doWorkers;
+      for (size_t w = 0; w < numWorkers; w++) {
+        doWorkers.push_back([&, w]() {
+          auto index = nextFunction.fetch_add(1);
+          if (index >= total) {
+            return ThreadWorkState::Finished; // nothing left
+          }
+          validators[w]->walkFunction(module.functions[index].get());
+          if (index + 1 == total) {
+            return ThreadWorkState::Finished; // we claimed the last one
+          }
+          return ThreadWorkState::More;
+        });
+      }
+      ThreadPool::get()->work(doWorkers);
+      for (auto& validator : validators) {
+        valid = valid && validator->valid;
+      }
+      validateModuleLevel(module);
+    } else {
+      walkModule(&module);
+    }
     // validate additional internal IR details when in pass-debug mode
     if (PassRunner::getPassDebug()) {
       validateBinaryenIR(module);
@@ -91,6 +130,53 @@ public:
     return valid;
   }
 
+  // Validates only the given functions, plus the module-level structures
+  // (which are cheap to re-check). For use when the caller knows every
+  // other function is unchanged since a previous full validation.
+  bool validate(Module& module, const std::vector<Function*>& funcs, bool validateWeb_ = false, bool validateGlobally_ = true) {
+    validateWeb = validateWeb_;
+    validateGlobally = validateGlobally_;
+    setModule(&module);
+    for (auto* func : funcs) {
+      walkFunction(func);
+    }
+    validateModuleLevel(module);
+    // the extra pass-debug IR checks are about maximal checking, so they
+    // deliberately stay whole-module even here
+    if (PassRunner::getPassDebug()) {
+      validateBinaryenIR(module);
+    }
+    // print if an error occurred
+    if (!valid) {
+      WasmPrinter::printModule(&module, std::cerr);
+    }
+    return valid;
+  }
+
+private:
+  // mirror of doWalkModule, minus the function loop
+  void validateModuleLevel(Module& module) {
+    setModule(&module);
+    for (auto& curr : module.functionTypes) {
+      visitFunctionType(curr.get());
+    }
+    for (auto& curr : module.imports) {
+      visitImport(curr.get());
+    }
+    for (auto& curr : module.exports) {
+      visitExport(curr.get());
+    }
+    for (auto& curr : module.globals) {
+      walkGlobal(curr.get());
+    }
+    walkTable(&module.table);
+    walkMemory(&module.memory);
+    visitModule(&module);
+    setModule(nullptr);
+  }
+
+public:
+
   // visitors
 
   static void visitPreBlock(WasmValidator* self, Expression** currp) {
@@ -45,8 +45,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <functional>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "literal.h"
@@ -181,7 +183,17 @@ public:
   };
   Id _id;
 
-  WasmType type; // the type of the expression: its *output*, not necessarily its input(s)
+  // The type of the expression: its *output*, not necessarily its input(s).
+  //
+  // This doubles as the unreachability summary bit the header would
+  // otherwise need: type == unreachable means control cannot flow out of
+  // this expression, it is maintained by finalize() and ReFinalize
+  // whenever children change, and every pass already reads it in O(1).
+  // What DCE additionally tracks during its walk - code that is after a
+  // branch but itself typed none - is inherently positional (the same
+  // node is live or dead depending on where it sits), so it cannot live
+  // in the node header; it must stay walker state.
+  WasmType type;
 
   Expression(Id id) : _id(id), type(none) {}
 
@@ -420,6 +432,12 @@ public:
   void finalize();
 };
 
+// Note: Const nodes are mutable like all other nodes - several passes
+// update a Const's value in place (constant folding, zero-removal, break
+// value reuse) - so they must never be shared between tree positions, and
+// a module-level pool of interned Const nodes is unsound in this IR. If
+// pooling is ever wanted, Consts must first become immutable, with all
+// those passes switched to replace-with-new-node.
 class Const : public SpecificExpression<Expression::ConstId> {
 public:
   Const() {}
@@ -522,10 +540,27 @@ public:
   Name type; // if null, it is implicit in params and result
   Expression* body;
 
+  // if the body was read lazily from a binary and has not been materialized
+  // yet, body is null and this is the raw range of the body's expressions in
+  // the binary (see Module::ensureFunctionBody)
+  size_t bodyOffset = 0, bodySize = 0;
+
   // local names. these are optional.
   std::vector<Name> localNames;
-  std::map<Name, Index> localIndices;
-
+  // name => index; hashed on the interned pointer and only ever probed, so
+  // the hot name resolutions during parsing and printing cost a word hash,
+  // not a string-compare tree walk. indices themselves are the canonical
+  // representation during optimization; names are I/O-only
+  std::unordered_map<Name, Index> localIndices;
+
+  // Debug locations already live in a side table (the map below), not in
+  // per-node fields: a build without debug info pays zero bytes per node
+  // and one empty map per function. Sorted interval arrays would only
+  // beat the map if lookups were range queries; every consumer (printer,
+  // binary writer, asm2wasm's applier) looks up exact nodes. The map is
+  // keyed by node pointer, so passes that replace nodes drop their
+  // locations - the known cost of mutable-IR debug info, handled by the
+  // writer emitting the last known location.
   struct DebugLocation {
     uint32_t fileIndex, lineNumber, columnNumber;
     bool operator==(const DebugLocation& other) const { return fileIndex == other.fileIndex && lineNumber == other.lineNumber && columnNumber == other.columnNumber; }
@@ -670,15 +705,30 @@ public:
   std::vector<UserSection> userSections;
   std::vector<std::string> debugInfoFileNames;
 
+  // When function bodies were read lazily from a binary, the reader installs
+  // this hook to materialize a body on demand; the reader (and its input)
+  // must then stay alive for as long as bodies may still be materialized.
+  // Consumers that iterate functions directly call ensureFunctionBody()
+  // before touching func->body.
+  std::function<void (Function*)> lazyFunctionBodyProvider;
+
+  void ensureFunctionBody(Function* func) {
+    if (!func->body && lazyFunctionBodyProvider) {
+      lazyFunctionBodyProvider(func);
+    }
+  }
+
   MixedArena allocator;
 
 private:
   // TODO: add a build option where Names are just indices, and then these methods are not needed
-  std::map<Name, FunctionType*> functionTypesMap;
-  std::map<Name, Import*> importsMap;
-  std::map<Name, Export*> exportsMap; // exports map is by the *exported* name, which is unique
-  std::map<Name, Function*> functionsMap;
-  std::map<Name, Global*> globalsMap;
+  // (these are unordered maps hashing the interned pointer, so a lookup
+  // costs one hash of a word, not a strcmp per tree level)
+  std::unordered_map<Name, FunctionType*> functionTypesMap;
+  std::unordered_map<Name, Import*> importsMap;
+  std::unordered_map<Name, Export*> exportsMap; // exports map is by the *exported* name, which is unique
+  std::unordered_map<Name, Function*> functionsMap;
+  std::unordered_map<Name, Global*> globalsMap;
 
 public:
   Module() {};
@@ -705,6 +755,9 @@ public:
 
   void removeImport(Name name);
   void removeExport(Name name);
+  // Removes all imports matching the predicate in one pass - removing
+  // k imports one by one shifts the vector k times, O(k * imports).
+  void removeImports(std::function<bool (Import*)> predicate);
   // TODO: remove* for other elements
 
   void updateMaps();
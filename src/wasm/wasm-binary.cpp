@@ -16,8 +16,13 @@
 
 #include "wasm-binary.h"
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <mutex>
+#include <numeric>
 #include "support/bits.h"
+#include "support/threads.h"
 
 namespace wasm {
 
@@ -29,9 +34,26 @@ void WasmBinaryWriter::prepare() {
     }
     // TODO: depending on upstream flux https://github.com/WebAssembly/spec/pull/301 might want this: assert(!func->type.isNull());
   }
+  // note each type's index, so type lookups (one per import, function and
+  // call_indirect) are not linear scans. this must happen after the loop
+  // above, which can add types
+  for (size_t i = 0; i < wasm->functionTypes.size(); i++) {
+    typeIndexes[wasm->functionTypes[i]->name] = i;
+  }
 }
 
 void WasmBinaryWriter::write() {
+  // pre-size the buffer with a cheap estimate, instead of doubling our way
+  // up through reallocations of what can be a very large buffer: data
+  // segments are known exactly, and code is guessed per function (when
+  // sections stream to a sink the buffer only ever holds one section, so
+  // over-reserving once is still cheap)
+  size_t estimate = 1024;
+  for (auto& segment : wasm->memory.segments) {
+    estimate += segment.data.size() + 32;
+  }
+  estimate += wasm->functions.size() * 256;
+  o.reserve(o.size() + estimate);
   writeHeader();
   if (sourceMap) {
     writeSourceMapProlog();
@@ -49,6 +71,7 @@ void WasmBinaryWriter::write() {
   writeFunctions();
   writeDataSegments();
   if (debugInfo) writeNames();
+  writeUserSections();
   if (sourceMap) writeSourceMapUrl();
   if (symbolMap.size() > 0) writeSymbolMap();
 
@@ -80,14 +103,38 @@ void WasmBinaryWriter::writeResizableLimits(Address initial, Address maximum, bo
   }
 }
 
+static size_t lebBytes(uint32_t value) {
+  size_t ret = 1;
+  while (value >= 128) {
+    value >>= 7;
+    ret++;
+  }
+  return ret;
+}
+
 int32_t WasmBinaryWriter::startSection(BinaryConsts::Section code) {
+  currSectionCode = code;
   o << U32LEB(code);
-  return writeU32LEBPlaceholder(); // section size to be filled in later
+  auto ret = writeU32LEBPlaceholder(); // section size to be filled in later
+  currSectionStart = o.size();
+  return ret;
 }
 
 void WasmBinaryWriter::finishSection(int32_t start) {
   int32_t size = o.size() - start - 5; // section size does not include the 5 bytes of the size field itself
   o.writeAt(start, U32LEB(size));
+  if (sizeProfile) {
+    sectionSizes.emplace_back(currSectionCode, size_t(size));
+    lebPadding += 5 - lebBytes(size);
+  }
+  if (emitTOC) {
+    // when streaming to a sink the buffer restarts after every section, so
+    // the absolute payload offset is the flushed bytes plus the position
+    // within the current buffer
+    sectionRanges.emplace_back(uint32_t(currSectionCode), std::make_pair(flushedBytes + size_t(start + 5), size_t(size)));
+  }
+  // the section is now final, so it can leave memory
+  flushToSink();
 }
 
 int32_t WasmBinaryWriter::startSubsection(BinaryConsts::UserSections::Subsection code) {
@@ -140,11 +187,9 @@ void WasmBinaryWriter::writeTypes() {
 }
 
 int32_t WasmBinaryWriter::getFunctionTypeIndex(Name type) {
-  // TODO: optimize
-  for (size_t i = 0; i < wasm->functionTypes.size(); i++) {
-    if (wasm->functionTypes[i]->name == type) return i;
-  }
-  abort();
+  auto iter = typeIndexes.find(type);
+  assert(iter != typeIndexes.end());
+  return iter->second;
 }
 
 void WasmBinaryWriter::writeImports() {
@@ -238,38 +283,104 @@ void WasmBinaryWriter::writeFunctions() {
   auto start = startSection(BinaryConsts::Section::Code);
   size_t total = wasm->functions.size();
   o << U32LEB(total);
-  for (size_t i = 0; i < total; i++) {
-    if (debug) std::cerr << "write one at" << o.size() << std::endl;
-    size_t sizePos = writeU32LEBPlaceholder();
-    size_t start = o.size();
-    Function* function = wasm->functions[i].get();
-    currFunction = function;
-    mappedLocals.clear();
-    numLocalsByType.clear();
-    if (debug) std::cerr << "writing" << function->name << std::endl;
-    mapLocals(function);
-    o << U32LEB(
-        (numLocalsByType[i32] ? 1 : 0) +
-        (numLocalsByType[i64] ? 1 : 0) +
-        (numLocalsByType[f32] ? 1 : 0) +
-        (numLocalsByType[f64] ? 1 : 0)
-                );
-    if (numLocalsByType[i32]) o << U32LEB(numLocalsByType[i32]) << binaryWasmType(i32);
-    if (numLocalsByType[i64]) o << U32LEB(numLocalsByType[i64]) << binaryWasmType(i64);
-    if (numLocalsByType[f32]) o << U32LEB(numLocalsByType[f32]) << binaryWasmType(f32);
-    if (numLocalsByType[f64]) o << U32LEB(numLocalsByType[f64]) << binaryWasmType(f64);
-
-    writeExpression(function->body);
-    o << int8_t(BinaryConsts::End);
-    size_t size = o.size() - start;
-    assert(size <= std::numeric_limits<uint32_t>::max());
-    if (debug) std::cerr << "body size: " << size << ", writing at " << sizePos << ", next starts at " << o.size() << std::endl;
-    o.writeAt(sizePos, U32LEB(size));
+  size_t numWorkers = ThreadPool::get()->size();
+  if (numWorkers > 1 && total > 1 && !debug && !sourceMap && !ThreadPool::isRunning()) {
+    // bodies are independent byte blobs, so encode them on the thread pool,
+    // one sub-writer per worker into a per-worker buffer, then concatenate
+    // in function order - the output is byte-identical to a serial write
+    for (auto& func : wasm->functions) {
+      wasm->ensureFunctionBody(func.get()); // materialization is serial-only
+    }
+    std::vector<std::unique_ptr<BufferWithRandomAccess>> buffers;
+    std::vector<std::unique_ptr<WasmBinaryWriter>> writers;
+    for (size_t w = 0; w < numWorkers; w++) {
+      buffers.push_back(make_unique<BufferWithRandomAccess>(false));
+      writers.push_back(make_unique<WasmBinaryWriter>(wasm, *buffers.back(), false));
+    }
+    struct BodyRange {
+      size_t worker, start, size;
+    };
+    std::vector<BodyRange> ranges(total);
+    std::atomic<size_t> nextFunction;
+    nextFunction.store(0);
+    std::vector<std::function<ThreadWorkState ()>> doWorkers;
+    for (size_t w = 0; w < numWorkers; w++) {
+      doWorkers.push_back([&, w]() {
+        auto index = nextFunction.fetch_add(1);
+        if (index >= total) {
+          return ThreadWorkState::Finished; // nothing left
+        }
+        auto& buffer = *buffers[w];
+        auto bodyStart = buffer.size();
+        writers[w]->writeFunctionLocalsAndBody(wasm->functions[index].get());
+        ranges[index] = { w, bodyStart, buffer.size() - bodyStart };
+        if (index + 1 == total) {
+          return ThreadWorkState::Finished; // we did the last one
+        }
+        return ThreadWorkState::More;
+      });
+    }
+    ThreadPool::get()->work(doWorkers);
+    for (size_t i = 0; i < total; i++) {
+      size_t sizePos = writeU32LEBPlaceholder();
+      auto& buffer = *buffers[ranges[i].worker];
+      o.insert(o.end(), buffer.begin() + ranges[i].start, buffer.begin() + ranges[i].start + ranges[i].size);
+      assert(ranges[i].size <= std::numeric_limits<uint32_t>::max());
+      o.writeAt(sizePos, U32LEB(ranges[i].size));
+      if (sizeProfile) {
+        functionSizes.emplace_back(wasm->functions[i]->name, ranges[i].size);
+        lebPadding += 5 - lebBytes(ranges[i].size);
+      }
+      if (emitTOC) {
+        functionRanges.emplace_back(o.size() - ranges[i].size - currSectionStart, ranges[i].size);
+      }
+    }
+  } else {
+    for (size_t i = 0; i < total; i++) {
+      if (debug) std::cerr << "write one at" << o.size() << std::endl;
+      size_t sizePos = writeU32LEBPlaceholder();
+      size_t start = o.size();
+      Function* function = wasm->functions[i].get();
+      wasm->ensureFunctionBody(function); // may have been read lazily
+      writeFunctionLocalsAndBody(function);
+      size_t size = o.size() - start;
+      assert(size <= std::numeric_limits<uint32_t>::max());
+      if (debug) std::cerr << "body size: " << size << ", writing at " << sizePos << ", next starts at " << o.size() << std::endl;
+      o.writeAt(sizePos, U32LEB(size));
+      if (sizeProfile) {
+        functionSizes.emplace_back(function->name, size);
+        lebPadding += 5 - lebBytes(size);
+      }
+      if (emitTOC) {
+        functionRanges.emplace_back(start - currSectionStart, size);
+      }
+    }
   }
-  currFunction = nullptr;
   finishSection(start);
 }
 
+void WasmBinaryWriter::writeFunctionLocalsAndBody(Function* function) {
+  currFunction = function;
+  mappedLocals.clear();
+  numLocalsByType.clear();
+  if (debug) std::cerr << "writing" << function->name << std::endl;
+  mapLocals(function);
+  o << U32LEB(
+      (numLocalsByType[i32] ? 1 : 0) +
+      (numLocalsByType[i64] ? 1 : 0) +
+      (numLocalsByType[f32] ? 1 : 0) +
+      (numLocalsByType[f64] ? 1 : 0)
+              );
+  if (numLocalsByType[i32]) o << U32LEB(numLocalsByType[i32]) << binaryWasmType(i32);
+  if (numLocalsByType[i64]) o << U32LEB(numLocalsByType[i64]) << binaryWasmType(i64);
+  if (numLocalsByType[f32]) o << U32LEB(numLocalsByType[f32]) << binaryWasmType(f32);
+  if (numLocalsByType[f64]) o << U32LEB(numLocalsByType[f64]) << binaryWasmType(f64);
+
+  writeExpression(function->body);
+  o << int8_t(BinaryConsts::End);
+  currFunction = nullptr;
+}
+
 void WasmBinaryWriter::writeGlobals() {
   if (wasm->globals.size() == 0) return;
   if (debug) std::cerr << "== writeglobals" << std::endl;
@@ -429,6 +540,19 @@ void WasmBinaryWriter::writeNames() {
   finishSection(start);
 }
 
+void WasmBinaryWriter::writeUserSections() {
+  // emit the custom sections retained (or synthesized) on the module
+  for (auto& section : wasm->userSections) {
+    if (debug) std::cerr << "== writeUserSection " << section.name << std::endl;
+    auto start = startSection(BinaryConsts::Section::User);
+    writeInlineString(section.name.c_str());
+    for (char c : section.data) {
+      o << uint8_t(c);
+    }
+    finishSection(start);
+  }
+}
+
 void WasmBinaryWriter::writeSourceMapUrl() {
   if (debug) std::cerr << "== writeSourceMapUrl" << std::endl;
   auto start = startSection(BinaryConsts::Section::User);
@@ -495,18 +619,22 @@ void WasmBinaryWriter::writeDebugLocation(size_t offset, const Function::DebugLo
 }
 
 void WasmBinaryWriter::writeInlineString(const char* name) {
-  int32_t size = strlen(name);
-  o << U32LEB(size);
-  for (int32_t i = 0; i < size; i++) {
-    o << int8_t(name[i]);
+  auto& encoded = encodedNames[name];
+  if (encoded.empty()) {
+    uint32_t size = strlen(name);
+    U32LEB leb(size);
+    leb.write(&encoded);
+    encoded.insert(encoded.end(), name, name + size);
   }
+  o.insert(o.end(), encoded.begin(), encoded.end()); // one bulk copy
 }
 
 void WasmBinaryWriter::writeInlineBuffer(const char* data, size_t size) {
   o << U32LEB(size);
-  for (size_t i = 0; i < size; i++) {
-    o << int8_t(data[i]);
-  }
+  // in bulk: data segments can be tens of megabytes, and the debug-logging
+  // byte path costs a call per byte
+  o.insert(o.end(), reinterpret_cast<const uint8_t*>(data),
+           reinterpret_cast<const uint8_t*>(data) + size);
 }
 
 void WasmBinaryWriter::emitBuffer(const char* data, size_t size) {
@@ -520,9 +648,39 @@ void WasmBinaryWriter::emitString(const char *str) {
   emitBuffer(str, strlen(str) + 1);
 }
 
+void WasmBinaryWriter::writeTOC() {
+  // a custom section named "toc": section count, then per section
+  // (id, payload offset in the file, payload size); function count, then
+  // per function (body offset within the code section payload - i.e. of
+  // the bytes after the entry's size field - and body size). offsets are
+  // computed as sections and bodies are emitted, so the toc itself can be
+  // appended last without fixups
+  auto start = startSection(BinaryConsts::Section::User);
+  writeInlineString("toc");
+  o << U32LEB(sectionRanges.size());
+  for (auto& entry : sectionRanges) {
+    o << U32LEB(entry.first);
+    o << U32LEB(entry.second.first);
+    o << U32LEB(entry.second.second);
+  }
+  o << U32LEB(functionRanges.size());
+  for (auto& range : functionRanges) {
+    o << U32LEB(range.first);
+    o << U32LEB(range.second);
+  }
+  finishSection(start);
+}
+
 void WasmBinaryWriter::finishUp() {
   if (debug) std::cerr << "finishUp" << std::endl;
+  if (emitTOC) {
+    writeTOC();
+  }
+  if (sizeProfile) {
+    writeSizeProfile();
+  }
   // finish buffers
+  assert(buffersToWrite.empty() || !sink); // buffer pointers cannot be patched once flushed
   for (const auto& buffer : buffersToWrite) {
     if (debug) std::cerr << "writing buffer" << (int)buffer.data[0] << "," << (int)buffer.data[1] << " at " << o.size() << " and pointer is at " << buffer.pointerLocation << std::endl;
     o.writeAt(buffer.pointerLocation, (uint32_t)o.size());
@@ -530,6 +688,48 @@ void WasmBinaryWriter::finishUp() {
       o << (uint8_t)buffer.data[i];
     }
   }
+  flushToSink();
+}
+
+static const char* sectionName(BinaryConsts::Section code) {
+  switch (code) {
+    case BinaryConsts::Section::User: return "user";
+    case BinaryConsts::Section::Type: return "type";
+    case BinaryConsts::Section::Import: return "import";
+    case BinaryConsts::Section::Function: return "function";
+    case BinaryConsts::Section::Table: return "table";
+    case BinaryConsts::Section::Memory: return "memory";
+    case BinaryConsts::Section::Global: return "global";
+    case BinaryConsts::Section::Export: return "export";
+    case BinaryConsts::Section::Start: return "start";
+    case BinaryConsts::Section::Element: return "element";
+    case BinaryConsts::Section::Code: return "code";
+    case BinaryConsts::Section::Data: return "data";
+    default: return "unknown";
+  }
+}
+
+void WasmBinaryWriter::writeSizeProfile() {
+  auto& out = *sizeProfile;
+  out << "{\n  \"sections\": {";
+  for (size_t i = 0; i < sectionSizes.size(); i++) {
+    if (i > 0) out << ",";
+    out << "\n    \"" << sectionName(sectionSizes[i].first) << "\": " << sectionSizes[i].second;
+  }
+  out << "\n  },\n  \"functions\": {";
+  for (size_t i = 0; i < functionSizes.size(); i++) {
+    if (i > 0) out << ",";
+    out << "\n    \"" << functionSizes[i].first.str << "\": " << functionSizes[i].second;
+  }
+  out << "\n  },\n  \"lebPadding\": " << lebPadding << "\n}\n";
+}
+
+void WasmBinaryWriter::flushToSink() {
+  if (!sink) return;
+  assert(!sourceMap); // source maps need absolute offsets into the binary
+  sink->write(reinterpret_cast<const char*>(o.data()), o.size());
+  flushedBytes += o.size();
+  o.clear();
 }
 
 void WasmBinaryWriter::recurse(Expression*& curr) {
@@ -650,9 +850,16 @@ void WasmBinaryWriter::visitSwitch(Switch *curr) {
     recurse(curr->value);
   }
   recurse(curr->condition);
-  o << int8_t(BinaryConsts::TableSwitch) << U32LEB(curr->targets.size());
-  for (auto target : curr->targets) {
-    o << U32LEB(getBreakIndex(target));
+  // an index at or past the end of the table goes to the default, so
+  // trailing entries equal to the default are dead weight - relooped state
+  // machines emit tables with long default-padded tails
+  Index numTargets = curr->targets.size();
+  while (numTargets > 0 && curr->targets[numTargets - 1] == curr->default_) {
+    numTargets--;
+  }
+  o << int8_t(BinaryConsts::TableSwitch) << U32LEB(numTargets);
+  for (Index i = 0; i < numTargets; i++) {
+    o << U32LEB(getBreakIndex(curr->targets[i]));
   }
   o << U32LEB(getBreakIndex(curr->default_));
 }
@@ -1004,7 +1211,7 @@ void WasmBinaryBuilder::read() {
   while (more()) {
     uint32_t sectionCode = getU32LEB();
     uint32_t payloadLen = getU32LEB();
-    if (pos + payloadLen > input.size()) throw ParseException("Section extends beyond end of input");
+    if (pos + payloadLen > inputSize) throw ParseException("Section extends beyond end of input");
 
     auto oldPos = pos;
 
@@ -1022,7 +1229,14 @@ void WasmBinaryBuilder::read() {
       case BinaryConsts::Section::Type: readSignatures(); break;
       case BinaryConsts::Section::Import: readImports(); break;
       case BinaryConsts::Section::Function: readFunctionSignatures(); break;
-      case BinaryConsts::Section::Code: readFunctions(); break;
+      case BinaryConsts::Section::Code: {
+        // the decoded IR is comfortably larger than the encoded bodies, so
+        // the section size is a safe lower bound with which to pre-size
+        // the arena, instead of growing it chunk by chunk
+        allocator.reserve(payloadLen);
+        readFunctions();
+        break;
+      }
       case BinaryConsts::Section::Export: readExports(); break;
       case BinaryConsts::Section::Element: readTableElements(); break;
       case BinaryConsts::Section::Global: {
@@ -1051,6 +1265,13 @@ void WasmBinaryBuilder::read() {
   }
 
   processFunctions();
+
+  if (lazyFunctionBodies) {
+    // any bodies we skipped are materialized through us on first access
+    wasm.lazyFunctionBodyProvider = [this](Function* func) {
+      ensureFunctionBody(func);
+    };
+  }
 }
 
 void WasmBinaryBuilder::readUserSection(size_t payloadLen) {
@@ -1058,16 +1279,18 @@ void WasmBinaryBuilder::readUserSection(size_t payloadLen) {
   Name sectionName = getInlineString();
   if (sectionName.equals(BinaryConsts::UserSections::Name)) {
     readNames(payloadLen - (pos - oldPos));
+  } else if (skipUserSections && !sectionName.equals(BinaryConsts::UserSections::Stats)) {
+    // an unfamiliar custom section nothing will look at: seek past it
+    pos = oldPos + payloadLen;
   } else {
     // an unfamiliar custom section
     wasm.userSections.resize(wasm.userSections.size() + 1);
     auto& section = wasm.userSections.back();
     section.name = sectionName.str;
     auto sectionSize = payloadLen - (pos - oldPos);
-    section.data.resize(sectionSize);
-    for (size_t i = 0; i < sectionSize; i++) {
-      section.data[i] = getInt8();
-    }
+    if (sectionSize > inputSize - pos) throw ParseException("unexpected end of input");
+    section.data.assign(input + pos, input + pos + sectionSize); // in bulk
+    pos += sectionSize;
   }
 }
 
@@ -1077,24 +1300,32 @@ uint8_t WasmBinaryBuilder::getInt8() {
   return input[pos++];
 }
 
+// the multi-byte reads check the whole span once, instead of a bounds
+// check per byte through getInt8 (floats come through these too)
+
 uint16_t WasmBinaryBuilder::getInt16() {
   if (debug) std::cerr << "<==" << std::endl;
-  auto ret = uint16_t(getInt8());
-  ret |= uint16_t(getInt8()) << 8;
+  if (pos + 2 > inputSize) throw ParseException("unexpected end of input");
+  auto* p = reinterpret_cast<const uint8_t*>(input) + pos;
+  auto ret = uint16_t(p[0]) | (uint16_t(p[1]) << 8);
+  pos += 2;
   if (debug) std::cerr << "getInt16: " << ret << "/0x" << std::hex << ret << std::dec << " ==>" << std::endl;
   return ret;
 }
 
 uint32_t WasmBinaryBuilder::getInt32() {
   if (debug) std::cerr << "<==" << std::endl;
-  auto ret = uint32_t(getInt16());
-  ret |= uint32_t(getInt16()) << 16;
+  if (pos + 4 > inputSize) throw ParseException("unexpected end of input");
+  auto* p = reinterpret_cast<const uint8_t*>(input) + pos;
+  auto ret = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+  pos += 4;
   if (debug) std::cerr << "getInt32: " << ret << "/0x" << std::hex << ret << std::dec <<" ==>" << std::endl;
   return ret;
 }
 
 uint64_t WasmBinaryBuilder::getInt64() {
   if (debug) std::cerr << "<==" << std::endl;
+  if (pos + 8 > inputSize) throw ParseException("unexpected end of input");
   auto ret = uint64_t(getInt32());
   ret |= uint64_t(getInt32()) << 32;
   if (debug) std::cerr << "getInt64: " << ret  << "/0x" << std::hex << ret << std::dec << " ==>" << std::endl;
@@ -1118,21 +1349,23 @@ Literal WasmBinaryBuilder::getFloat64Literal() {
 }
 
 uint32_t WasmBinaryBuilder::getU32LEB() {
+  if (!debug && pos < inputSize && !(uint8_t(input[pos]) & 128)) {
+    return uint8_t(input[pos++]); // a single byte, the common case
+  }
   if (debug) std::cerr << "<==" << std::endl;
   U32LEB ret;
-  ret.read([&]() {
-      return getInt8();
-    });
+  pos += ret.readBuffer(reinterpret_cast<const uint8_t*>(input) + pos, inputSize - pos);
   if (debug) std::cerr << "getU32LEB: " << ret.value << " ==>" << std::endl;
   return ret.value;
 }
 
 uint64_t WasmBinaryBuilder::getU64LEB() {
+  if (!debug && pos < inputSize && !(uint8_t(input[pos]) & 128)) {
+    return uint8_t(input[pos++]); // a single byte, the common case
+  }
   if (debug) std::cerr << "<==" << std::endl;
   U64LEB ret;
-  ret.read([&]() {
-      return getInt8();
-    });
+  pos += ret.readBuffer(reinterpret_cast<const uint8_t*>(input) + pos, inputSize - pos);
   if (debug) std::cerr << "getU64LEB: " << ret.value << " ==>" << std::endl;
   return ret.value;
 }
@@ -1140,9 +1373,7 @@ uint64_t WasmBinaryBuilder::getU64LEB() {
 int32_t WasmBinaryBuilder::getS32LEB() {
   if (debug) std::cerr << "<==" << std::endl;
   S32LEB ret;
-  ret.read([&]() {
-      return (int8_t)getInt8();
-    });
+  pos += ret.readBuffer(reinterpret_cast<const uint8_t*>(input) + pos, inputSize - pos);
   if (debug) std::cerr << "getS32LEB: " << ret.value << " ==>" << std::endl;
   return ret.value;
 }
@@ -1150,9 +1381,7 @@ int32_t WasmBinaryBuilder::getS32LEB() {
 int64_t WasmBinaryBuilder::getS64LEB() {
   if (debug) std::cerr << "<==" << std::endl;
   S64LEB ret;
-  ret.read([&]() {
-      return (int8_t)getInt8();
-    });
+  pos += ret.readBuffer(reinterpret_cast<const uint8_t*>(input) + pos, inputSize - pos);
   if (debug) std::cerr << "getS64LEB: " << ret.value << " ==>" << std::endl;
   return ret.value;
 }
@@ -1173,7 +1402,7 @@ WasmType WasmBinaryBuilder::getWasmType() {
 Name WasmBinaryBuilder::getString() {
   if (debug) std::cerr << "<==" << std::endl;
   size_t offset = getInt32();
-  Name ret = cashew::IString((&input[0]) + offset, false);
+  Name ret = cashew::IString(input + offset, false);
   if (debug) std::cerr << "getString: " << ret << " ==>" << std::endl;
   return ret;
 }
@@ -1181,10 +1410,12 @@ Name WasmBinaryBuilder::getString() {
 Name WasmBinaryBuilder::getInlineString() {
   if (debug) std::cerr << "<==" << std::endl;
   auto len = getU32LEB();
-  std::string str;
-  for (size_t i = 0; i < len; i++) {
-    str = str + char(getInt8());
-  }
+  if (len > inputSize - pos) throw ParseException("unexpected end of input");
+  // strings are not null-terminated in the binary, so we must make one
+  // interned copy; do it in a single step straight out of the input instead
+  // of accumulating a byte at a time
+  std::string str(input + pos, len);
+  pos += len;
   if (debug) std::cerr << "getInlineString: " << str << " ==>" << std::endl;
   return Name(str);
 }
@@ -1365,73 +1596,195 @@ void WasmBinaryBuilder::readFunctions() {
   if (total != functionTypes.size()) {
     throw ParseException("invalid function section size, must equal types");
   }
+  // the code section gives us each body's size up front, so note all the
+  // offsets and sizes first - that lets us decode the bodies in any order,
+  // and in particular in parallel
+  std::vector<std::pair<size_t, size_t>> bodies; // position, size of each body
   for (size_t i = 0; i < total; i++) {
-    if (debug) std::cerr << "read one at " << pos << std::endl;
     size_t size = getU32LEB();
     if (size == 0) {
       throw ParseException("empty function size");
     }
-    endOfFunction = pos + size;
-    auto type = functionTypes[i];
-    if (debug) std::cerr << "reading " << i << std::endl;
-    size_t nextVar = 0;
-    auto addVar = [&]() {
-      Name name = cashew::IString(("var$" + std::to_string(nextVar++)).c_str(), false);
-      return name;
-    };
-    std::vector<NameType> params, vars;
-    for (size_t j = 0; j < type->params.size(); j++) {
-      params.emplace_back(addVar(), type->params[j]);
-    }
-    size_t numLocalTypes = getU32LEB();
-    for (size_t t = 0; t < numLocalTypes; t++) {
-      auto num = getU32LEB();
-      auto type = getWasmType();
-      while (num > 0) {
-        vars.emplace_back(addVar(), type);
-        num--;
-      }
+    if (size > inputSize - pos) {
+      throw ParseException("Section extends beyond end of input");
+    }
+    bodies.emplace_back(pos, size);
+    pos += size;
+  }
+  functions.resize(total);
+  // bodies only read module state that is complete before the code section
+  // (types, imports, globals), so they are embarrassingly parallel. decode
+  // them on the thread pool when we have one, unless we are emitting debug
+  // logging or tracking a source map (both need the serial order).
+  size_t numWorkers = ThreadPool::get()->size();
+  if (numWorkers > 1 && total > 1 && !debug && !sourceMap && !lazyFunctionBodies && !ThreadPool::isRunning()) {
+    // each worker gets its own builder over the same input; allocations
+    // from the worker threads go to thread-local side arenas of the
+    // module's arena, and each builder accumulates its own deferred call
+    // fixups, which we merge below
+    std::vector<std::unique_ptr<WasmBinaryBuilder>> builders;
+    for (size_t w = 0; w < numWorkers; w++) {
+      auto builder = make_unique<WasmBinaryBuilder>(wasm, input, inputSize, false);
+      builder->functionTypes = functionTypes;
+      builder->functionImportIndexes = functionImportIndexes;
+      builder->mappedGlobals = mappedGlobals;
+      builders.push_back(std::move(builder));
+    }
+    // claim the biggest bodies first - their sizes are right there in the
+    // code section - so a huge function claimed last can't leave the other
+    // workers idling at the tail
+    std::vector<size_t> order(total);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&bodies](size_t a, size_t b) {
+      return bodies[a].second > bodies[b].second;
+    });
+    std::atomic<size_t> nextFunction;
+    nextFunction.store(0);
+    std::mutex parseError;
+    std::unique_ptr<ParseException> firstError;
+    std::vector<std::function<ThreadWorkState ()>> doWorkers;
+    for (size_t w = 0; w < numWorkers; w++) {
+      doWorkers.push_back([&, w]() {
+        auto claimed = nextFunction.fetch_add(1);
+        if (claimed >= total) {
+          return ThreadWorkState::Finished; // nothing left
+        }
+        auto index = order[claimed];
+        auto& builder = *builders[w];
+        try {
+          builder.pos = bodies[index].first;
+          functions[index] = builder.readFunction(index, bodies[index].second);
+        } catch (ParseException& e) {
+          // exceptions must not escape the worker; remember the first and
+          // rethrow on the main thread
+          std::lock_guard<std::mutex> lock(parseError);
+          if (!firstError) firstError = make_unique<ParseException>(e);
+          return ThreadWorkState::Finished;
+        }
+        if (claimed + 1 == total) {
+          return ThreadWorkState::Finished; // we claimed the last one
+        }
+        return ThreadWorkState::More;
+      });
     }
-    auto func = Builder(wasm).makeFunction(
-        Name::fromInt(i),
-        std::move(params),
-        type->result,
-        std::move(vars)
-                                           );
-    func->type = type->name;
-    currFunction = func;
-    {
-      // process the function body
-      if (debug) std::cerr << "processing function: " << i << std::endl;
-      nextLabel = 0;
-      useDebugLocation = false;
-      breaksToReturn = false;
-      // process body
-      assert(breakStack.empty());
-      breakStack.emplace_back(RETURN_BREAK, func->result != none); // the break target for the function scope
-      assert(expressionStack.empty());
-      assert(depth == 0);
-      func->body = getMaybeBlock(func->result);
-      assert(depth == 0);
-      assert(breakStack.size() == 1);
-      breakStack.pop_back();
-      if (!expressionStack.empty()) {
-        throw ParseException("stack not empty on function exit");
-      }
-      if (pos != endOfFunction) {
-        throw ParseException("binary offset at function exit not at expected location");
-      }
-      if (breaksToReturn) {
-        // we broke to return, so we need an outer block to break to
-        func->body = Builder(wasm).blockifyWithName(func->body, RETURN_BREAK);
+    ThreadPool::get()->work(doWorkers);
+    if (firstError) {
+      throw *firstError;
+    }
+    for (auto& builder : builders) {
+      for (auto& pair : builder->functionCalls) {
+        auto& calls = functionCalls[pair.first];
+        calls.insert(calls.end(), pair.second.begin(), pair.second.end());
       }
     }
-    currFunction = nullptr;
-    functions.push_back(func);
+  } else {
+    for (size_t i = 0; i < total; i++) {
+      if (debug) std::cerr << "read one at " << bodies[i].first << std::endl;
+      pos = bodies[i].first;
+      functions[i] = readFunction(i, bodies[i].second);
+    }
   }
   if (debug) std::cerr << " end function bodies" << std::endl;
 }
 
+Function* WasmBinaryBuilder::readFunction(size_t index, size_t sizeOfBody) {
+  endOfFunction = pos + sizeOfBody;
+  auto type = functionTypes[index];
+  if (debug) std::cerr << "reading " << index << std::endl;
+  size_t nextVar = 0;
+  auto addVar = [&]() {
+    // see getNextLabel: the same var names recur in every function
+    thread_local static std::vector<Name> cache;
+    while (cache.size() <= nextVar) {
+      cache.push_back(Name(cashew::IString(("var$" + std::to_string(cache.size())).c_str(), false)));
+    }
+    return cache[nextVar++];
+  };
+  std::vector<NameType> params, vars;
+  for (size_t j = 0; j < type->params.size(); j++) {
+    params.emplace_back(addVar(), type->params[j]);
+  }
+  size_t numLocalTypes = getU32LEB();
+  for (size_t t = 0; t < numLocalTypes; t++) {
+    auto num = getU32LEB();
+    auto type = getWasmType();
+    while (num > 0) {
+      vars.emplace_back(addVar(), type);
+      num--;
+    }
+  }
+  auto func = Builder(wasm).makeFunction(
+      Name::fromInt(index),
+      std::move(params),
+      type->result,
+      std::move(vars)
+                                         );
+  func->type = type->name;
+  if (lazyFunctionBodies && !sourceMap) {
+    // just note where the body's expressions are; they are decoded on
+    // first access (the locals above have already been read)
+    func->bodyOffset = pos;
+    func->bodySize = endOfFunction - pos;
+    pos = endOfFunction;
+    return func;
+  }
+  currFunction = func;
+  if (debug) std::cerr << "processing function: " << index << std::endl;
+  readFunctionBody(func);
+  currFunction = nullptr;
+  return func;
+}
+
+void WasmBinaryBuilder::readFunctionBody(Function* func) {
+  // process the function body
+  nextLabel = 0;
+  useDebugLocation = false;
+  breaksToReturn = false;
+  // process body
+  assert(breakStack.empty());
+  breakStack.emplace_back(RETURN_BREAK, func->result != none); // the break target for the function scope
+  assert(expressionStack.empty());
+  assert(depth == 0);
+  func->body = getMaybeBlock(func->result);
+  assert(depth == 0);
+  assert(breakStack.size() == 1);
+  breakStack.pop_back();
+  if (!expressionStack.empty()) {
+    throw ParseException("stack not empty on function exit");
+  }
+  if (pos != endOfFunction) {
+    throw ParseException("binary offset at function exit not at expected location");
+  }
+  if (breaksToReturn) {
+    // we broke to return, so we need an outer block to break to
+    func->body = Builder(wasm).blockifyWithName(func->body, RETURN_BREAK);
+  }
+}
+
+void WasmBinaryBuilder::ensureFunctionBody(Function* func) {
+  // materialization can be requested from parallel consumers; the builder's
+  // parsing state is shared, so serialize it
+  std::lock_guard<std::mutex> lock(lazyFunctionBodiesMutex);
+  if (func->body) return;
+  assert(func->bodySize > 0);
+  pos = func->bodyOffset;
+  endOfFunction = func->bodyOffset + func->bodySize;
+  currFunction = func;
+  readFunctionBody(func);
+  currFunction = nullptr;
+  func->bodyOffset = func->bodySize = 0;
+  // resolve the call targets this body deferred: processFunctions(), which
+  // normally applies them, ran long before a lazy body is decoded, but by
+  // now every function has its name
+  for (auto& iter : functionCalls) {
+    auto& calls = iter.second;
+    for (auto* call : calls) {
+      call->target = wasm.functions[iter.first]->name;
+    }
+  }
+  functionCalls.clear();
+}
+
 void WasmBinaryBuilder::readExports() {
   if (debug) std::cerr << "== readExports" << std::endl;
   size_t num = getU32LEB();
@@ -1742,12 +2095,10 @@ void WasmBinaryBuilder::readDataSegments() {
     Memory::Segment curr;
     auto offset = readExpression();
     auto size = getU32LEB();
-    std::vector<char> buffer;
-    buffer.resize(size);
-    for (size_t j = 0; j < size; j++) {
-      buffer[j] = char(getInt8());
-    }
-    wasm.memory.segments.emplace_back(offset, (const char*)&buffer[0], size);
+    if (size > inputSize - pos) throw ParseException("unexpected end of input");
+    // copy in bulk straight out of the input, not a byte at a time
+    wasm.memory.segments.emplace_back(offset, input + pos, size);
+    pos += size;
   }
 }
 
@@ -1956,6 +2307,7 @@ void WasmBinaryBuilder::visitIf(If *curr) {
   if (debug) std::cerr << "zz node: If" << std::endl;
   curr->type = getWasmType();
   curr->condition = popNonVoidExpression();
+  checkOperand(curr->condition, i32, "if condition");
   curr->ifTrue = getBlock(curr->type);
   if (lastSeparator == BinaryConsts::Else) {
     curr->ifFalse = getBlock(curr->type);
@@ -1996,7 +2348,10 @@ void WasmBinaryBuilder::visitBreak(Break *curr, uint8_t code) {
   if (debug) std::cerr << "zz node: Break, code "<< int32_t(code) << std::endl;
   BreakTarget target = getBreakTarget(getU32LEB());
   curr->name = target.name;
-  if (code == BinaryConsts::BrIf) curr->condition = popNonVoidExpression();
+  if (code == BinaryConsts::BrIf) {
+    curr->condition = popNonVoidExpression();
+    checkOperand(curr->condition, i32, "br_if condition");
+  }
   if (target.arity) curr->value = popNonVoidExpression();
   curr->finalize();
 }
@@ -2060,8 +2415,10 @@ void WasmBinaryBuilder::visitCallIndirect(CallIndirect *curr) {
   auto num = fullType->params.size();
   curr->operands.resize(num);
   curr->target = popNonVoidExpression();
+  checkOperand(curr->target, i32, "call_indirect target");
   for (size_t i = 0; i < num; i++) {
     curr->operands[num - i - 1] = popNonVoidExpression();
+    checkOperand(curr->operands[num - i - 1], fullType->params[num - i - 1], "call_indirect operand");
   }
   curr->type = fullType->result;
   curr->finalize();
@@ -2090,6 +2447,7 @@ void WasmBinaryBuilder::visitSetLocal(SetLocal *curr, uint8_t code) {
     throw ParseException("bad set_local index");
   }
   curr->value = popNonVoidExpression();
+  checkOperand(curr->value, currFunction->getLocalType(curr->index), "set_local value");
   curr->type = curr->value->type;
   curr->setTee(code == BinaryConsts::TeeLocal);
   curr->finalize();
@@ -2169,7 +2527,9 @@ bool WasmBinaryBuilder::maybeVisitStore(Expression*& out, uint8_t code) {
   if (debug) std::cerr << "zz node: Store" << std::endl;
   readMemoryAccess(curr->align, curr->bytes, curr->offset);
   curr->value = popNonVoidExpression();
+  checkOperand(curr->value, curr->valueType, "store value");
   curr->ptr = popNonVoidExpression();
+  checkOperand(curr->ptr, i32, "store pointer");
   curr->finalize();
   out = curr;
   return true;
@@ -2309,6 +2669,7 @@ bool WasmBinaryBuilder::maybeVisitBinary(Expression*& out, uint8_t code) {
   if (debug) std::cerr << "zz node: Binary" << std::endl;
   curr->right = popNonVoidExpression();
   curr->left = popNonVoidExpression();
+  checkOperandsMatch(curr->left, curr->right, "binary op");
   curr->finalize();
   out = curr;
   return true;
@@ -2320,8 +2681,10 @@ bool WasmBinaryBuilder::maybeVisitBinary(Expression*& out, uint8_t code) {
 void WasmBinaryBuilder::visitSelect(Select *curr) {
   if (debug) std::cerr << "zz node: Select" << std::endl;
   curr->condition = popNonVoidExpression();
+  checkOperand(curr->condition, i32, "select condition");
   curr->ifFalse = popNonVoidExpression();
   curr->ifTrue = popNonVoidExpression();
+  checkOperandsMatch(curr->ifTrue, curr->ifFalse, "select arms");
   curr->finalize();
 }
 
@@ -2332,6 +2695,7 @@ void WasmBinaryBuilder::visitReturn(Return *curr) {
   }
   if (currFunction->result != none) {
     curr->value = popNonVoidExpression();
+    checkOperand(curr->value, currFunction->result, "return value");
   }
   curr->finalize();
 }
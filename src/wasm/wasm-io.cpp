@@ -24,6 +24,8 @@
 // binary.
 //
 
+#include <iostream>
+
 #include "wasm-io.h"
 #include "wasm-s-parser.h"
 #include "wasm-binary.h"
@@ -39,14 +41,53 @@ void ModuleReader::readText(std::string filename, Module& wasm) {
   SExpressionWasmBuilder builder(wasm, *root[0]);
 }
 
+static std::vector<char> readStdin() {
+  std::vector<char> input;
+  char buffer[32 * 1024];
+  while (std::cin.read(buffer, sizeof(buffer)) || std::cin.gcount() > 0) {
+    input.insert(input.end(), buffer, buffer + std::cin.gcount());
+  }
+  return input;
+}
+
 void ModuleReader::readBinary(std::string filename, Module& wasm) {
   if (debug) std::cerr << "reading binary from " << filename << "\n";
-  auto input(read_file<std::vector<char>>(filename, Flags::Binary, debug ? Flags::Debug : Flags::Release));
-  WasmBinaryBuilder parser(wasm, input, debug);
+  if (filename == "-") {
+    // piped from the previous stage, no filesystem round trip
+    auto input = readStdin();
+    WasmBinaryBuilder parser(wasm, input, debug);
+    parser.setSkipUserSections(skipUserSections);
+    parser.read();
+    return;
+  }
+  // map the file rather than copying it into memory - the builder parses
+  // directly out of the read-only mapping, and everything it needs later
+  // (like names) is interned during the parse, so the mapping can go away
+  // when we are done
+  //
+  // On pipelining decode into the first pass rather than finishing the
+  // read first: each phase here is already parallel on the whole pool
+  // (readFunctions decodes bodies on all workers, passes are function-
+  // parallel, writeFunctions encodes on all workers and streams sections
+  // to the sink), so a phase boundary idles no cores - overlap could only
+  // reassign them. Fusing decode into pass workers would have to go
+  // through ensureFunctionBody, whose materialization is serialized on
+  // the builder's shared parsing state, i.e. slower than the parallel
+  // eager decode it replaces; and validation must complete before any
+  // pass runs, which forces all bodies anyway. Lazy bodies remain the
+  // right tool for the tools that skip both walks (wasm-dis).
+  MappedFile input(filename, debug ? Flags::Debug : Flags::Release);
+  WasmBinaryBuilder parser(wasm, input.data(), input.size(), debug);
+  parser.setSkipUserSections(skipUserSections);
   parser.read();
 }
 
 void ModuleReader::read(std::string filename, Module& wasm) {
+  if (filename == "-") {
+    // piped input is always binary (text pipelines can name a file)
+    readBinary(filename, wasm);
+    return;
+  }
   // see if this is a wasm binary
   std::ifstream infile;
   std::ios_base::openmode flags = std::ifstream::in | std::ifstream::binary;
@@ -81,15 +122,34 @@ void ModuleWriter::writeBinary(Module& wasm, std::string filename) {
     writer.setSourceMap(sourceMapStream.get(), sourceMapUrl);
   }
   if (symbolMap.size() > 0) writer.setSymbolMap(symbolMap);
-  writer.write();
+  if (emitTOC) writer.setEmitTOC(true);
+  std::unique_ptr<std::ofstream> sizeProfileStream;
+  if (sizeProfileFilename.size()) {
+    sizeProfileStream = make_unique<std::ofstream>();
+    sizeProfileStream->open(sizeProfileFilename);
+    writer.setSizeProfile(sizeProfileStream.get());
+  }
   Output output(filename, Flags::Binary, debug ? Flags::Debug : Flags::Release);
-  buffer.writeTo(output);
+  if (!sourceMapStream) {
+    // stream each section out as it completes, so peak memory is bounded
+    // by one section rather than the whole binary (source maps need
+    // absolute offsets, so everything stays in memory for them)
+    writer.setSink(&output.getStream());
+  }
+  writer.write();
+  buffer.writeTo(output); // whatever was not streamed (everything, without a sink)
   if (sourceMapStream) {
     sourceMapStream->close();
   }
 }
 
 void ModuleWriter::write(Module& wasm, std::string filename) {
+  if (binary && filename == "-") {
+    // piped to the next stage: binary on stdout (Output with an empty
+    // filename writes to stdout)
+    writeBinary(wasm, "");
+    return;
+  }
   if (binary && filename.size() > 0) {
     writeBinary(wasm, filename);
   } else {
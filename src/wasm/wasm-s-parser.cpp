@@ -21,6 +21,7 @@
 #include <limits>
 
 #include "asm_v_wasm.h"
+#include "support/threads.h"
 #include "asmjs/shared-constants.h"
 #include "ast_utils.h"
 #include "shared-constants.h"
@@ -28,6 +29,13 @@
 #include "wasm-builder.h"
 
 #define abort_on(str) { throw ParseException(std::string("abort_on ") + str); }
+
+// a locale-free, branch-light classifier for the scanning loops: isspace()
+// is a function call into locale machinery per character, and the scanner
+// touches every byte of multi-hundred-megabyte inputs
+static bool isSpaceChar(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
 #define element_assert(condition) assert((condition) ? true : (std::cerr << "on: " << *this << '\n' && 0));
 
 using cashew::IString;
@@ -170,7 +178,7 @@ void SExpressionParser::parseDebugLocation() {
 
 void SExpressionParser::skipWhitespace() {
   while (1) {
-    while (isspace(input[0])) {
+    while (isSpaceChar(input[0])) {
       if (input[0] == '\n') {
         line++;
         lineStart = input + 1;
@@ -242,7 +250,7 @@ Element* SExpressionParser::parseString() {
     input++;
     return allocator.alloc<Element>()->setString(IString(str.c_str(), false), dollared, true)->setMetadata(line, start - lineStart, loc);
   }
-  while (input[0] && !isspace(input[0]) && input[0] != ')' && input[0] != '(' && input[0] != ';') input++;
+  while (input[0] && !isSpaceChar(input[0]) && input[0] != ')' && input[0] != '(' && input[0] != ';') input++;
   if (start == input) throw ParseException("expected string", line, input - lineStart);
   char temp = input[0];
   input[0] = 0;
@@ -286,8 +294,120 @@ SExpressionWasmBuilder::SExpressionWasmBuilder(Module& wasm, Element& module, Na
     }
   }
   functionCounter -= implementedFunctions; // we go through the functions again, now parsing them, and the counter begins from where imports ended
+  // non-function elements parse serially, in order; the defined functions
+  // are independent of each other once the pre-passes above ran, so on big
+  // modules they are built in parallel
+  std::vector<Element*> functionElements;
   for (unsigned j = i; j < module.size(); j++) {
-    parseModuleElement(*module[j]);
+    auto& s = *module[j];
+    if (s[0]->str() == FUNC && !isImport(s)) {
+      functionElements.push_back(&s);
+    } else {
+      parseModuleElement(s);
+    }
+  }
+  parseImplementedFunctions(functionElements);
+}
+
+SExpressionWasmBuilder::SExpressionWasmBuilder(SExpressionWasmBuilder& parent)
+    : wasm(parent.wasm),
+      allocator(parent.allocator),
+      functionNames(parent.functionNames),
+      functionTypeNames(parent.functionTypeNames),
+      globalNames(parent.globalNames),
+      functionCounter(parent.functionCounter),
+      globalCounter(parent.globalCounter),
+      functionTypes(parent.functionTypes),
+      debugInfoFileIndices(parent.debugInfoFileIndices) {
+  deferAdds = true;
+}
+
+// debug location annotations record new file names into the module as they
+// are seen, which must not happen concurrently; such files are rare, so
+// they just parse serially
+static bool hasDebugAnnotations(Element& s) {
+  if (s.loc) return true;
+  if (s.isList()) {
+    for (size_t i = 0; i < s.size(); i++) {
+      if (hasDebugAnnotations(*s[i])) return true;
+    }
+  }
+  return false;
+}
+
+void SExpressionWasmBuilder::parseImplementedFunctions(std::vector<Element*>& elements) {
+  auto base = functionCounter;
+  size_t total = elements.size();
+  size_t numWorkers = ThreadPool::get()->size();
+  bool canParallelize = numWorkers > 1 && total > 1 && !ThreadPool::isRunning();
+  if (canParallelize) {
+    for (auto* element : elements) {
+      if (hasDebugAnnotations(*element)) {
+        canParallelize = false;
+        break;
+      }
+    }
+  }
+  if (!canParallelize) {
+    for (auto* element : elements) {
+      parseFunction(*element);
+    }
+    return;
+  }
+  // one clone builder per worker; each claims function elements off the
+  // shared queue and parses them with its own per-function state, deferring
+  // the module additions, which we then apply in program order
+  std::vector<std::unique_ptr<SExpressionWasmBuilder>> builders;
+  for (size_t w = 0; w < numWorkers; w++) {
+    builders.push_back(std::unique_ptr<SExpressionWasmBuilder>(new SExpressionWasmBuilder(*this)));
+  }
+  struct Parsed {
+    std::vector<std::unique_ptr<Function>> functions;
+    std::vector<std::unique_ptr<Export>> exports;
+  };
+  std::vector<Parsed> parsed(total);
+  std::atomic<size_t> nextElement;
+  nextElement.store(0);
+  std::mutex parseError;
+  std::unique_ptr<ParseException> firstError;
+  std::vector<std::function<ThreadWorkState ()>> doWorkers;
+  for (size_t w = 0; w < numWorkers; w++) {
+    doWorkers.push_back([&, w]() {
+      auto index = nextElement.fetch_add(1);
+      if (index >= total) {
+        return ThreadWorkState::Finished; // nothing left
+      }
+      auto& builder = *builders[w];
+      try {
+        builder.functionCounter = base + index;
+        builder.parseFunction(*elements[index]);
+        parsed[index].functions.swap(builder.deferredFunctions);
+        parsed[index].exports.swap(builder.deferredExports);
+      } catch (ParseException& e) {
+        std::lock_guard<std::mutex> lock(parseError);
+        if (!firstError) firstError = make_unique<ParseException>(e);
+        return ThreadWorkState::Finished;
+      }
+      if (index + 1 == total) {
+        return ThreadWorkState::Finished; // we claimed the last one
+      }
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+  if (firstError) {
+    throw *firstError;
+  }
+  functionCounter = base + total;
+  for (auto& result : parsed) {
+    for (auto& ex : result.exports) {
+      if (wasm.getExportOrNull(ex->name)) throw ParseException("duplicate export");
+      wasm.addExport(ex.release());
+    }
+    for (auto& func : result.functions) {
+      if (wasm.getFunctionOrNull(func->name)) throw ParseException("duplicate function");
+      wasm.addFunction(func.release());
+    }
   }
 }
 
@@ -405,16 +525,10 @@ void SExpressionWasmBuilder::preParseFunctionType(Element& s) {
     // if no function type provided, generate one, but reuse a previous one with the
     // right structure if there is one.
     // see https://github.com/WebAssembly/spec/pull/301
-    bool need = true;
     std::unique_ptr<FunctionType> functionType = make_unique<FunctionType>();
     functionType->result = functionTypes[name];
     functionType->params = std::move(params);
-    for (auto& existing : wasm.functionTypes) {
-      if (existing->structuralComparison(*functionType)) {
-        need = false;
-        break;
-      }
-    }
+    bool need = !findStructuralType(functionType.get());
     if (need) {
       functionType->name = Name::fromInt(wasm.functionTypes.size());
       functionTypeNames.push_back(functionType->name);
@@ -424,6 +538,17 @@ void SExpressionWasmBuilder::preParseFunctionType(Element& s) {
   }
 }
 
+FunctionType* SExpressionWasmBuilder::findStructuralType(FunctionType* needle) {
+  // catch up on any types added since we last looked - types can also be
+  // added behind our back, e.g. by ensureFunctionType while parsing imports
+  for (; seenFunctionTypes < wasm.functionTypes.size(); seenFunctionTypes++) {
+    auto* type = wasm.functionTypes[seenFunctionTypes].get();
+    sigTypes.insert(std::make_pair(getSig(type), type)); // the first type with a structure wins
+  }
+  auto iter = sigTypes.find(getSig(needle));
+  return iter == sigTypes.end() ? nullptr : iter->second;
+}
+
 size_t SExpressionWasmBuilder::parseFunctionNames(Element& s, Name& name, Name& exportName) {
   size_t i = 1;
   while (i < s.size() && i < 3 && s[i]->isStr()) {
@@ -475,8 +600,12 @@ void SExpressionWasmBuilder::parseFunction(Element& s, bool preParseImport) {
     ex->name = exportName;
     ex->value = name;
     ex->kind = ExternalKind::Function;
-    if (wasm.getExportOrNull(ex->name)) throw ParseException("duplicate export", s.line, s.col);
-    wasm.addExport(ex.release());
+    if (deferAdds) {
+      deferredExports.push_back(std::move(ex));
+    } else {
+      if (wasm.getExportOrNull(ex->name)) throw ParseException("duplicate export", s.line, s.col);
+      wasm.addExport(ex.release());
+    }
   }
   Expression* body = nullptr;
   localIndex = 0;
@@ -569,11 +698,8 @@ void SExpressionWasmBuilder::parseFunction(Element& s, bool preParseImport) {
   if (type.isNull()) {
     // if no function type name provided, then we generated one
     std::unique_ptr<FunctionType> functionType = std::unique_ptr<FunctionType>(sigToFunctionType(getSigFromStructs(result, params)));
-    for (auto& existing : wasm.functionTypes) {
-      if (existing->structuralComparison(*functionType)) {
-        type = existing->name;
-        break;
-      }
+    if (auto* existing = findStructuralType(functionType.get())) {
+      type = existing->name;
     }
     if (!type.is()) throw ParseException("no function type [internal error?]", s.line, s.col);
   }
@@ -608,8 +734,12 @@ void SExpressionWasmBuilder::parseFunction(Element& s, bool preParseImport) {
   if (currFunction->result != result) throw ParseException("bad func declaration", s.line, s.col);
   currFunction->body = body;
   currFunction->type = type;
-  if (wasm.getFunctionOrNull(currFunction->name)) throw ParseException("duplicate function", s.line, s.col);
-  wasm.addFunction(currFunction.release());
+  if (deferAdds) {
+    deferredFunctions.push_back(std::move(currFunction));
+  } else {
+    if (wasm.getFunctionOrNull(currFunction->name)) throw ParseException("duplicate function", s.line, s.col);
+    wasm.addFunction(currFunction.release());
+  }
   currLocalTypes.clear();
   nameMapper.clear();
 }
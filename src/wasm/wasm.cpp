@@ -29,6 +29,7 @@ namespace BinaryConsts {
 namespace UserSections {
 const char* Name = "name";
 const char* SourceMapUrl = "sourceMappingURL";
+const char* Stats = "binaryen.stats";
 }
 }
 
@@ -664,6 +665,16 @@ void Module::removeImport(Name name) {
   importsMap.erase(name);
 }
 
+void Module::removeImports(std::function<bool (Import*)> predicate) {
+  imports.erase(std::remove_if(imports.begin(), imports.end(), [&](const std::unique_ptr<Import>& curr) {
+    if (predicate(curr.get())) {
+      importsMap.erase(curr->name);
+      return true;
+    }
+    return false;
+  }), imports.end());
+}
+
 void Module::removeExport(Name name) {
   for (size_t i = 0; i < exports.size(); i++) {
     if (exports[i]->name == name) {
@@ -208,8 +208,12 @@ Ref Wasm2AsmBuilder::processWasm(Module* wasm) {
   for (auto& import : wasm->imports) {
     addImport(asmFunc[3], import.get());
   }
-  // figure out the table size
-  tableSize = wasm->table.names.size();
+  // figure out the table size (the flat list of entries across segments;
+  // this predates segmented tables)
+  tableSize = 0;
+  for (auto& segment : wasm->table.segments) {
+    tableSize += segment.data.size();
+  }
   size_t pow2ed = 1;
   while (pow2ed < tableSize) {
     pow2ed <<= 1;
@@ -287,8 +291,14 @@ void Wasm2AsmBuilder::addImport(Ref ast, Import *import) {
 
 void Wasm2AsmBuilder::addTables(Ref ast, Module *wasm) {
   std::map<std::string, std::vector<IString>> tables; // asm.js tables, sig => contents of table
-  for (size_t i = 0; i < wasm->table.names.size(); i++) {
-    Name name = wasm->table.names[i];
+  std::vector<Name> names;
+  for (auto& segment : wasm->table.segments) {
+    for (auto& name : segment.data) {
+      names.push_back(name);
+    }
+  }
+  for (size_t i = 0; i < names.size(); i++) {
+    Name name = names[i];
     auto func = wasm->getFunction(name);
     std::string sig = getSig(func);
     auto& table = tables[sig];
@@ -0,0 +1,30 @@
+(module
+  (memory 1)
+  ;; unsigned division by a non-power-of-two constant lowers to a
+  ;; multiply-by-magic with the mulhi fixup at -O3
+  (func $div3 (param $x i32) (result i32)
+    (i32.div_u (get_local $x) (i32.const 3)))
+  (func $div7 (param $x i32) (result i32)
+    (i32.div_u (get_local $x) (i32.const 7)))
+  ;; power-of-two-adjacent divisors
+  (func $div5 (param $x i32) (result i32)
+    (i32.div_u (get_local $x) (i32.const 5)))
+  (func $div9 (param $x i32) (result i32)
+    (i32.div_u (get_local $x) (i32.const 9)))
+  ;; the largest divisor
+  (func $divmax (param $x i32) (result i32)
+    (i32.div_u (get_local $x) (i32.const 4294967295)))
+  ;; powers of two are not this transform's business
+  (func $div8 (param $x i32) (result i32)
+    (i32.div_u (get_local $x) (i32.const 8)))
+  ;; the fixup uses the dividend twice, so a non-get_local dividend
+  ;; (here, an effectful load) must not be lowered
+  (func $div-load (param $x i32) (result i32)
+    (i32.div_u (i32.load (get_local $x)) (i32.const 7)))
+  (export "div3" (func $div3))
+  (export "div7" (func $div7))
+  (export "div5" (func $div5))
+  (export "div9" (func $div9))
+  (export "divmax" (func $divmax))
+  (export "div8" (func $div8))
+)
@@ -55,4 +55,9 @@
       (i32.const 0)
     )
   )
+  (func $div7 (param $x i32) (result i32)
+    ;; under a shrink level the magic-division lowering must not fire
+    (i32.div_u (get_local $x) (i32.const 7))
+  )
+  (export "div7" (func $div7))
 )
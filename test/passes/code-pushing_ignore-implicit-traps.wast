@@ -1,4 +1,5 @@
 (module
+  (memory 1)
   (func $push1
     (local $x i32)
     (block $out
@@ -244,5 +245,51 @@
       )
     )
   )
+  (func $sink-into-if (param $p i32) (result i32)
+    (local $a i32)
+    (local $r i32)
+    ;; the set's local is read only in one arm and the condition is
+    ;; effect-free, so the set sinks into that arm
+    (set_local $a (i32.add (get_local $p) (i32.const 1)))
+    (if (get_local $p)
+      (set_local $r (get_local $a))
+    )
+    (get_local $r)
+  )
+  (func $sink-into-if-condition-tee (param $b i32) (result i32)
+    (local $a i32)
+    (local $r i32)
+    ;; must not sink: the condition tees a local the set's value read, so
+    ;; moving the set past it would change the computed value
+    (set_local $a (get_local $b))
+    (if (tee_local $b (i32.const 5))
+      (set_local $r (get_local $a))
+    )
+    (get_local $r)
+  )
+  (func $sink-into-if-condition-store (param $p i32) (result i32)
+    (local $a i32)
+    (local $r i32)
+    ;; must not sink: the condition writes memory the value reads
+    (set_local $a (i32.load (get_local $p)))
+    (if (block (result i32)
+        (i32.store (get_local $p) (i32.const 1))
+        (get_local $p)
+      )
+      (set_local $r (get_local $a))
+    )
+    (get_local $r)
+  )
+  (func $sink-into-if-both-arms (param $p i32) (result i32)
+    (local $a i32)
+    (local $r i32)
+    ;; must not sink: read in both arms
+    (set_local $a (i32.add (get_local $p) (i32.const 1)))
+    (if (get_local $p)
+      (set_local $r (get_local $a))
+      (set_local $r (i32.sub (i32.const 0) (get_local $a)))
+    )
+    (get_local $r)
+  )
 )
 
@@ -0,0 +1,53 @@
+(module
+  (func $dead (param $p i32) (result i32)
+    (local $x i32)
+    ;; never read afterward: becomes a drop, vacuumable later
+    (set_local $x (i32.const 1))
+    (get_local $p)
+  )
+  (func $dead-effects (param $p i32) (result i32)
+    (local $x i32)
+    ;; the dead set keeps its side effects
+    (set_local $x (call $dead (i32.const 2)))
+    (get_local $p)
+  )
+  (func $dead-tee (param $p i32) (result i32)
+    (local $x i32)
+    ;; a dead tee is just its value
+    (drop (tee_local $x (i32.const 3)))
+    (get_local $p)
+  )
+  (func $live (result i32)
+    (local $x i32)
+    (set_local $x (i32.const 4))
+    (get_local $x)
+  )
+  (func $live-one-branch (param $p i32) (result i32)
+    (local $x i32)
+    ;; read on only one path, but that is a read: the set stays
+    (set_local $x (i32.const 5))
+    (if (result i32)
+      (get_local $p)
+      (get_local $x)
+      (i32.const 0)
+    )
+  )
+  (func $killed (param $p i32) (result i32)
+    (local $x i32)
+    ;; overwritten on every path before any read: dead
+    (set_local $x (i32.const 6))
+    (set_local $x (i32.const 7))
+    (get_local $x)
+  )
+  (func $loop-live (result i32)
+    (local $x i32)
+    (local $i i32)
+    ;; read by the next iteration via the back edge: live
+    (loop $l
+      (set_local $x (i32.add (get_local $x) (i32.const 1)))
+      (set_local $i (i32.add (get_local $i) (i32.const 1)))
+      (br_if $l (i32.lt_u (get_local $i) (i32.const 10)))
+    )
+    (get_local $x)
+  )
+)
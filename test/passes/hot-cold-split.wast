@@ -0,0 +1,31 @@
+(module
+ (import "env" "abort" (func $abort (param i32)))
+ (func $hot (param $x i32) (param $y i32) (result i32)
+  (if (i32.lt_s (get_local $x) (i32.const 0))
+   (block
+    (drop (i32.add (get_local $x) (get_local $y)))
+    (drop (i32.mul (get_local $x) (i32.const 3)))
+    (call $abort (i32.add (get_local $x) (i32.const 100)))
+    (unreachable)
+   )
+  )
+  (i32.add (get_local $x) (get_local $y))
+ )
+ (func $small (param $x i32) (result i32)
+  (if (get_local $x) (unreachable))
+  (get_local $x)
+ )
+ (func $escapes (param $x i32) (result i32)
+  (block $out
+   (if (get_local $x)
+    (block
+     (drop (i32.add (get_local $x) (i32.const 1)))
+     (drop (i32.add (get_local $x) (i32.const 2)))
+     (drop (i32.add (get_local $x) (i32.const 3)))
+     (br $out)
+    )
+   )
+  )
+  (get_local $x)
+ )
+)
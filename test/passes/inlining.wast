@@ -1,79 +1,30 @@
 (module
-  (table 1 1 anyfunc)
-  (elem (i32.const 0) $tabled)
-  (func $user (export "user")
-    (local $x i32)
-    (local $y f64)
-    (call $exported)
-    (call $tabled)
-    (call $multi)
-    (call $multi)
-    (call $ok)
-    (drop (call $int))
-    (drop (call $double))
-    (set_local $x (call $int2))
-    (set_local $y (call $double2))
-    (call $with-local)
-    (call $with-local2)
-    (drop (call $return))
-    (call $multipass)
-    (call $param (f32.const 12.34) (i64.const 890005350012))
-  )
-  (func $exported (export "exported")
-    (nop)
-  )
-  (func $recursive
-    (call $recursive)
-  )
-  (func $tabled
-    (nop)
-  )
-  (func $cycle1
-    (call $cycle2)
-  )
-  (func $cycle2
-    (call $cycle1)
-  )
-  (func $multi
-    (nop)
-  )
-  (func $ok
-    (drop (i32.const 1))
-  )
-  (func $int (result i32)
-    (i32.const 2)
-  )
-  (func $double (result f64)
-    (f64.const 3.14159)
-  )
-  (func $int2 (result i32)
-    (i32.const 112)
-  )
-  (func $double2 (result f64)
-    (f64.const 113.14159)
-  )
-  (func $with-local
-    (local $x f32)
-    (set_local $x (f32.const 2.141828))
-  )
-  (func $with-local2
-    (local $y i64)
-    (set_local $y (i64.const 4))
-  )
-  (func $return (result i32)
-    (return (i32.const 5))
-  )
-  (func $multipass
-    (call $multipass2)
-  )
-  (func $multipass2
-    (drop (i32.const 6))
-  )
-  (func $param (param $x f32) (param $y i64)
-    (local $z f32)
-    (drop (get_local $x))
-    (drop (get_local $y))
-    (drop (get_local $z))
-  )
+ (table 1 1 anyfunc)
+ (elem (i32.const 0) $tabled)
+ (export "user" (func $user))
+ (export "exported-cheap" (func $exported-cheap))
+ (func $single-use (result i32)
+  (i32.const 1234)
+ )
+ (func $cheap (param $x i32) (result i32)
+  (i32.add (get_local $x) (i32.const 1))
+ )
+ (func $exported-cheap (result i32)
+  (i32.const 42)
+ )
+ (func $expensive (result i32)
+  (i32.add (i32.mul (i32.const 2) (i32.const 3)) (i32.mul (i32.const 4) (i32.const 5)))
+ )
+ (func $tabled (result i32)
+  (i32.const 7)
+ )
+ (func $user (result i32)
+  (i32.add
+   (i32.add (call $single-use) (call $cheap (i32.const 10)))
+   (i32.add
+    (i32.add (call $cheap (i32.const 20)) (call $exported-cheap))
+    (i32.add (call $expensive) (call $expensive))
+   )
+  )
+ )
 )
-
@@ -0,0 +1,41 @@
+(module
+ (memory 1 1)
+ (func $hoist (param $n i32) (result i32)
+  (local $i i32)
+  (local $base i32)
+  (local $sum i32)
+  (block $out
+   (loop $top
+    (set_local $base (i32.mul (get_local $n) (i32.const 4)))
+    (set_local $sum (i32.add (get_local $sum) (get_local $base)))
+    (set_local $i (i32.add (get_local $i) (i32.const 1)))
+    (br_if $top (i32.lt_u (get_local $i) (get_local $n)))
+   )
+  )
+  (get_local $sum)
+ )
+ (func $no-hoist-memory (param $n i32) (result i32)
+  (local $i i32)
+  (local $v i32)
+  (block $out
+   (loop $top
+    (set_local $v (i32.load (get_local $n)))
+    (i32.store (i32.const 0) (get_local $i))
+    (set_local $i (i32.add (get_local $i) (i32.const 1)))
+    (br_if $top (i32.lt_u (get_local $i) (get_local $n)))
+   )
+  )
+  (get_local $v)
+ )
+ (func $no-hoist-after-branch (param $n i32) (result i32)
+  (local $a i32)
+  (block $out
+   (loop $top
+    (br_if $out (get_local $n))
+    (set_local $a (i32.mul (get_local $n) (i32.const 3)))
+    (br $top)
+   )
+  )
+  (get_local $a)
+ )
+)
@@ -10,7 +10,7 @@
       (i32.add (i32.const 1) (i32.const 2))
     )
     (if (i32.const 0) (nop))
-    (drop ;; we can't do this yet, non-linear
+    (drop ;; the pre-if value dominates the join, so this is reused now
       (i32.add (i32.const 1) (i32.const 2))
     )
     (drop
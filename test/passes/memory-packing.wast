@@ -18,3 +18,19 @@
   (data (i32.const 4066) "") ;; empty
 )
 
+(module
+  (import "env" "memory" (memory $0 2048 2048))
+  ;; two segments with a tiny gap merge, when nothing else wrote the gap
+  (data (i32.const 100) "abc")
+  (data (i32.const 106) "def")
+)
+(module
+  (import "env" "memory" (memory $0 2048 2048))
+  (import "env" "memoryBase" (global $memoryBase i32))
+  ;; an earlier segment at an unknown offset may have written into the
+  ;; gap (unlike const-offset segments, the validator does not order
+  ;; these), and merging would zero-fill over its bytes: no merge
+  (data (get_global $memoryBase) "XY")
+  (data (i32.const 100) "abc")
+  (data (i32.const 106) "def")
+)
@@ -0,0 +1,22 @@
+(module
+ (memory 1 1)
+ (func $pure (param $x i32) (result i32)
+  (i32.add (i32.mul (get_local $x) (get_local $x)) (i32.const 1))
+ )
+ (func $impure (param $x i32) (result i32)
+  (i32.load (get_local $x))
+ )
+ (func $sinks-past-pure (param $p i32) (result i32)
+  (local $a i32)
+  (set_local $a (i32.load (get_local $p)))
+  (drop (call $pure (i32.const 1)))
+  (drop (call $pure (i32.const 2)))
+  (get_local $a)
+ )
+ (func $blocked-by-impure (param $p i32) (result i32)
+  (local $a i32)
+  (set_local $a (i32.load (get_local $p)))
+  (drop (call $impure (i32.const 0)))
+  (get_local $a)
+ )
+)
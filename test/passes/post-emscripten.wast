@@ -208,4 +208,43 @@
       )
     )
   )
+  (func $reassociate (param $x i32) (param $y i32) (result i32)
+    ;; the constant is buried under another add: (x + 8) + y folds to offset=8
+    (i32.load
+      (i32.add
+        (i32.add
+          (get_local $x)
+          (i32.const 8)
+        )
+        (get_local $y)
+      )
+    )
+  )
+  (func $reassociate-both (param $x i32) (param $y i32) (result i32)
+    ;; constants on both children accumulate into the offset
+    (i32.load
+      (i32.add
+        (i32.add
+          (get_local $x)
+          (i32.const 8)
+        )
+        (i32.add
+          (get_local $y)
+          (i32.const 16)
+        )
+      )
+    )
+  )
+  (func $reassociate-big (param $x i32) (param $y i32) (result i32)
+    ;; an unsafe (too large) constant stays where it is
+    (i32.load
+      (i32.add
+        (i32.add
+          (get_local $x)
+          (i32.const 2048)
+        )
+        (get_local $y)
+      )
+    )
+  )
 )
@@ -0,0 +1,19 @@
+(module
+ (memory 1 1)
+ (func $sink (param $p i32) (result i32)
+  (local $a i32)
+  (local $b i32)
+  (set_local $a (i32.add (get_local $p) (i32.const 1)))
+  (set_local $b (i32.mul (get_local $p) (i32.const 2)))
+  (drop (get_local $b))
+  (drop (get_local $b))
+  (get_local $a)
+ )
+ (func $blocked (param $p i32) (result i32)
+  (local $a i32)
+  (set_local $a (i32.load (get_local $p)))
+  (i32.store (get_local $p) (i32.const 5))
+  (drop (call $sink (i32.const 0)))
+  (get_local $a)
+ )
+)
@@ -0,0 +1,50 @@
+(module
+  (memory 1)
+  (func $fill (param $p i32)
+    ;; an unrolled memset: four constant byte stores become one i32 store
+    (i32.store8 (get_local $p) (i32.const 1))
+    (i32.store8 offset=1 (get_local $p) (i32.const 2))
+    (i32.store8 offset=2 (get_local $p) (i32.const 3))
+    (i32.store8 offset=3 (get_local $p) (i32.const 4))
+  )
+  (func $fill-partial (param $p i32)
+    ;; three bytes: merge two, leave the odd one
+    (i32.store8 (get_local $p) (i32.const 255))
+    (i32.store8 offset=1 (get_local $p) (i32.const 255))
+    (i32.store8 offset=2 (get_local $p) (i32.const 255))
+  )
+  (func $fill-wide (param $p i32)
+    ;; eight zero bytes become one i64 store
+    (i32.store8 (get_local $p) (i32.const 0))
+    (i32.store8 offset=1 (get_local $p) (i32.const 0))
+    (i32.store8 offset=2 (get_local $p) (i32.const 0))
+    (i32.store8 offset=3 (get_local $p) (i32.const 0))
+    (i32.store8 offset=4 (get_local $p) (i32.const 0))
+    (i32.store8 offset=5 (get_local $p) (i32.const 0))
+    (i32.store8 offset=6 (get_local $p) (i32.const 0))
+    (i32.store8 offset=7 (get_local $p) (i32.const 0))
+  )
+  (func $copy (param $p i32)
+    ;; a same-base struct copy with disjoint ranges widens
+    (i32.store8 offset=16 (get_local $p) (i32.load8_u (get_local $p)))
+    (i32.store8 offset=17 (get_local $p) (i32.load8_u offset=1 (get_local $p)))
+    (i32.store8 offset=18 (get_local $p) (i32.load8_u offset=2 (get_local $p)))
+    (i32.store8 offset=19 (get_local $p) (i32.load8_u offset=3 (get_local $p)))
+  )
+  (func $copy-overlap (param $p i32)
+    ;; overlapping ranges must not widen (a byte-wise copy propagates)
+    (i32.store8 offset=1 (get_local $p) (i32.load8_u (get_local $p)))
+    (i32.store8 offset=2 (get_local $p) (i32.load8_u offset=1 (get_local $p)))
+  )
+  (func $copy-two-bases (param $d i32) (param $s i32)
+    ;; two different locals might alias, so this stays byte-wise
+    (i32.store8 (get_local $d) (i32.load8_u (get_local $s)))
+    (i32.store8 offset=1 (get_local $d) (i32.load8_u offset=1 (get_local $s)))
+  )
+  (func $interrupted (param $p i32)
+    ;; a non-store in between ends the run
+    (i32.store8 (get_local $p) (i32.const 1))
+    (drop (i32.const 0))
+    (i32.store8 offset=1 (get_local $p) (i32.const 2))
+  )
+)
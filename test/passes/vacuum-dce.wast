@@ -0,0 +1,18 @@
+(module
+ (func $trim (result i32)
+  (block $b (result i32)
+   (nop)
+   (drop (i32.add (i32.const 1) (i32.const 2)))
+   (unreachable)
+   (drop (i32.const 3))
+   (i32.const 4)
+  )
+ )
+ (func $keep-effects (param $x i32)
+  (block
+   (drop (call $trim))
+   (set_local $x (i32.const 1))
+   (nop)
+  )
+ )
+)
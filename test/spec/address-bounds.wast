@@ -0,0 +1,33 @@
+;; Out-of-bounds trap behavior of loads and stores, including the i32
+;; addresses near 2^32 whose unsigned interpretation the interpreter's
+;; bounds check must preserve (a signed read would wrap the end-of-access
+;; computation and miss the trap).
+(module
+  (memory 1)
+  (func $load-at (param $p i32) (result i32)
+    (i32.load (get_local $p)))
+  (func $load8-at (param $p i32) (result i32)
+    (i32.load8_u (get_local $p)))
+  (func $load-offset-at (param $p i32) (result i32)
+    (i32.load offset=4 (get_local $p)))
+  (func $store-at (param $p i32)
+    (i32.store (get_local $p) (i32.const 7)))
+  (export "load-at" (func $load-at))
+  (export "load8-at" (func $load8-at))
+  (export "load-offset-at" (func $load-offset-at))
+  (export "store-at" (func $store-at))
+)
+;; in-bounds accesses work, right up to the edge
+(assert_return (invoke "load-at" (i32.const 0)) (i32.const 0))
+(assert_return (invoke "load-at" (i32.const 65532)) (i32.const 0))
+(assert_return (invoke "load8-at" (i32.const 65535)) (i32.const 0))
+;; one past the edge traps
+(assert_trap (invoke "load-at" (i32.const 65533)) "out of bounds memory access")
+(assert_trap (invoke "load8-at" (i32.const 65536)) "out of bounds memory access")
+(assert_trap (invoke "store-at" (i32.const 65533)) "out of bounds memory access")
+;; addresses near 2^32: unsigned, not signed
+(assert_trap (invoke "load-at" (i32.const -1)) "out of bounds memory access")
+(assert_trap (invoke "load8-at" (i32.const -1)) "out of bounds memory access")
+(assert_trap (invoke "store-at" (i32.const -4)) "out of bounds memory access")
+;; the offset is added without wrapping
+(assert_trap (invoke "load-offset-at" (i32.const -4)) "out of bounds memory access")